@@ -30,11 +30,123 @@ THE SOFTWARE.
 
 #include "Archivable.h"
 #include <sqlite3/sqlite3.h>
+#include <pthread.h>
 #include <string>
 #include <vector>
+#include <map>
+#include <set>
 
 using namespace SubcloneSeeker;
 
+/**
+ * The prepared statements and the known tables of one database connection
+ */
+struct StatementCache {
+	std::map<std::string, sqlite3_stmt *> statements; /**< prepared statements, keyed by SQL text */
+	std::set<std::string> tables; /**< tables known to exist */
+};
+
+typedef std::map<sqlite3 *, StatementCache> StatementCache_map;
+
+static StatementCache_map _statementCaches;
+static pthread_mutex_t _statementCachesLock = PTHREAD_MUTEX_INITIALIZER;
+
+sqlite3_stmt *Archivable::cachedStatement(sqlite3 *database, const std::string& sql) {
+	sqlite3_stmt *statement = NULL;
+
+	pthread_mutex_lock(&_statementCachesLock);
+	std::map<std::string, sqlite3_stmt *>& statements = _statementCaches[database].statements;
+	std::map<std::string, sqlite3_stmt *>::iterator it = statements.find(sql);
+	if(it != statements.end()) {
+		statement = it->second;
+	}
+	else {
+		int rc = sqlite3_prepare_v2(database, sql.c_str(), -1, &statement, 0);
+		if(rc != SQLITE_OK) {
+			sqlite3_finalize(statement);
+			statement = NULL;
+		}
+		else {
+			statements[sql] = statement;
+		}
+	}
+	pthread_mutex_unlock(&_statementCachesLock);
+
+	if(statement != NULL) {
+		sqlite3_reset(statement);
+		sqlite3_clear_bindings(statement);
+	}
+	return statement;
+}
+
+void Archivable::releaseCachedStatements(sqlite3 *database) {
+	pthread_mutex_lock(&_statementCachesLock);
+	StatementCache_map::iterator cache = _statementCaches.find(database);
+	if(cache != _statementCaches.end()) {
+		std::map<std::string, sqlite3_stmt *>::iterator it;
+		for(it = cache->second.statements.begin(); it != cache->second.statements.end(); it++)
+			sqlite3_finalize(it->second);
+		_statementCaches.erase(cache);
+	}
+	pthread_mutex_unlock(&_statementCachesLock);
+}
+
+int Archivable::closeDatabase(sqlite3 *database) {
+	releaseCachedStatements(database);
+	return sqlite3_close(database);
+}
+
+bool Archivable::tuneDatabaseForWriting(sqlite3 *database) {
+	// the page size must be set before switching to WAL, and only applies
+	// to an empty database
+	if(sqlite3_exec(database, "PRAGMA page_size=4096;", NULL, NULL, NULL) != SQLITE_OK)
+		return false;
+
+	sqlite3_stmt *statement;
+	if(sqlite3_prepare_v2(database, "PRAGMA journal_mode=WAL;", -1, &statement, 0) != SQLITE_OK) {
+		sqlite3_finalize(statement);
+		return false;
+	}
+	// the pragma reports the resulting mode, which is unchanged on failure
+	bool isWAL = sqlite3_step(statement) == SQLITE_ROW &&
+		std::string((const char *)sqlite3_column_text(statement, 0)) == "wal";
+	sqlite3_finalize(statement);
+	if(not isWAL)
+		return false;
+
+	return sqlite3_exec(database, "PRAGMA synchronous=NORMAL;", NULL, NULL, NULL) == SQLITE_OK;
+}
+
+bool Archivable::ensureTableInDB(sqlite3 *database) {
+	std::string tableName = getTableName();
+	bool known;
+
+	pthread_mutex_lock(&_statementCachesLock);
+	known = _statementCaches[database].tables.count(tableName) > 0;
+	pthread_mutex_unlock(&_statementCachesLock);
+	if(known)
+		return true;
+
+	sqlite3_stmt *statement = cachedStatement(database, "SELECT name FROM sqlite_master WHERE type='table' AND name=?;");
+	if(statement == NULL)
+		return false;
+
+	sqlite3_bind_text(statement, 1, tableName.c_str(), -1, SQLITE_TRANSIENT);
+	int rc = sqlite3_step(statement);
+	sqlite3_reset(statement);
+
+	if(rc != SQLITE_ROW) {
+		// Table does not exist, create table
+		if(not createTableInDB(database))
+			return false;
+	}
+
+	pthread_mutex_lock(&_statementCachesLock);
+	_statementCaches[database].tables.insert(tableName);
+	pthread_mutex_unlock(&_statementCachesLock);
+	return true;
+}
+
 bool Archivable::createTableInDB(sqlite3 *database) {
 	sqlite3_stmt *stmt;
 
@@ -54,45 +166,51 @@ bool Archivable::createTableInDB(sqlite3 *database) {
 		return false;
 	}
 
+	pthread_mutex_lock(&_statementCachesLock);
+	_statementCaches[database].tables.insert(getTableName());
+	pthread_mutex_unlock(&_statementCachesLock);
+
+	return createIndexesInDB(database);
+}
+
+bool Archivable::createIndexesInDB(sqlite3 *database) {
+	std::string tableName = getTableName();
+	std::vector<std::string> columns = indexedColumnList();
+
+	for(size_t i=0; i<columns.size(); i++) {
+		std::string stmt_str = "CREATE INDEX IF NOT EXISTS " + tableName + "_" + columns[i] + " ON " + tableName + " (" + columns[i] + ");";
+		if(sqlite3_exec(database, stmt_str.c_str(), NULL, NULL, NULL) != SQLITE_OK)
+			return false;
+	}
+
 	return true;
 }
 
 sqlite3_int64 Archivable::archiveObjectToDB(sqlite3 *database) {
 	sqlite3_stmt *statement;
 	int rc;
-	int bind_loc;
 
-	// check if table exist
-	std::string table_check_str = "SELECT name FROM sqlite_master WHERE type='table' AND name='"+getTableName()+"';";
-	rc = sqlite3_prepare_v2(database, table_check_str.c_str(), -1, &statement, 0);
-	if(rc != SQLITE_OK) {
-		sqlite3_finalize(statement);
-		return -1;
-	}
-	rc = sqlite3_step(statement);
-	sqlite3_finalize(statement);
-	if(rc != SQLITE_ROW) {
-		// Table does not exist, create table
-		createTableInDB(database);
-	}
+	// check if table exist, creating it if not
+	ensureTableInDB(database);
 
-	// First, determines if the record already exist
-	std::string select_str = "SELECT id FROM " + getTableName() + " WHERE id=?;";
-	rc = sqlite3_prepare_v2(database, select_str.c_str(), -1, &statement, 0);
-	if(rc != SQLITE_OK) {
-		sqlite3_finalize(statement);
-		return -2;
-	}
+	// First, determines if the record already exist. Ids are assigned by
+	// the database and are positive, so a new object needs no lookup
+	rc = SQLITE_DONE;
+	if(id > 0) {
+		statement = cachedStatement(database, "SELECT id FROM " + getTableName() + " WHERE id=?;");
+		if(statement == NULL) {
+			return -2;
+		}
 
-	sqlite3_bind_int64(statement, 1, id);
-	rc = sqlite3_step(statement);
-	sqlite3_finalize(statement);
+		sqlite3_bind_int64(statement, 1, id);
+		rc = sqlite3_step(statement);
+		sqlite3_reset(statement);
+	}
 
 	if(rc == SQLITE_ROW) {
 		// record exist, update mode
-		rc = sqlite3_prepare_v2(database, updateObjectStatementStr().c_str(), -1, &statement, 0);
-		if(rc != SQLITE_OK) {
-			sqlite3_finalize(statement);
+		statement = cachedStatement(database, updateObjectStatementStr());
+		if(statement == NULL) {
 			return -3;
 		}
 
@@ -100,7 +218,7 @@ sqlite3_int64 Archivable::archiveObjectToDB(sqlite3 *database) {
 		sqlite3_bind_int64(statement, bind_pos, id);
 
 		rc = sqlite3_step(statement);
-		sqlite3_finalize(statement);
+		sqlite3_reset(statement);
 		if(rc != SQLITE_DONE) {
 			return -4;
 		}
@@ -109,16 +227,15 @@ sqlite3_int64 Archivable::archiveObjectToDB(sqlite3 *database) {
 	}
 	else {
 		// record does not exist, insert mode
-		rc = sqlite3_prepare_v2(database, createObjectStatementStr().c_str(), -1, &statement, 0);
-		if(rc != SQLITE_OK) {
-			sqlite3_finalize(statement);
+		statement = cachedStatement(database, createObjectStatementStr());
+		if(statement == NULL) {
 			return -5;
 		}
 		
-		int bind_pos = bindObjectToStatement(statement);
+		bindObjectToStatement(statement);
 
 		rc = sqlite3_step(statement);
-		sqlite3_finalize(statement);
+		sqlite3_reset(statement);
 		if(rc != SQLITE_DONE) {
 			return -6;
 		}
@@ -131,17 +248,15 @@ sqlite3_int64 Archivable::archiveObjectToDB(sqlite3 *database) {
 bool Archivable::unarchiveObjectFromDB(sqlite3 *database, sqlite3_int64 id) {
 	sqlite3_stmt* statement;
 	int rc;
-	std::string select_str = "SELECT " + selectObjectColumnListStr() + " FROM " + getTableName() + " WHERE id=?;";
-	rc = sqlite3_prepare_v2(database, select_str.c_str(), -1, &statement, 0);
-	if(rc != SQLITE_OK) {
-		sqlite3_finalize(statement);
+	statement = cachedStatement(database, "SELECT " + selectObjectColumnListStr() + " FROM " + getTableName() + " WHERE id=?;");
+	if(statement == NULL) {
 		return false;
 	}
 
 	sqlite3_bind_int64(statement, 1, id);
 	rc = sqlite3_step(statement);
 	if(rc != SQLITE_ROW) {
-		sqlite3_finalize(statement);
+		sqlite3_reset(statement);
 		return false;
 	}
 
@@ -149,26 +264,75 @@ bool Archivable::unarchiveObjectFromDB(sqlite3 *database, sqlite3_int64 id) {
 
 	updateObjectFromStatement(statement);
 
-	sqlite3_finalize(statement);
+	sqlite3_reset(statement);
 	return true;
 }
 
 std::vector<sqlite3_int64> Archivable::vecAllObjectsID(sqlite3 *database) {
-	std::string query_str = "SELECT id FROM " + getTableName() + ";";
 	sqlite3_stmt* statement;
 	int rc;
 
 	std::vector<sqlite3_int64> ret;
 
-	rc = sqlite3_prepare_v2(database, query_str.c_str(), -1, &statement, 0);
-	if(rc != SQLITE_OK) {
-		sqlite3_finalize(statement);
+	statement = cachedStatement(database, "SELECT id FROM " + getTableName() + ";");
+	if(statement == NULL) {
 		return ret;
 	}
 
 	while((rc = sqlite3_step(statement)) == SQLITE_ROW) 
 		ret.push_back(sqlite3_column_int64(statement, 0));
 
-	sqlite3_finalize(statement);
+	sqlite3_reset(statement);
 	return ret;
 }
+
+sqlite3_stmt *Archivable::scanAllObjects(sqlite3 *database) {
+	// the id comes last, so that the object's columns start at 0
+	return cachedStatement(database, "SELECT " + selectObjectColumnListStr() + ", id FROM " + getTableName() + " ORDER BY id;");
+}
+
+bool Archivable::unarchiveNextObject(sqlite3_stmt *scan) {
+	if(sqlite3_step(scan) != SQLITE_ROW) {
+		sqlite3_reset(scan);
+		return false;
+	}
+
+	id = sqlite3_column_int64(scan, sqlite3_column_count(scan) - 1);
+	updateObjectFromStatement(scan);
+	return true;
+}
+
+// ArchiveSession
+ArchiveSession::ArchiveSession(sqlite3 *database): _database(database), _active(false) {
+	_active = sqlite3_exec(_database, "SAVEPOINT archive_session;", NULL, NULL, NULL) == SQLITE_OK;
+}
+
+ArchiveSession::~ArchiveSession() {
+	rollback();
+}
+
+bool ArchiveSession::commit() {
+	if(not _active)
+		return false;
+
+	if(sqlite3_exec(_database, "RELEASE archive_session;", NULL, NULL, NULL) != SQLITE_OK)
+		return false;
+
+	_active = false;
+	return true;
+}
+
+void ArchiveSession::rollback() {
+	if(not _active)
+		return;
+
+	sqlite3_exec(_database, "ROLLBACK TO archive_session; RELEASE archive_session;", NULL, NULL, NULL);
+	_active = false;
+
+	// tables created during the session may be gone
+	pthread_mutex_lock(&_statementCachesLock);
+	StatementCache_map::iterator cache = _statementCaches.find(_database);
+	if(cache != _statementCaches.end())
+		cache->second.tables.clear();
+	pthread_mutex_unlock(&_statementCachesLock);
+}
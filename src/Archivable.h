@@ -81,6 +81,15 @@ namespace SubcloneSeeker {
 			 */
 			virtual std::string createTableStatementStr() = 0;
 
+			/**
+			 * return the columns to be indexed when creating the table, so that
+			 * looking up records by any of these columns does not scan the whole
+			 * table. Each column gets its own index. No column is indexed by default
+			 *
+			 * @return The names of the columns to be indexed
+			 */
+			virtual std::vector<std::string> indexedColumnList() {return std::vector<std::string>();}
+
 			/**
 			 * return the unbound statement for record creation
 			 * @return unbound statement for record creation
@@ -119,12 +128,44 @@ namespace SubcloneSeeker {
 			 */
 			virtual void updateObjectFromStatement(sqlite3_stmt *statement) = 0;
 
+			/**
+			 * Get a prepared statement from the statement cache of a database
+			 * connection. The statement is prepared on first use only, and is
+			 * handed out reset and with all its bindings cleared. The caller
+			 * must reset it after use and must not finalize it.
+			 *
+			 * Statements are keyed by their SQL text, which identifies the table
+			 * and the operation. A connection, and hence its cached statements,
+			 * must not be used by several threads at the same time.
+			 *
+			 * @param database An open sqlite3 database connection handle
+			 * @param sql The SQL text of the statement
+			 * @return The prepared statement, or NULL if it could not be prepared
+			 */
+			static sqlite3_stmt *cachedStatement(sqlite3 *database, const std::string& sql);
+
+			/**
+			 * Check if the storage table exists in the database, creating it
+			 * if not. The outcome is remembered for the connection, so that
+			 * sqlite_master is only queried once per table.
+			 *
+			 * @param database An open sqlite3 database connection handle
+			 * @return Whether the table exists
+			 */
+			bool ensureTableInDB(sqlite3 *database);
+
 		public:
 			/**
 			 * Minimal constructor to reset all member variables
 			 */
 			Archivable() : id(0) {;}
 
+			/**
+			 * Destructor. Virtual, as archivable objects such as the members
+			 * of an EventCluster are deleted through base class pointers
+			 */
+			virtual ~Archivable() {}
+
 			/**
 			 * get access function of id
 			 * @return the database identifier of the object
@@ -145,6 +186,15 @@ namespace SubcloneSeeker {
 			 */
 			bool createTableInDB(sqlite3 *database);
 
+			/**
+			 * Create the indexes declared by indexedColumnList, unless they exist.
+			 * Called by createTableInDB, and can be used to add the indexes to
+			 * a database created before they were declared
+			 * @param database An open sqlite3 database connection handle
+			 * @return Whether the operation is successful or not
+			 */
+			bool createIndexesInDB(sqlite3 *database);
+
 			/**
 			 * Archive the object into the database
 			 * @param database An open sqlite3 database connection handle
@@ -167,6 +217,108 @@ namespace SubcloneSeeker {
 			 */
 			DBObjectID_vec vecAllObjectsID(sqlite3 *database);
 
+			/**
+			 * Start a scan over all records of the current object's class, in the
+			 * order of their ids. The records are read one after the other with
+			 * unarchiveNextObject, so that a whole table is unarchived with a
+			 * single query.
+			 *
+			 * @param database An open sqlite3 database connection handle
+			 * @return The statement of the scan, or NULL if the table cannot be read
+			 */
+			sqlite3_stmt *scanAllObjects(sqlite3 *database);
+
+			/**
+			 * Unarchive the next record of a scan into the object
+			 *
+			 * @param scan A statement returned by scanAllObjects on an object of the same class
+			 * @return Whether a record has been read; false at the end of the scan, after which
+			 * the statement must not be used anymore
+			 */
+			bool unarchiveNextObject(sqlite3_stmt *scan);
+
+			/**
+			 * Finalize the cached statements of a database connection and
+			 * forget which tables it holds. Must be called before the
+			 * connection is closed; closeDatabase does it.
+			 *
+			 * @param database A sqlite3 database connection handle
+			 */
+			static void releaseCachedStatements(sqlite3 *database);
+
+			/**
+			 * Release the cached statements of a database connection, and
+			 * close it. Use it instead of sqlite3_close on any connection
+			 * that Archivable objects have been used with.
+			 *
+			 * @param database The sqlite3 database connection handle, may be NULL
+			 * @return The result code of sqlite3_close
+			 */
+			static int closeDatabase(sqlite3 *database);
+
+			/**
+			 * Configure a database connection for writing many objects: the
+			 * database is switched to write-ahead logging, with a 4KB page size
+			 * if it is still empty, and is synced to disk at checkpoints only.
+			 * A crash may lose the last transactions, but cannot corrupt the
+			 * database.
+			 *
+			 * @param database An open, writable sqlite3 database connection handle
+			 * @return Whether the operation is successful or not
+			 */
+			static bool tuneDatabaseForWriting(sqlite3 *database);
+
+	};
+
+	/**
+	 * @brief A unit of work that archives many objects in one transaction
+	 *
+	 * Outside of a transaction, every archiveObjectToDB call is committed, and
+	 * synced to disk, on its own. A session opens a transaction when it is
+	 * created, so that all the objects archived to the database until commit()
+	 * is called are written at once. If the session is destroyed without
+	 * being committed, everything archived since its creation is rolled back.
+	 *
+	 * Sessions are implemented with savepoints and can be nested, e.g. one
+	 * session per tree within one session per tree set. Only the outermost
+	 * commit writes to the database; an inner rollback only undoes the work
+	 * of the inner session.
+	 */
+	class ArchiveSession {
+		protected:
+			sqlite3 *_database; /**< the database connection of the session */
+			bool _active; /**< whether the session is still open */
+
+		public:
+			/**
+			 * Constructor. Opens the session
+			 * @param database An open sqlite3 database connection handle
+			 */
+			ArchiveSession(sqlite3 *database);
+
+			/**
+			 * Destructor. Rolls the session back unless it has been committed
+			 */
+			~ArchiveSession();
+
+			/**
+			 * @return Whether the session is open, i.e. has been started and
+			 * has not been committed or rolled back yet
+			 */
+			inline bool isActive() const {return _active;}
+
+			/**
+			 * Commit the work of the session. If it fails, e.g. because the
+			 * database is busy, the session is left open so that the commit
+			 * can be retried
+			 * @return Whether the operation is successful or not
+			 */
+			bool commit();
+
+			/**
+			 * Undo the work of the session and close it
+			 */
+			void rollback();
 	};
 }
 
@@ -9,38 +9,110 @@
 #include "SomaticEvent.h"
 #include "SegmentalMutation.h"
 #include <cmath>
+#include <algorithm>
+#include <set>
+#include <utility>
 
 using namespace SubcloneSeeker;
 
+unsigned long EventCluster::eventLength(SomaticEvent *event) {
+	SegmentalMutation *asSeg = dynamic_cast<SegmentalMutation *>(event);
+	if(asSeg != NULL)
+		return asSeg->range.length;
+	return 1;
+}
+
+/**
+ * @return The first slot to look an event up at, in a hash table of mask+1 slots
+ */
+static inline size_t MemberSlot(SomaticEvent *event, size_t mask) {
+	return ((reinterpret_cast<size_t>(event) >> 4) * 2654435761UL) & mask;
+}
+
+bool EventCluster::isMember(SomaticEvent *event) {
+	// small clusters are scanned, larger ones get a hash table once
+	if(_members.size() <= EVENT_CLUSTER_LINEAR_MEMBERS)
+		return std::find(_members.begin(), _members.end(), event) != _members.end();
+
+	if(_memberSlots.empty())
+		rebuildMemberSlots();
+
+	size_t mask = _memberSlots.size() - 1;
+	for(size_t slot = MemberSlot(event, mask); _memberSlots[slot] != NULL; slot = (slot + 1) & mask) {
+		if(_memberSlots[slot] == event)
+			return true;
+	}
+	return false;
+}
+
+void EventCluster::appendMember(SomaticEvent *event) {
+	_members.push_back(event);
+	if(_memberSlots.empty())
+		return;
+
+	// keep the load of the table at most one half
+	if(2 * _members.size() > _memberSlots.size())
+		rebuildMemberSlots();
+	else
+		insertMemberSlot(event);
+}
+
+void EventCluster::insertMemberSlot(SomaticEvent *event) {
+	size_t mask = _memberSlots.size() - 1;
+	size_t slot = MemberSlot(event, mask);
+	while(_memberSlots[slot] != NULL)
+		slot = (slot + 1) & mask;
+	_memberSlots[slot] = event;
+}
+
+void EventCluster::rebuildMemberSlots() {
+	size_t numSlots = 2 * EVENT_CLUSTER_LINEAR_MEMBERS;
+	while(numSlots < 4 * _members.size())
+		numSlots *= 2;
+
+	_memberSlots.assign(numSlots, NULL);
+	for(size_t i=0; i<_members.size(); i++)
+		insertMemberSlot(_members[i]);
+}
+
 void EventCluster::addEvent(SomaticEvent *event, bool updateFraction) {
 	// check if the event already is a member
-	for(size_t i=0; i<_members.size(); i++) {
-		if(_members[i] == event) {
-			return;
-		}
-	}
+	if(isMember(event))
+		return;
 
+	unsigned long thisLen = eventLength(event);
 	if(updateFraction) {
-		unsigned long oldLen = 0;
-		for(size_t i=0; i<_members.size(); i++) {
-			SegmentalMutation *asSeg = dynamic_cast<SegmentalMutation *>(_members[i]);
-			if(asSeg != NULL) {
-				oldLen += asSeg->range.length;
-			}
-			else
-				oldLen += 1;
-		}
-		unsigned long thisLen;
-		SegmentalMutation *asSeg = dynamic_cast<SegmentalMutation *>(event);
-		if(asSeg != NULL)
-			thisLen = asSeg->range.length;
-		else
-			thisLen = 1;
+		_cellFraction = (_cellFraction * _totalLength + event->frequency * thisLen) / (_totalLength + thisLen);
+	}
+
+	_totalLength += thisLen;
+	appendMember(event);
+}
 
-		_cellFraction = (_cellFraction * oldLen + event->frequency * thisLen) / (oldLen + thisLen);
+void EventCluster::addEvents(const std::vector<SomaticEvent *>& events, bool updateFraction) {
+	for(size_t i=0; i<events.size(); i++)
+		addEvent(events[i], updateFraction);
+}
+
+bool EventCluster::removeEvent(SomaticEvent *event, bool updateFraction) {
+	std::vector<SomaticEvent *>::iterator it = std::find(_members.begin(), _members.end(), event);
+	if(it == _members.end())
+		return false;
+
+	unsigned long thisLen = eventLength(event);
+	if(updateFraction) {
+		if(_totalLength > thisLen)
+			_cellFraction = (_cellFraction * _totalLength - event->frequency * thisLen) / (_totalLength - thisLen);
+		else if(_members.size() == 1)
+			_cellFraction = 0;
 	}
 
-	_members.push_back(event);
+	_totalLength -= thisLen;
+	_members.erase(it);
+
+	// the table is built again when it is needed
+	_memberSlots.clear();
+	return true;
 }
 
 std::vector<EventCluster *> EventCluster::clustering(const std::vector<SomaticEvent *>& events, double threshold) {
@@ -79,22 +151,64 @@ std::vector<EventCluster *> EventCluster::clustering(const std::vector<SomaticEv
 	return clusters;
 }
 
+std::vector<EventCluster *> EventCluster::sortedClustering(const std::vector<SomaticEvent *>& events, double threshold) {
+	std::vector<EventCluster *> clusters;
+
+	if(threshold < 0 || threshold > 1)
+		return clusters;
+
+	// Sort the events by frequency, ties in input order
+	std::vector<std::pair<double, size_t> > order;
+	order.reserve(events.size());
+	for(size_t eventIdx = 0; eventIdx < events.size(); eventIdx++)
+		order.push_back(std::make_pair(events[eventIdx]->frequency, eventIdx));
+	std::sort(order.begin(), order.end());
+
+	std::set<SomaticEvent *> seen;
+	EventCluster *currentCluster = NULL;
+	double weightedSum = 0, plainSum = 0;
+
+	for(size_t i = 0; i < order.size(); i++) {
+		SomaticEvent *currentEvent = events[order[i].second];
+
+		// an event is only clustered once
+		if(not seen.insert(currentEvent).second)
+			continue;
+
+		if(currentCluster == NULL || fabs(currentEvent->frequency - currentCluster->_cellFraction) > threshold) {
+			currentCluster = new EventCluster();
+			clusters.push_back(currentCluster);
+			weightedSum = plainSum = 0;
+		}
+
+		unsigned long length = eventLength(currentEvent);
+		weightedSum += currentEvent->frequency * length;
+		plainSum += currentEvent->frequency;
+		currentCluster->_totalLength += length;
+		currentCluster->appendMember(currentEvent);
+
+		// members of no length are weighted equally
+		if(currentCluster->_totalLength > 0)
+			currentCluster->_cellFraction = weightedSum / currentCluster->_totalLength;
+		else
+			currentCluster->_cellFraction = plainSum / currentCluster->_members.size();
+	}
+	return clusters;
+}
+
 DBObjectID_vec EventCluster::allObjectsOfSubclone(sqlite3 *database, sqlite3_int64 subcloneID) {
 	sqlite3_stmt* st;
 	int rc;
 	DBObjectID_vec res_vec;
 
-	std::string queryStr = "SELECT id FROM " + getTableName() + " WHERE ofSubcloneID=?";
-
-	rc = sqlite3_prepare_v2(database, queryStr.c_str(), -1, &st, 0);
-	if(rc != SQLITE_OK) {
-		sqlite3_finalize(st);
+	st = cachedStatement(database, "SELECT id FROM " + getTableName() + " WHERE ofSubcloneID=?");
+	if(st == NULL) {
 		return res_vec;
 	}
 
 	rc = sqlite3_bind_int64(st, 1, subcloneID);
 	if(rc != SQLITE_OK) {
-		sqlite3_finalize(st);
+		sqlite3_reset(st);
 		return res_vec;
 	}
 
@@ -104,7 +218,7 @@ DBObjectID_vec EventCluster::allObjectsOfSubclone(sqlite3 *database, sqlite3_int
 		res_vec.push_back(newID);
 	}
 
-	sqlite3_finalize(st);
+	sqlite3_reset(st);
 	return(res_vec);
 }
 
@@ -120,6 +234,10 @@ std::string EventCluster::createTableStatementStr() {
 	return ", fraction REAL NOT NULL, ofSubcloneID INTEGER NULL REFERENCES Subclone(id)";
 }
 
+std::vector<std::string> EventCluster::indexedColumnList() {
+	return std::vector<std::string>(1, "ofSubcloneID");
+}
+
 std::string EventCluster::createObjectStatementStr() {
 	return "INSERT INTO Clusters (fraction, ofSubcloneID) VALUES (?,?);";
 }
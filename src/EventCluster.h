@@ -34,6 +34,12 @@ THE SOFTWARE.
 #include "Archivable.h"
 #include <vector>
 
+/**
+ * The number of members up to which the members of an EventCluster are
+ * looked up by a linear scan rather than through a hash table
+ */
+#define EVENT_CLUSTER_LINEAR_MEMBERS 16
+
 namespace SubcloneSeeker {
 
 	// Forward declaration of SomaticEvent so that pointers can be made
@@ -51,14 +57,43 @@ namespace SubcloneSeeker {
 	class EventCluster : public Archivable {
 		protected:
 			std::vector<SomaticEvent *> _members; /**< the vector that holds all the cluster's members */
+			std::vector<SomaticEvent *> _memberSlots; /**< open addressing hash table of the members, empty until there are many */
 			double _cellFraction; /**< the cell fraction all members share */
+			unsigned long _totalLength; /**< the cumulative length of all members */
 			
 			sqlite3_int64 ofSubcloneID; /**< to which subclone does this cluster belongs */
 
+			/**
+			 * @param event An event
+			 * @return If the event is a member of the cluster
+			 */
+			bool isMember(SomaticEvent *event);
+
+			/**
+			 * Append an event to the member list, keeping the hash table of
+			 * the members up to date. The event must not be a member yet.
+			 *
+			 * @param event The event
+			 */
+			void appendMember(SomaticEvent *event);
+
+			/**
+			 * Put an event into the hash table of the members
+			 *
+			 * @param event The event
+			 */
+			void insertMemberSlot(SomaticEvent *event);
+
+			/**
+			 * Rebuild the hash table of the members, with room for twice as many
+			 */
+			void rebuildMemberSlots();
+
 		protected:
 			// Implements Archivable
 			virtual std::string getTableName();
 			virtual std::string createTableStatementStr();
+			virtual std::vector<std::string> indexedColumnList();
 			virtual std::string createObjectStatementStr();
 			virtual std::string updateObjectStatementStr();
 			virtual std::string selectObjectColumnListStr();
@@ -70,14 +105,14 @@ namespace SubcloneSeeker {
 			/**
 			 * Minimal constructor that resets all member variables
 			 */
-			EventCluster() : Archivable(), _cellFraction(0), ofSubcloneID(0) {;}
+			EventCluster() : Archivable(), _cellFraction(0), _totalLength(0), ofSubcloneID(0) {;}
 
 			/**
 			 * Retrieve the member vector reference
 			 *
-			 * @return a reference to the members vector
+			 * @return a reference to the members vector, valid until the members change
 			 */
-			inline std::vector<SomaticEvent *> members() const {return _members;}
+			inline const std::vector<SomaticEvent *>& members() const {return _members;}
 
 			/**
 			 * Retrieve the cell fraction
@@ -93,6 +128,15 @@ namespace SubcloneSeeker {
 			 */
 			inline void setCellFraction(double fraction) {_cellFraction = fraction;}
 
+			/**
+			 * Retrieve the cumulative length of the members, by which their
+			 * frequencies are weighted in the cell fraction. Segmental events
+			 * count for the length of their range, other events for 1.
+			 *
+			 * @return The cumulative length of all members
+			 */
+			inline unsigned long totalLength() const {return _totalLength;}
+
 			/**
 			 * Add an SomaticEvent object into the member list and update cell fraction
 			 *
@@ -101,8 +145,23 @@ namespace SubcloneSeeker {
 			 */
 			void addEvent(SomaticEvent * event, bool updateFraction = true);
 
-			// Removing an event is such a rare case that, although trivial, it's not yet implemented
-			
+			/**
+			 * Add SomaticEvent objects into the member list and update cell fraction.
+			 * This is the same as adding the events one by one.
+			 *
+			 * @param events The events to be added as members
+			 * @param updateFraction Should the method automatically update the cell fraction of the cluster
+			 */
+			void addEvents(const std::vector<SomaticEvent *>& events, bool updateFraction = true);
+
+			/**
+			 * Remove an SomaticEvent object from the member list and update cell fraction
+			 *
+			 * @param event The event to be removed
+			 * @param updateFraction Should the method automatically update the cell fraction of the cluster
+			 * @return false if the event is not a member
+			 */
+			bool removeEvent(SomaticEvent * event, bool updateFraction = true);
 
 			/** 
 			 * Override the < operator for sorting purpose
@@ -127,6 +186,16 @@ namespace SubcloneSeeker {
 			 */
 			inline void setSubcloneID(sqlite3_int64 cloneID) { ofSubcloneID = cloneID; }
 
+			/**
+			 * The length an event weighs in the cell fraction of its cluster.
+			 * Segmental events count for the length of their range, other
+			 * events for 1.
+			 *
+			 * @param event The event
+			 * @return The weight of the event
+			 */
+			static unsigned long eventLength(SomaticEvent *event);
+
 			/**
 			 * SomaticEvent Clustering Algorithm
 			 * @param events A vector of SomaticEvent to be clustered
@@ -135,6 +204,22 @@ namespace SubcloneSeeker {
 			 */
 			static std::vector<EventCluster *> clustering(const std::vector<SomaticEvent *>& events, double threshold);
 
+			/**
+			 * One-dimensional SomaticEvent clustering over the event frequencies.
+			 *
+			 * The events are sorted by frequency and swept in order. An event
+			 * joins the current cluster if its frequency is within threshold of
+			 * the cluster's length-weighted centroid, and starts a new cluster
+			 * otherwise. The centroid is kept as a running aggregate, so that
+			 * clustering takes O(n log n) time. The clusters are returned by
+			 * ascending cell fraction, and their members by ascending frequency.
+			 *
+			 * @param events A vector of SomaticEvent to be clustered
+			 * @param threshold The difference threshold to use when doing the clustering
+			 * @return A vector of EventCluster containing the resulting clusters
+			 */
+			static std::vector<EventCluster *> sortedClustering(const std::vector<SomaticEvent *>& events, double threshold);
+
 			/**
 			 * Retrieve the subclone ID
 			 *
@@ -0,0 +1,401 @@
+/**
+ * @file EventClusterer.cc
+ * Implementation of the clustering methods of SomaticEvents
+ *
+ * @author Yi Qiao
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013 Yi Qiao
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "EventClusterer.h"
+#include <algorithm>
+#include <set>
+#include <utility>
+#include <limits>
+#include <pthread.h>
+
+using namespace SubcloneSeeker;
+
+EventClusterPtr_vec GreedyEventClusterer::cluster(const SomaticEventPtr_vec& events) {
+	return EventCluster::clustering(events, _threshold);
+}
+
+EventClusterPtr_vec SortedEventClusterer::cluster(const SomaticEventPtr_vec& events) {
+	return EventCluster::sortedClustering(events, _threshold);
+}
+
+void EventDendrogram::build(const SomaticEventPtr_vec& events) {
+	// Sort the distinct events by frequency, ties in input order
+	std::set<SomaticEvent *> seen;
+	std::vector<std::pair<double, size_t> > order;
+	order.reserve(events.size());
+	for(size_t eventIdx = 0; eventIdx < events.size(); eventIdx++)
+		if(seen.insert(events[eventIdx]).second)
+			order.push_back(std::make_pair(events[eventIdx]->frequency, eventIdx));
+	std::sort(order.begin(), order.end());
+
+	size_t n = order.size();
+	_events.resize(n);
+	_frequencies.resize(n);
+	_sumX.assign(n + 1, 0);
+	_sumW.assign(n + 1, 0);
+	_sumWX.assign(n + 1, 0);
+	_heights.clear();
+	for(size_t i=0; i<n; i++) {
+		_events[i] = events[order[i].second];
+		double x = _frequencies[i] = order[i].first;
+		double w = EventCluster::eventLength(_events[i]);
+		_sumX[i+1] = _sumX[i] + x;
+		_sumW[i+1] = _sumW[i] + w;
+		_sumWX[i+1] = _sumWX[i] + w * x;
+		if(i > 0)
+			_heights.push_back(x - order[i-1].first);
+	}
+	std::sort(_heights.begin(), _heights.end());
+}
+
+size_t EventDendrogram::numClusters(double threshold) const {
+	if(_events.empty())
+		return 0;
+	return 1 + (_heights.end() - std::upper_bound(_heights.begin(), _heights.end(), threshold));
+}
+
+EventClusterPtr_vec EventDendrogram::cut(double threshold) const {
+	EventClusterPtr_vec clusters;
+
+	if(threshold < 0 || threshold > 1)
+		return clusters;
+
+	size_t begin = 0;
+	for(size_t end = 1; end <= _events.size(); end++) {
+		if(end < _events.size() && _frequencies[end] - _frequencies[end-1] <= threshold)
+			continue;
+
+		EventCluster *newCluster = new EventCluster();
+		newCluster->addEvents(SomaticEventPtr_vec(_events.begin() + begin, _events.begin() + end), false);
+
+		// members of no length are weighted equally
+		double weight = _sumW[end] - _sumW[begin];
+		if(weight > 0)
+			newCluster->setCellFraction((_sumWX[end] - _sumWX[begin]) / weight);
+		else
+			newCluster->setCellFraction((_sumX[end] - _sumX[begin]) / (end - begin));
+
+		clusters.push_back(newCluster);
+		begin = end;
+	}
+
+	return clusters;
+}
+
+EventClusterPtr_vec LinkageEventClusterer::cluster(const SomaticEventPtr_vec& events) {
+	EventDendrogram dendrogram;
+	dendrogram.build(events);
+	return dendrogram.cut(_threshold);
+}
+
+/**
+ * @brief The events of a k-means clustering, sorted by frequency
+ *
+ * The frequencies and weights are kept in flat arrays, along with their
+ * prefix sums, so that the centroid of any run of events is found in
+ * constant time. Once built, the data is only read, and is shared by all
+ * the restarts.
+ */
+struct KMeansData {
+	std::vector<double> x; /**< the frequencies, ascending */
+	std::vector<double> w; /**< the weights */
+	std::vector<double> sumX; /**< prefix sums of the frequencies */
+	std::vector<double> sumW; /**< prefix sums of the weights */
+	std::vector<double> sumWX; /**< prefix sums of the weighted frequencies */
+
+	/**
+	 * The centroid of the events [begin, end), which must not be empty.
+	 * Runs of no weight are averaged with equal weights.
+	 */
+	inline double centroid(size_t begin, size_t end) const {
+		double weight = sumW[end] - sumW[begin];
+		if(weight > 0)
+			return (sumWX[end] - sumWX[begin]) / weight;
+		return (sumX[end] - sumX[begin]) / (end - begin);
+	}
+};
+
+/**
+ * @brief The outcome of one restart
+ */
+struct KMeansRun {
+	std::vector<double> centroids; /**< the centroids, ascending */
+	std::vector<size_t> bounds; /**< cluster j is made of the events [bounds[j], bounds[j+1]) */
+	double cost; /**< the weighted sum of squares */
+};
+
+/**
+ * @brief The work shared by the threads of a k-means clustering
+ */
+struct KMeansJob {
+	const KMeansData *data; /**< the events */
+	size_t numClusters; /**< the number of clusters wanted */
+	unsigned long seed; /**< the seed of the pseudo-random sequences */
+	int maxIterations; /**< the maximum number of Lloyd iterations */
+	std::vector<KMeansRun> *runs; /**< the outcome of every restart */
+	size_t nextRestart; /**< the next restart to be run */
+	pthread_mutex_t lock; /**< protects nextRestart */
+};
+
+/**
+ * Draw the next number of a xorshift sequence
+ *
+ * @param state The state of the sequence, which must not be 0
+ * @return A number uniformly distributed in [0, 1)
+ */
+static inline double KMeansRandom(unsigned int& state) {
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state / 4294967296.0;
+}
+
+/**
+ * Pick an event with a probability proportional to its score
+ *
+ * @param score The score of every event
+ * @param total The sum of the scores, which must be positive
+ * @param state The state of the pseudo-random sequence
+ * @return The index of the event picked
+ */
+static size_t KMeansPick(const std::vector<double>& score, double total, unsigned int& state) {
+	double target = KMeansRandom(state) * total;
+	size_t last = 0;
+	for(size_t i=0; i<score.size(); i++) {
+		if(score[i] <= 0)
+			continue;
+		last = i;
+		target -= score[i];
+		if(target < 0)
+			return i;
+	}
+	return last;
+}
+
+/**
+ * Seed the centroids by k-means++. Seeding stops early if every event
+ * already sits on a centroid.
+ *
+ * @param data The events
+ * @param numClusters The number of centroids wanted
+ * @param state The state of the pseudo-random sequence
+ * @param centroids Receives the distinct centroids, ascending
+ */
+static void KMeansSeed(const KMeansData& data, size_t numClusters, unsigned int& state, std::vector<double>& centroids) {
+	size_t n = data.x.size();
+	std::vector<double> dist(n, std::numeric_limits<double>::max());
+	std::vector<double> score(n);
+
+	centroids.clear();
+	double total = data.sumW[n];
+	size_t next = total > 0 ? KMeansPick(data.w, total, state) : (size_t)(KMeansRandom(state) * n);
+
+	while(true) {
+		double c = data.x[next];
+		centroids.push_back(c);
+		if(centroids.size() == numClusters)
+			break;
+
+		// squared distance to the nearest centroid, weighted
+		total = 0;
+		double plainTotal = 0;
+		for(size_t i=0; i<n; i++) {
+			double d = (data.x[i] - c) * (data.x[i] - c);
+			if(d < dist[i])
+				dist[i] = d;
+			score[i] = data.w[i] * dist[i];
+			total += score[i];
+			plainTotal += dist[i];
+		}
+
+		if(total > 0)
+			next = KMeansPick(score, total, state);
+		else if(plainTotal > 0)
+			next = KMeansPick(dist, plainTotal, state);
+		else
+			break;
+	}
+
+	std::sort(centroids.begin(), centroids.end());
+	centroids.erase(std::unique(centroids.begin(), centroids.end()), centroids.end());
+}
+
+/**
+ * Run Lloyd iterations from seeded centroids until the clusters no longer
+ * change. The centroids stay strictly ascending, so that an event belongs
+ * to cluster j if it lies between the midpoints of centroid j and its
+ * neighbours, ties going to the upper cluster.
+ *
+ * @param data The events
+ * @param maxIterations The maximum number of iterations
+ * @param run Holds the seeded centroids, and receives the outcome
+ */
+static void KMeansLloyd(const KMeansData& data, int maxIterations, KMeansRun& run) {
+	size_t n = data.x.size();
+	size_t k = run.centroids.size();
+	std::vector<size_t> bounds(k + 1, 0);
+	bounds[k] = n;
+	run.bounds.clear();
+
+	for(int iter=0; iter<maxIterations; iter++) {
+		for(size_t j=1; j<k; j++) {
+			double mid = (run.centroids[j-1] + run.centroids[j]) / 2;
+			bounds[j] = std::lower_bound(data.x.begin() + bounds[j-1], data.x.end(), mid) - data.x.begin();
+		}
+
+		if(bounds == run.bounds)
+			break;
+		run.bounds = bounds;
+
+		for(size_t j=0; j<k; j++)
+			if(bounds[j] < bounds[j+1])
+				run.centroids[j] = data.centroid(bounds[j], bounds[j+1]);
+	}
+
+	run.cost = 0;
+	for(size_t j=0; j<k; j++) {
+		double c = run.centroids[j];
+		for(size_t i=run.bounds[j]; i<run.bounds[j+1]; i++)
+			run.cost += data.w[i] * (data.x[i] - c) * (data.x[i] - c);
+	}
+}
+
+/**
+ * Run restarts until there is none left
+ *
+ * @param arg The KMeansJob
+ */
+static void *KMeansWorker(void *arg) {
+	KMeansJob *job = static_cast<KMeansJob *>(arg);
+
+	while(true) {
+		pthread_mutex_lock(&job->lock);
+		size_t r = job->nextRestart++;
+		pthread_mutex_unlock(&job->lock);
+
+		if(r >= job->runs->size())
+			break;
+
+		unsigned int state = (unsigned int)(job->seed * 2654435761UL + (r + 1) * 40503UL);
+		if(state == 0)
+			state = 1;
+
+		KMeansRun& run = (*job->runs)[r];
+		KMeansSeed(*job->data, job->numClusters, state, run.centroids);
+		KMeansLloyd(*job->data, job->maxIterations, run);
+	}
+
+	return NULL;
+}
+
+EventClusterPtr_vec KMeansEventClusterer::cluster(const SomaticEventPtr_vec& events) {
+	EventClusterPtr_vec clusters;
+
+	if(_numClusters == 0 || _numRestarts < 1)
+		return clusters;
+
+	// Sort the distinct events by frequency, ties in input order
+	std::set<SomaticEvent *> seen;
+	std::vector<std::pair<double, size_t> > order;
+	order.reserve(events.size());
+	for(size_t eventIdx = 0; eventIdx < events.size(); eventIdx++)
+		if(seen.insert(events[eventIdx]).second)
+			order.push_back(std::make_pair(events[eventIdx]->frequency, eventIdx));
+	std::sort(order.begin(), order.end());
+
+	size_t n = order.size();
+	if(n == 0)
+		return clusters;
+
+	KMeansData data;
+	data.x.resize(n);
+	data.w.resize(n);
+	data.sumX.assign(n + 1, 0);
+	data.sumW.assign(n + 1, 0);
+	data.sumWX.assign(n + 1, 0);
+	for(size_t i=0; i<n; i++) {
+		data.x[i] = order[i].first;
+		data.w[i] = EventCluster::eventLength(events[order[i].second]);
+		data.sumX[i+1] = data.sumX[i] + data.x[i];
+		data.sumW[i+1] = data.sumW[i] + data.w[i];
+		data.sumWX[i+1] = data.sumWX[i] + data.w[i] * data.x[i];
+	}
+
+	std::vector<KMeansRun> runs(_numRestarts);
+
+	KMeansJob job;
+	job.data = &data;
+	job.numClusters = _numClusters;
+	job.seed = _seed;
+	job.maxIterations = _maxIterations;
+	job.runs = &runs;
+	job.nextRestart = 0;
+	pthread_mutex_init(&job.lock, NULL);
+
+	int numThreads = _numThreads;
+	if(numThreads > _numRestarts)
+		numThreads = _numRestarts;
+
+	if(numThreads <= 1) {
+		KMeansWorker(&job);
+	}
+	else {
+		std::vector<pthread_t> threads(numThreads);
+		for(int t=0; t<numThreads; t++)
+			pthread_create(&threads[t], NULL, KMeansWorker, &job);
+		for(int t=0; t<numThreads; t++)
+			pthread_join(threads[t], NULL);
+	}
+
+	pthread_mutex_destroy(&job.lock);
+
+	size_t best = 0;
+	for(size_t r=1; r<runs.size(); r++)
+		if(runs[r].cost < runs[best].cost)
+			best = r;
+
+	const KMeansRun& run = runs[best];
+	for(size_t j=0; j+1<run.bounds.size(); j++) {
+		if(run.bounds[j] == run.bounds[j+1])
+			continue;
+
+		SomaticEventPtr_vec members;
+		members.reserve(run.bounds[j+1] - run.bounds[j]);
+		for(size_t i=run.bounds[j]; i<run.bounds[j+1]; i++)
+			members.push_back(events[order[i].second]);
+
+		EventCluster *newCluster = new EventCluster();
+		newCluster->addEvents(members, false);
+		newCluster->setCellFraction(data.centroid(run.bounds[j], run.bounds[j+1]));
+		clusters.push_back(newCluster);
+	}
+
+	return clusters;
+}
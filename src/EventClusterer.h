@@ -0,0 +1,229 @@
+#ifndef EVENT_CLUSTERER_H
+#define EVENT_CLUSTERER_H
+
+/**
+ * @file EventClusterer.h
+ * Interface description of the clustering methods of SomaticEvents
+ *
+ * @author Yi Qiao
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013 Yi Qiao
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <vector>
+#include "EventCluster.h"
+#include "SomaticEvent.h"
+
+namespace SubcloneSeeker {
+
+	/**
+	 * @brief Abstract clustering method of SomaticEvents
+	 *
+	 * A clusterer groups SomaticEvents by their frequencies into
+	 * EventClusters. The clusters returned are newly allocated and owned by
+	 * the caller, while the events are only referred to. Each event is put
+	 * into one cluster only, even if it is given more than once.
+	 */
+	class EventClusterer {
+		public:
+			/**
+			 * Destructor
+			 */
+			virtual ~EventClusterer() {}
+
+			/**
+			 * Cluster SomaticEvents
+			 *
+			 * @param events A vector of SomaticEvent to be clustered
+			 * @return A vector of EventCluster containing the resulting clusters
+			 */
+			virtual EventClusterPtr_vec cluster(const SomaticEventPtr_vec& events) = 0;
+	};
+
+	/**
+	 * @brief Clustering in input order
+	 *
+	 * @see EventCluster::clustering
+	 */
+	class GreedyEventClusterer : public EventClusterer {
+		protected:
+			double _threshold; /**< the difference threshold of the clustering */
+
+		public:
+			/**
+			 * Constructor
+			 *
+			 * @param threshold The difference threshold to use when doing the clustering
+			 */
+			GreedyEventClusterer(double threshold): _threshold(threshold) {}
+
+			virtual EventClusterPtr_vec cluster(const SomaticEventPtr_vec& events);
+	};
+
+	/**
+	 * @brief Clustering in frequency order
+	 *
+	 * @see EventCluster::sortedClustering
+	 */
+	class SortedEventClusterer : public EventClusterer {
+		protected:
+			double _threshold; /**< the difference threshold of the clustering */
+
+		public:
+			/**
+			 * Constructor
+			 *
+			 * @param threshold The difference threshold to use when doing the clustering
+			 */
+			SortedEventClusterer(double threshold): _threshold(threshold) {}
+
+			virtual EventClusterPtr_vec cluster(const SomaticEventPtr_vec& events);
+	};
+
+	/**
+	 * @brief Single-linkage dendrogram of the event frequencies
+	 *
+	 * In one dimension, single-linkage clustering merges the events in
+	 * order of the gaps between consecutive frequencies. Cutting the
+	 * dendrogram at a threshold therefore splits the events, sorted by
+	 * frequency, wherever two consecutive frequencies are more than the
+	 * threshold apart. The dendrogram is built once, and can then be cut at
+	 * any number of thresholds. The cluster fractions are length-weighted,
+	 * as those of an EventCluster, and are taken from prefix sums.
+	 */
+	class EventDendrogram {
+		protected:
+			SomaticEventPtr_vec _events; /**< the distinct events, by ascending frequency */
+			std::vector<double> _frequencies; /**< the frequencies of the events when the dendrogram was built */
+			std::vector<double> _sumX; /**< prefix sums of the frequencies */
+			std::vector<double> _sumW; /**< prefix sums of the weights */
+			std::vector<double> _sumWX; /**< prefix sums of the weighted frequencies */
+			std::vector<double> _heights; /**< the gaps between consecutive frequencies, ascending */
+
+		public:
+			/**
+			 * Build the dendrogram of SomaticEvents, replacing the previous one
+			 *
+			 * @param events A vector of SomaticEvent to be clustered. Each event
+			 * is only clustered once, even if it is given more than once
+			 */
+			void build(const SomaticEventPtr_vec& events);
+
+			/**
+			 * @return The number of distinct events
+			 */
+			inline size_t size() const {return _events.size();}
+
+			/**
+			 * The number of clusters a cut makes, found without cutting
+			 *
+			 * @param threshold The difference threshold
+			 * @return The number of clusters
+			 */
+			size_t numClusters(double threshold) const;
+
+			/**
+			 * Cut the dendrogram. The events are clustered by the frequencies
+			 * they had when the dendrogram was built. The clusters are returned
+			 * by ascending cell fraction, and their members by ascending frequency.
+			 *
+			 * @param threshold The difference threshold to use when doing the clustering
+			 * @return A vector of EventCluster containing the resulting clusters
+			 */
+			EventClusterPtr_vec cut(double threshold) const;
+	};
+
+	/**
+	 * @brief Single-linkage clustering of the event frequencies
+	 *
+	 * @see EventDendrogram
+	 */
+	class LinkageEventClusterer : public EventClusterer {
+		protected:
+			double _threshold; /**< the difference threshold of the clustering */
+
+		public:
+			/**
+			 * Constructor
+			 *
+			 * @param threshold The difference threshold to use when doing the clustering
+			 */
+			LinkageEventClusterer(double threshold): _threshold(threshold) {}
+
+			virtual EventClusterPtr_vec cluster(const SomaticEventPtr_vec& events);
+	};
+
+	/**
+	 * @brief One-dimensional k-means clustering of the event frequencies
+	 *
+	 * Each event weighs the length of its range, as in the cell fraction of
+	 * an EventCluster, and the clustering minimizes the weighted sum of the
+	 * squared differences between the event frequencies and the centroids of
+	 * their clusters.
+	 *
+	 * The events are sorted by frequency once, so that every cluster is a
+	 * run of consecutive events. A Lloyd iteration then only has to locate
+	 * the midpoints between consecutive centroids, and takes the new
+	 * centroids from prefix sums of the weights, in O(k log n) time.
+	 *
+	 * The centroids are seeded by k-means++ from a pseudo-random sequence
+	 * determined by the seed and the restart index, and the run with the
+	 * lowest sum of squares is kept, the earliest one on ties. The restarts
+	 * are spread over the given number of threads, which therefore does not
+	 * change the result.
+	 */
+	class KMeansEventClusterer : public EventClusterer {
+		protected:
+			size_t _numClusters; /**< the number of clusters wanted */
+			int _numRestarts; /**< the number of seedings tried */
+			int _numThreads; /**< the number of threads running the restarts */
+			unsigned long _seed; /**< the seed of the pseudo-random sequences */
+			int _maxIterations; /**< the maximum number of Lloyd iterations per restart */
+
+		public:
+			/**
+			 * Constructor
+			 *
+			 * @param numClusters The number of clusters wanted
+			 * @param numRestarts The number of seedings tried
+			 * @param numThreads The number of threads running the restarts
+			 * @param seed The seed of the pseudo-random sequences
+			 */
+			KMeansEventClusterer(size_t numClusters, int numRestarts = 10, int numThreads = 1, unsigned long seed = 1):
+				_numClusters(numClusters), _numRestarts(numRestarts), _numThreads(numThreads), _seed(seed), _maxIterations(100) {}
+
+			/**
+			 * Cluster SomaticEvents. Fewer than the wanted number of clusters
+			 * are returned if the events have fewer distinct frequencies. The
+			 * clusters are returned by ascending cell fraction, and their
+			 * members by ascending frequency.
+			 *
+			 * @param events A vector of SomaticEvent to be clustered
+			 * @return A vector of EventCluster containing the resulting clusters
+			 */
+			virtual EventClusterPtr_vec cluster(const SomaticEventPtr_vec& events);
+	};
+}
+
+#endif
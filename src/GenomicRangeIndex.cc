@@ -0,0 +1,136 @@
+/**
+ * @file GenomicRangeIndex.cc
+ * Implementation of the helper class GenomicRangeIndex
+ *
+ * @author Yi Qiao
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013 Yi Qiao
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <algorithm>
+#include <cassert>
+#include "GenomicRangeIndex.h"
+
+using namespace SubcloneSeeker;
+
+bool GenomicRangeIndex::Entry::operator<(const Entry& another) const {
+	if(range.chrom != another.range.chrom)
+		return range.chrom < another.range.chrom;
+	if(range.position != another.range.position)
+		return range.position < another.range.position;
+	return id < another.id;
+}
+
+void GenomicRangeIndex::add(const GenomicRange& range, size_t id) {
+	Entry entry;
+	entry.range = range;
+	entry.id = id;
+	_entries.push_back(entry);
+	_isBuilt = false;
+}
+
+void GenomicRangeIndex::build() {
+	std::sort(_entries.begin(), _entries.end());
+
+	_maxEnd.resize(_entries.size());
+	for(size_t i = 0; i < _entries.size(); i++) {
+		const GenomicRange& range = _entries[i].range;
+		_maxEnd[i] = range.position + range.length;
+		if(i > 0 && _entries[i-1].range.chrom == range.chrom && _maxEnd[i-1] > _maxEnd[i])
+			_maxEnd[i] = _maxEnd[i-1];
+	}
+
+	_isBuilt = true;
+}
+
+void GenomicRangeIndex::clear() {
+	_entries.clear();
+	_maxEnd.clear();
+	_isBuilt = true;
+}
+
+size_t GenomicRangeIndex::lowerBound(int chrom, unsigned long position) const {
+	size_t first = 0, count = _entries.size();
+	while(count > 0) {
+		size_t step = count / 2;
+		const GenomicRange& range = _entries[first + step].range;
+		if(range.chrom < chrom || (range.chrom == chrom && range.position < position)) {
+			first += step + 1;
+			count -= step + 1;
+		}
+		else
+			count = step;
+	}
+	return first;
+}
+
+size_t GenomicRangeIndex::equalWithin(const GenomicRange& range, unsigned long resolution, std::vector<size_t>& ids) const {
+	assert(_isBuilt);
+	ids.clear();
+	if(resolution == 0)
+		return 0;
+
+	// Only the ranges starting less than resolution away can match
+	unsigned long firstStart = range.position >= resolution ? range.position - resolution + 1 : 0;
+	unsigned long end = range.position + range.length;
+
+	for(size_t i = lowerBound(range.chrom, firstStart); i < _entries.size(); i++) {
+		const GenomicRange& candidate = _entries[i].range;
+		if(candidate.chrom != range.chrom || (candidate.position > range.position && candidate.position - range.position >= resolution))
+			break;
+
+		unsigned long candidateEnd = candidate.position + candidate.length;
+		unsigned long endDiff = candidateEnd > end ? candidateEnd - end : end - candidateEnd;
+		if(endDiff < resolution)
+			ids.push_back(_entries[i].id);
+	}
+
+	return ids.size();
+}
+
+size_t GenomicRangeIndex::overlapping(const GenomicRange& range, std::vector<size_t>& ids) const {
+	assert(_isBuilt);
+	ids.clear();
+
+	// Walk back from the last range starting at or before the end, while
+	// some range up to there still reaches the start
+	for(size_t i = lowerBound(range.chrom, range.position + range.length + 1); i > 0; i--) {
+		const GenomicRange& candidate = _entries[i-1].range;
+		if(candidate.chrom != range.chrom || _maxEnd[i-1] < range.position)
+			break;
+
+		if(candidate.position + candidate.length >= range.position)
+			ids.push_back(_entries[i-1].id);
+	}
+
+	std::reverse(ids.begin(), ids.end());
+	return ids.size();
+}
+
+bool GenomicRangeIndex::overlapsAny(const GenomicRange& range) const {
+	assert(_isBuilt);
+
+	size_t i = lowerBound(range.chrom, range.position + range.length + 1);
+	return i > 0 && _entries[i-1].range.chrom == range.chrom && _maxEnd[i-1] >= range.position;
+}
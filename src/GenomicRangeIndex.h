@@ -0,0 +1,144 @@
+#ifndef GENOMIC_RANGE_INDEX_H
+#define GENOMIC_RANGE_INDEX_H
+
+/**
+ * @file GenomicRangeIndex.h
+ * Interface description of the helper class GenomicRangeIndex
+ *
+ * @author Yi Qiao
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013 Yi Qiao
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <vector>
+#include <cstddef>
+#include "GenomicRange.h"
+
+namespace SubcloneSeeker {
+
+	/**
+	 * @brief An index of genomic ranges, for finding the ranges near a given one
+	 *
+	 * Ranges are added with an id, typically their index in a vector kept by
+	 * the caller, and the index is then built. The ranges are kept sorted by
+	 * chromosome and start position, so that a query only looks at the ranges
+	 * starting near the range queried rather than at all of them. For the
+	 * overlap queries, the index also keeps the furthest end reached by the
+	 * ranges of each chromosome up to every entry, which bounds how far back
+	 * an overlapping range may start.
+	 */
+	class GenomicRangeIndex {
+		protected:
+			/**
+			 * @brief A range in the index
+			 */
+			struct Entry {
+				GenomicRange range; /**< the range */
+				size_t id; /**< the id given to the range */
+
+				/**
+				 * Order entries by chromosome, then start position, then id
+				 */
+				bool operator<(const Entry& another) const;
+			};
+
+			std::vector<Entry> _entries; /**< the ranges, sorted once the index is built */
+			std::vector<unsigned long> _maxEnd; /**< the furthest end of the ranges of the chromosome up to each entry */
+			bool _isBuilt; /**< if no range has been added since the index was built */
+
+			/**
+			 * Find the first range of a chromosome starting at or after a position
+			 *
+			 * @param chrom The chromosome
+			 * @param position The position
+			 * @return The index of the entry, or the number of entries if there is none
+			 */
+			size_t lowerBound(int chrom, unsigned long position) const;
+
+		public:
+			/**
+			 * Constructor. The index is empty
+			 */
+			GenomicRangeIndex(): _isBuilt(true) {}
+
+			/**
+			 * Add a range to the index. The index has to be built again before
+			 * it can be queried
+			 *
+			 * @param range The range
+			 * @param id The id reported by queries matching the range
+			 */
+			void add(const GenomicRange& range, size_t id);
+
+			/**
+			 * Sort the ranges added, so that the index can be queried
+			 */
+			void build();
+
+			/**
+			 * Remove all the ranges
+			 */
+			void clear();
+
+			/**
+			 * @return The number of ranges in the index
+			 */
+			inline size_t size() const {return _entries.size();}
+
+			/**
+			 * Find the ranges equal to a given one within a resolution: on the
+			 * same chromosome, with both their start and their end less than
+			 * resolution away from the ones of the given range. This is the
+			 * relation used by CNV::isEqualTo.
+			 *
+			 * @param range The range queried
+			 * @param resolution The resolution
+			 * @param ids Receives the ids of the matching ranges, ordered by start position
+			 * @return The number of matching ranges
+			 */
+			size_t equalWithin(const GenomicRange& range, unsigned long resolution, std::vector<size_t>& ids) const;
+
+			/**
+			 * Find the ranges overlapping a given one, in the sense of
+			 * GenomicRange::overlaps
+			 *
+			 * @param range The range queried
+			 * @param ids Receives the ids of the overlapping ranges, ordered by start position
+			 * @return The number of overlapping ranges
+			 */
+			size_t overlapping(const GenomicRange& range, std::vector<size_t>& ids) const;
+
+			/**
+			 * Check if any range overlaps a given one, in the sense of
+			 * GenomicRange::overlaps. This takes O(log n) time, which makes
+			 * the index suitable for masking against many regions.
+			 *
+			 * @param range The range queried
+			 * @return true if at least one range overlaps the range queried
+			 */
+			bool overlapsAny(const GenomicRange& range) const;
+	};
+}
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+/**
+ * @file ObjectPool.h
+ * Interface description of the helper class ObjectPool
+ *
+ * @author Yi Qiao
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013 Yi Qiao
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <vector>
+#include <cstddef>
+#include <new>
+
+/**
+ * The default number of objects in one block of an ObjectPool
+ */
+#define OBJECT_POOL_BLOCK_SIZE 256
+
+namespace SubcloneSeeker {
+
+	/**
+	 * @brief Owns many objects of one type, and frees them all at once
+	 *
+	 * The objects are constructed in place within large blocks of memory, so
+	 * that they are not allocated one by one, and stay at the same address
+	 * until the pool is cleared or destroyed. Objects cannot be freed
+	 * individually. Clearing the pool destroys all the objects but keeps the
+	 * blocks, which are then reused by the objects created next, so that a
+	 * pool cleared between batches stops allocating memory once it has grown
+	 * to the size of the largest batch.
+	 */
+	template<class T>
+	class ObjectPool {
+		protected:
+			std::vector<T *> _blocks; /**< the blocks of memory, each with room for _blockSize objects */
+			size_t _blockSize; /**< the number of objects per block */
+			size_t _size; /**< the number of live objects, stored in the blocks in order */
+
+			/**
+			 * @return The memory for the next object, allocating a new block if
+			 * the current ones are full
+			 */
+			inline void *nextSlot() {
+				if(_size == _blocks.size() * _blockSize)
+					_blocks.push_back(static_cast<T *>(::operator new(_blockSize * sizeof(T))));
+				return _blocks[_size / _blockSize] + _size % _blockSize;
+			}
+
+		private:
+			ObjectPool(const ObjectPool&);
+			ObjectPool& operator=(const ObjectPool&);
+
+		public:
+			/**
+			 * Constructor. No memory is allocated before the first object is created
+			 *
+			 * @param blockSize The number of objects per block
+			 */
+			ObjectPool(size_t blockSize = OBJECT_POOL_BLOCK_SIZE): _blockSize(blockSize > 0 ? blockSize : 1), _size(0) {}
+
+			/**
+			 * Destructor. Destroys all the objects and frees the blocks
+			 */
+			~ObjectPool() {
+				clear();
+				for(size_t i=0; i<_blocks.size(); i++)
+					::operator delete(_blocks[i]);
+			}
+
+			/**
+			 * Create a default-constructed object
+			 *
+			 * @return The new object, owned by the pool
+			 */
+			inline T *create() {
+				T *object = new(nextSlot()) T();
+				_size++;
+				return object;
+			}
+
+			/**
+			 * Create a copy of an object
+			 *
+			 * @param other The object to be copied
+			 * @return The new object, owned by the pool
+			 */
+			inline T *create(const T& other) {
+				T *object = new(nextSlot()) T(other);
+				_size++;
+				return object;
+			}
+
+			/**
+			 * @return The number of objects in the pool
+			 */
+			inline size_t size() const {return _size;}
+
+			/**
+			 * @return The number of objects the pool holds without allocating memory
+			 */
+			inline size_t capacity() const {return _blocks.size() * _blockSize;}
+
+			/**
+			 * Destroy all the objects, in the reverse order of their creation.
+			 * The memory is kept for the objects created next.
+			 */
+			void clear() {
+				while(_size > 0) {
+					_size--;
+					(_blocks[_size / _blockSize] + _size % _blockSize)->~T();
+				}
+			}
+	};
+}
+
+#endif
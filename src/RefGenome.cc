@@ -29,88 +29,209 @@ THE SOFTWARE.
 
 #include "RefGenome.h"
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+
+/**
+ * The largest of the ids kept by the chromosomes 1-22, X and Y
+ */
+#define LEGACY_MAX_CHROM_ID 24
 
 RefGenome * RefGenome::_refGenome = NULL;
 
+/**
+ * Map a chromosome name by its number, X and Y to 23 and 24, with or
+ * without the "chr" prefix
+ *
+ * @param chrom The first character of the name
+ * @param length The length of the name
+ * @return The id, or 0 if the name is not a number, X or Y
+ */
+static int LegacyChromID(const char *chrom, size_t length) {
+	if(length >= 3 && strncmp(chrom, "chr", 3) == 0) {
+		chrom += 3;
+		length -= 3;
+	}
+
+	if(length == 1 && chrom[0] == 'X')
+		return 23;
+	if(length == 1 && chrom[0] == 'Y')
+		return 24;
+
+	if(length == 0 || length > 9)
+		return 0;
+	int chromID = 0;
+	for(size_t i=0; i<length; i++) {
+		if(chrom[i] < '0' || chrom[i] > '9')
+			return 0;
+		chromID = chromID * 10 + (chrom[i] - '0');
+	}
+	return chromID;
+}
+
+/**
+ * FNV-1a hash of a chromosome name
+ */
+static inline unsigned int HashChromName(const char *chrom, size_t length) {
+	unsigned int hash = 2166136261U;
+	for(size_t i=0; i<length; i++) {
+		hash ^= (unsigned char)chrom[i];
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
 RefGenome::RefGenome() 
 {
-	/* define human chromosomes */
-	
-	_chromNames.push_back("chr1");
-	_chromIDs.push_back(queryChromID("chr1"));
-	_chromNames.push_back("chr2");
-	_chromIDs.push_back(queryChromID("chr2"));
-	_chromNames.push_back("chr3");
-	_chromIDs.push_back(queryChromID("chr3"));
-	_chromNames.push_back("chr4");
-	_chromIDs.push_back(queryChromID("chr4"));
-	_chromNames.push_back("chr5");
-	_chromIDs.push_back(queryChromID("chr5"));
-	_chromNames.push_back("chr6");
-	_chromIDs.push_back(queryChromID("chr6"));
-	_chromNames.push_back("chr7");
-	_chromIDs.push_back(queryChromID("chr7"));
-	_chromNames.push_back("chr8");
-	_chromIDs.push_back(queryChromID("chr8"));
-	_chromNames.push_back("chr9");
-	_chromIDs.push_back(queryChromID("chr9"));
-	_chromNames.push_back("chr10");
-	_chromIDs.push_back(queryChromID("chr10"));
-	_chromNames.push_back("chr11");
-	_chromIDs.push_back(queryChromID("chr11"));
-	_chromNames.push_back("chr12");
-	_chromIDs.push_back(queryChromID("chr12"));
-	_chromNames.push_back("chr13");
-	_chromIDs.push_back(queryChromID("chr13"));
-	_chromNames.push_back("chr14");
-	_chromIDs.push_back(queryChromID("chr14"));
-	_chromNames.push_back("chr15");
-	_chromIDs.push_back(queryChromID("chr15"));
-	_chromNames.push_back("chr16");
-	_chromIDs.push_back(queryChromID("chr16"));
-	_chromNames.push_back("chr17");
-	_chromIDs.push_back(queryChromID("chr17"));
-	_chromNames.push_back("chr18");
-	_chromIDs.push_back(queryChromID("chr18"));
-	_chromNames.push_back("chr19");
-	_chromIDs.push_back(queryChromID("chr19"));
-	_chromNames.push_back("chr20");
-	_chromIDs.push_back(queryChromID("chr20"));
-	_chromNames.push_back("chr21");
-	_chromIDs.push_back(queryChromID("chr21"));
-	_chromNames.push_back("chr22");
-	_chromIDs.push_back(queryChromID("chr22"));
-	_chromNames.push_back("chrX");
-	_chromIDs.push_back(queryChromID("chrX"));
-	_chromNames.push_back("chrY");
-	_chromIDs.push_back(queryChromID("chrY"));
-	
-	
+	loadHG19();
+}
+
+void RefGenome::loadHG19() {
 	/* define the length of human chromosomes : hg19 */
-	_chromLengthMap.insert(std::pair<int, size_t>(queryChromID("chr1"), 249904550));
-	_chromLengthMap.insert(std::pair<int, size_t>(queryChromID("chr2"), 243199373));
-	_chromLengthMap.insert(std::pair<int, size_t>(queryChromID("chr3"), 198022430));
-	_chromLengthMap.insert(std::pair<int, size_t>(queryChromID("chr4"), 191535534));
-	_chromLengthMap.insert(std::pair<int, size_t>(queryChromID("chr5"), 180915260));
-	_chromLengthMap.insert(std::pair<int, size_t>(queryChromID("chr6"), 171115067));
-	_chromLengthMap.insert(std::pair<int, size_t>(queryChromID("chr7"), 159321559));
-	_chromLengthMap.insert(std::pair<int, size_t>(queryChromID("chr8"), 146440111));
-	_chromLengthMap.insert(std::pair<int, size_t>(queryChromID("chr9"), 141696573));
-	_chromLengthMap.insert(std::pair<int, size_t>(queryChromID("chr10"), 135534747));
-	_chromLengthMap.insert(std::pair<int, size_t>(queryChromID("chr11"), 135046619));
-	_chromLengthMap.insert(std::pair<int, size_t>(queryChromID("chr12"), 133851895));
-	_chromLengthMap.insert(std::pair<int, size_t>(queryChromID("chr13"), 115169878));
-	_chromLengthMap.insert(std::pair<int, size_t>(queryChromID("chr14"), 107349540));
-	_chromLengthMap.insert(std::pair<int, size_t>(queryChromID("chr15"), 102531392));
-	_chromLengthMap.insert(std::pair<int, size_t>(queryChromID("chr16"), 90354753));
-	_chromLengthMap.insert(std::pair<int, size_t>(queryChromID("chr17"), 81529607));
-	_chromLengthMap.insert(std::pair<int, size_t>(queryChromID("chr18"), 78081510));
-	_chromLengthMap.insert(std::pair<int, size_t>(queryChromID("chr19"), 59380841));
-	_chromLengthMap.insert(std::pair<int, size_t>(queryChromID("chr20"), 63025520));
-	_chromLengthMap.insert(std::pair<int, size_t>(queryChromID("chr21"), 48157577));
-	_chromLengthMap.insert(std::pair<int, size_t>(queryChromID("chr22"), 51304566));
-	_chromLengthMap.insert(std::pair<int, size_t>(queryChromID("chrX"), 155270560));
-	_chromLengthMap.insert(std::pair<int, size_t>(queryChromID("chrY"), 59373566));
+	static const size_t hg19Lengths[] = {
+		249904550, 243199373, 198022430, 191535534, 180915260, 171115067,
+		159321559, 146440111, 141696573, 135534747, 135046619, 133851895,
+		115169878, 107349540, 102531392, 90354753, 81529607, 78081510,
+		59380841, 63025520, 48157577, 51304566, 155270560, 59373566};
+	static const char *hg19Names[] = {
+		"chr1", "chr2", "chr3", "chr4", "chr5", "chr6", "chr7", "chr8",
+		"chr9", "chr10", "chr11", "chr12", "chr13", "chr14", "chr15", "chr16",
+		"chr17", "chr18", "chr19", "chr20", "chr21", "chr22", "chrX", "chrY"};
+
+	assign(std::vector<std::string>(hg19Names, hg19Names + 24), std::vector<size_t>(hg19Lengths, hg19Lengths + 24));
+}
+
+void RefGenome::assign(const std::vector<std::string>& names, const std::vector<size_t>& lengths) {
+	_chromNames = names;
+	_chromLengths = lengths;
+	_chromIDs.assign(names.size(), 0);
+
+	// chromosomes 1-22, X and Y keep their ids, the other contigs follow
+	int maxID = LEGACY_MAX_CHROM_ID;
+	std::vector<bool> taken(maxID + 1, false);
+	for(size_t i=0; i<names.size(); i++) {
+		int chromID = LegacyChromID(names[i].data(), names[i].size());
+		if(chromID > 0 && chromID <= LEGACY_MAX_CHROM_ID && not taken[chromID]) {
+			_chromIDs[i] = chromID;
+			taken[chromID] = true;
+		}
+	}
+	for(size_t i=0; i<names.size(); i++)
+		if(_chromIDs[i] == 0)
+			_chromIDs[i] = ++maxID;
+
+	_chromStarts.assign(names.size() + 1, 0);
+	_indexOfID.assign(maxID + 1, -1);
+	_nameOfID.assign(maxID + 1, std::string());
+	for(size_t i=0; i<names.size(); i++) {
+		_chromStarts[i+1] = _chromStarts[i] + lengths[i];
+		_indexOfID[_chromIDs[i]] = i;
+		_nameOfID[_chromIDs[i]] = names[i];
+	}
+
+	// names first, then the aliases with or without the "chr" prefix
+	size_t capacity = 16;
+	while(capacity < 4 * names.size())
+		capacity *= 2;
+	_nameKeys.clear();
+	_nameIDs.clear();
+	_nameSlots.assign(capacity, -1);
+	for(size_t i=0; i<names.size(); i++)
+		insertName(names[i], _chromIDs[i]);
+	for(size_t i=0; i<names.size(); i++) {
+		if(names[i].compare(0, 3, "chr") == 0)
+			insertName(names[i].substr(3), _chromIDs[i]);
+		else
+			insertName("chr" + names[i], _chromIDs[i]);
+	}
+}
+
+int RefGenome::lookupName(const char *chrom, size_t length) const {
+	size_t mask = _nameSlots.size() - 1;
+	for(size_t slot = HashChromName(chrom, length) & mask; _nameSlots[slot] != -1; slot = (slot + 1) & mask) {
+		const std::string& key = _nameKeys[_nameSlots[slot]];
+		if(key.size() == length && memcmp(key.data(), chrom, length) == 0)
+			return _nameIDs[_nameSlots[slot]];
+	}
+	return 0;
+}
+
+void RefGenome::insertName(const std::string& name, int chromID) {
+	if(name.empty() || lookupName(name.data(), name.size()) != 0)
+		return;
+
+	size_t mask = _nameSlots.size() - 1;
+	size_t slot = HashChromName(name.data(), name.size()) & mask;
+	while(_nameSlots[slot] != -1)
+		slot = (slot + 1) & mask;
+
+	_nameSlots[slot] = _nameKeys.size();
+	_nameKeys.push_back(name);
+	_nameIDs.push_back(chromID);
+}
+
+bool RefGenome::loadFromFile(const std::string& filename) {
+	std::ifstream in(filename.c_str());
+	if(!in.is_open())
+		return false;
+
+	std::vector<std::string> names;
+	std::vector<size_t> lengths;
+	std::string line;
+	while(std::getline(in, line)) {
+		if(not line.empty() && line[line.size() - 1] == '\r')
+			line.erase(line.size() - 1);
+		if(line.empty())
+			continue;
+
+		std::string name, length;
+		if(line[0] == '@') {
+			// sequence dictionary
+			if(line.compare(0, 3, "@SQ") != 0)
+				continue;
+			size_t fieldStart = 0;
+			while(fieldStart <= line.size()) {
+				size_t fieldEnd = line.find('\t', fieldStart);
+				if(fieldEnd == std::string::npos)
+					fieldEnd = line.size();
+				if(line.compare(fieldStart, 3, "SN:") == 0)
+					name = line.substr(fieldStart + 3, fieldEnd - fieldStart - 3);
+				else if(line.compare(fieldStart, 3, "LN:") == 0)
+					length = line.substr(fieldStart + 3, fieldEnd - fieldStart - 3);
+				fieldStart = fieldEnd + 1;
+			}
+		}
+		else {
+			// FASTA index
+			size_t nameEnd = line.find('\t');
+			if(nameEnd == std::string::npos)
+				return false;
+			size_t lengthEnd = line.find('\t', nameEnd + 1);
+			name = line.substr(0, nameEnd);
+			length = line.substr(nameEnd + 1, lengthEnd == std::string::npos ? std::string::npos : lengthEnd - nameEnd - 1);
+		}
+
+		char *stop;
+		unsigned long value = strtoul(length.c_str(), &stop, 10);
+		if(name.empty() || length.empty() || *stop != '\0')
+			return false;
+
+		names.push_back(name);
+		lengths.push_back(value);
+	}
+
+	if(names.empty())
+		return false;
+
+	// names must be unique
+	std::vector<std::string> sortedNames(names);
+	std::sort(sortedNames.begin(), sortedNames.end());
+	if(std::adjacent_find(sortedNames.begin(), sortedNames.end()) != sortedNames.end())
+		return false;
+
+	assign(names, lengths);
+	return true;
 }
 
 RefGenome * RefGenome::getInstance() {
@@ -120,37 +241,133 @@ RefGenome * RefGenome::getInstance() {
 	return _refGenome;
 }
 
-int RefGenome::queryChromID(std::string chrom) {
-	
-	if(chrom.find_first_of("chr") != std::string::npos) {
-		chrom = chrom.substr(3, chrom.length() - 3);
+int RefGenome::queryChromID(const std::string& chrom) {
+	return queryChromID(chrom.data(), chrom.size());
+}
+
+int RefGenome::queryChromID(const char *chrom, size_t length) {
+	int chromID = lookupName(chrom, length);
+	if(chromID != 0)
+		return chromID;
+
+	// a number taken by another chromosome does not map to it
+	chromID = LegacyChromID(chrom, length);
+	if(chromID < (int)_nameOfID.size() && not _nameOfID[chromID].empty())
+		return 0;
+	return chromID;
+}
+
+int RefGenome::internChrom(const std::string& chrom) {
+	return internChrom(chrom.data(), chrom.size());
+}
+
+int RefGenome::internChrom(const char *chrom, size_t length) {
+	int chromID = lookupName(chrom, length);
+	if(chromID != 0 || length == 0)
+		return chromID;
+
+	// only the legacy ids are taken from the name, so that a large number
+	// does not make the table as large
+	chromID = LegacyChromID(chrom, length);
+	if(chromID == 0 || chromID > LEGACY_MAX_CHROM_ID || (chromID < (int)_nameOfID.size() && not _nameOfID[chromID].empty()))
+		chromID = std::max((int)_nameOfID.size(), LEGACY_MAX_CHROM_ID + 1);
+	if(chromID >= (int)_nameOfID.size())
+		_nameOfID.resize(chromID + 1);
+
+	std::string name(chrom, length);
+	_nameOfID[chromID] = name;
+
+	// keep the load of the hash table at most one half
+	if(4 * (_nameKeys.size() + 2) > 2 * _nameSlots.size()) {
+		std::vector<std::string> keys;
+		std::vector<int> ids;
+		keys.swap(_nameKeys);
+		ids.swap(_nameIDs);
+		_nameSlots.assign(2 * _nameSlots.size(), -1);
+		for(size_t i=0; i<keys.size(); i++)
+			insertName(keys[i], ids[i]);
 	}
-	
-	if(chrom.compare("X") == 0)
-		return 23;
-	else if(chrom.compare("Y") == 0)
-		return 24;	
-	
-	return atoi(chrom.c_str());
+
+	insertName(name, chromID);
+	if(name.compare(0, 3, "chr") == 0)
+		insertName(name.substr(3), chromID);
+	else
+		insertName("chr" + name, chromID);
+
+	return chromID;
+}
+
+std::string RefGenome::queryChromName(int chromID) {
+	if(chromID <= 0 || chromID >= (int)_nameOfID.size())
+		return std::string();
+	return _nameOfID[chromID];
+}
+
+bool RefGenome::archiveDictionaryToDB(sqlite3 *database) {
+	int rc = sqlite3_exec(database, "CREATE TABLE IF NOT EXISTS Chromosomes (id INTEGER PRIMARY KEY, name TEXT NOT NULL, length INTEGER NOT NULL);", NULL, NULL, NULL);
+	if(rc != SQLITE_OK)
+		return false;
+
+	sqlite3_stmt *statement;
+	rc = sqlite3_prepare_v2(database, "INSERT OR REPLACE INTO Chromosomes (id, name, length) VALUES (?,?,?);", -1, &statement, NULL);
+	if(rc != SQLITE_OK)
+		return false;
+
+	for(size_t chromID = 1; chromID < _nameOfID.size() && rc == SQLITE_OK; chromID++) {
+		if(_nameOfID[chromID].empty())
+			continue;
+
+		sqlite3_bind_int(statement, 1, chromID);
+		sqlite3_bind_text(statement, 2, _nameOfID[chromID].c_str(), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_int64(statement, 3, queryChromLengthWithID(chromID));
+		if(sqlite3_step(statement) == SQLITE_DONE)
+			rc = sqlite3_reset(statement);
+		else
+			rc = SQLITE_ERROR;
+	}
+
+	sqlite3_finalize(statement);
+	return rc == SQLITE_OK;
+}
+
+bool RefGenome::loadDictionaryFromDB(sqlite3 *database, std::vector<int>& chromIDMap) {
+	chromIDMap.clear();
+
+	sqlite3_stmt *statement;
+	if(sqlite3_prepare_v2(database, "SELECT id, name FROM Chromosomes;", -1, &statement, NULL) != SQLITE_OK)
+		return false;
+
+	// a dictionary, even an empty one, gives a map that is not empty
+	chromIDMap.assign(1, 0);
+
+	while(sqlite3_step(statement) == SQLITE_ROW) {
+		int chromID = sqlite3_column_int(statement, 0);
+		const char *name = (const char *)sqlite3_column_text(statement, 1);
+		if(chromID <= 0 || name == NULL)
+			continue;
+
+		if(chromID >= (int)chromIDMap.size())
+			chromIDMap.resize(chromID + 1, 0);
+		chromIDMap[chromID] = internChrom(name, sqlite3_column_bytes(statement, 1));
+	}
+
+	sqlite3_finalize(statement);
+	return true;
 }
 
 size_t RefGenome::queryGenomeLength() {
-	size_t len = 0;
-	for(size_t i=0; i<_chromIDs.size(); i++)
-		len += _chromLengthMap[_chromIDs[i]];
-	return len;
+	return _chromStarts.back();
 }
 
 size_t RefGenome::queryChromStartBase(int chromID) {
-	size_t before = 0;
-	for(int i=1; i<chromID; i++)
-		before += _chromLengthMap[i];
-	return before;
+	if(chromID < 0 || chromID >= (int)_indexOfID.size() || _indexOfID[chromID] < 0)
+		return 0;
+	return _chromStarts[_indexOfID[chromID]];
 }
 
 size_t RefGenome::queryChromLengthWithID(int chromID)
 {
-	if(_chromLengthMap.count(chromID) != 1)
+	if(chromID < 0 || chromID >= (int)_indexOfID.size() || _indexOfID[chromID] < 0)
 		return 0;
-	return _chromLengthMap[chromID];
+	return _chromLengths[_indexOfID[chromID]];
 }
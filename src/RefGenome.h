@@ -32,13 +32,32 @@ THE SOFTWARE.
 */
 
 #include <string>
-#include <map>
 #include <vector>
+#include <cstddef>
+#include <sqlite3/sqlite3.h>
 
 /**
  * @brief Encapsulates a reference genome
  *
- * It right now has a HG19 reference genome built in, in terms of chromosome length.
+ * A reference genome is an ordered list of chromosomes, or contigs, with
+ * their names and lengths. It has a HG19 reference genome built in, and
+ * another genome can be loaded from a FASTA index (.fai) or a sequence
+ * dictionary (.dict) file.
+ *
+ * Every chromosome has an integer id. The chromosomes 1-22, X and Y keep
+ * the ids 1-24 whatever the genome, so that the ids stored in databases
+ * made with different genomes agree, and the other contigs are numbered
+ * after them in genome order. The start of every chromosome in the linear
+ * genome is precomputed, and the chromosomes are kept in a table indexed
+ * by id and a hash table indexed by name, so that all the queries take
+ * constant time.
+ *
+ * Names of chromosomes outside the genome, such as unplaced contigs, can be
+ * interned, which gives them an id of their own for the lifetime of the
+ * genome. The ids of the genome and the interned names are written to
+ * every result database as a dictionary table, so that the ids stored in a
+ * database can be mapped back to names, and onto the ids of another process.
+ * Interning is not thread-safe.
  */
 class RefGenome {
 public:
@@ -52,17 +71,56 @@ public:
 	/**
 	 * returns an integer id for a given chromosome in string. The main purpose for the id representation is to unify 
 	 * different notions of the same chromosome, e.g. "chr10" and "10" will both be mapped to int value 10.
+	 * Chromosomes that are not in the genome are mapped by their number, X and Y to 23 and 24.
 	 *
 	 * @param chrom The string representation of a chromosome, usually read in from a .seg.txt file
 	 * @return an integer value representing the chromosome. 
 	 */
-	int queryChromID(std::string chrom);
+	int queryChromID(const std::string& chrom);
+
+	/**
+	 * Same as queryChromID(const std::string&), for a name that is not NUL-terminated
+	 *
+	 * @param chrom The first character of the name
+	 * @param length The length of the name
+	 * @return an integer value representing the chromosome
+	 */
+	int queryChromID(const char *chrom, size_t length);
+
+	/**
+	 * Return the id of a chromosome, giving it a new id if it is neither in
+	 * the genome nor already interned. A name made of a number up to
+	 * 24, with or without the "chr" prefix, gets that number
+	 * as id unless it is taken; every other name gets the next free id.
+	 *
+	 * @param chrom The name of the chromosome
+	 * @return The id of the chromosome
+	 */
+	int internChrom(const std::string& chrom);
+
+	/**
+	 * Same as internChrom(const std::string&), for a name that is not NUL-terminated
+	 *
+	 * @param chrom The first character of the name
+	 * @param length The length of the name
+	 * @return The id of the chromosome
+	 */
+	int internChrom(const char *chrom, size_t length);
+
+	/**
+	 * Returns the name of a chromosome
+	 *
+	 * @param chromID the integer representation of a chromosome
+	 * @return the name of the chromosome in the genome, or as interned, or an
+	 * empty string if the id is unknown
+	 */
+	std::string queryChromName(int chromID);
 
 	/**
 	 * Returns the length of a chromsome
 	 *
 	 * @param chromID the integer representation of a chromosome
-	 * @return the length of the chromosome
+	 * @return the length of the chromosome, or 0 if it is not in the genome
 	 */
 	size_t queryChromLengthWithID(int chromID);
 
@@ -77,7 +135,8 @@ public:
 	 * Returns the starting position of a given chromosome, in the context of the entire genome
 	 *
 	 * @param chromID the integer representation of a chromosome
-	 * @return the 0-base position of the first base of the given chromosome, in the entire genome
+	 * @return the 0-base position of the first base of the given chromosome, in the entire genome,
+	 * or 0 if it is not in the genome
 	 */
 	size_t queryChromStartBase(int chromID);
 
@@ -95,13 +154,100 @@ public:
 	 */
 	const std::vector<int> & vec_chromIDs() { return _chromIDs; }
 
+	/**
+	 * Replace the genome by the one described in a file. The file is either
+	 * a FASTA index, with the name and the length of a contig in the first
+	 * two columns of every line, or a sequence dictionary, with @SQ lines
+	 * holding SN: and LN: fields.
+	 *
+	 * @param filename The path of the file
+	 * @return false if the file could not be read, in which case the genome is left unchanged
+	 */
+	bool loadFromFile(const std::string& filename);
+
+	/**
+	 * Replace the genome by the built-in HG19 reference genome
+	 */
+	void loadHG19();
+
+	/**
+	 * Write the chromosome dictionary, the id, name and length of every
+	 * chromosome of the genome and of every interned name, to the
+	 * Chromosomes table of a database
+	 *
+	 * @param database A live database connection
+	 * @return false if the dictionary could not be written
+	 */
+	bool archiveDictionaryToDB(sqlite3 *database);
+
+	/**
+	 * Read the chromosome dictionary of a database, and map the ids it
+	 * uses onto the ids of this genome. The names unknown to the genome are
+	 * interned.
+	 *
+	 * @param database A live database connection
+	 * @param chromIDMap Receives, at every id of the database, the
+	 * corresponding id of this genome, or 0 if the id is not in the
+	 * dictionary. It is left empty if the database has no dictionary
+	 * @return false if the database has no dictionary
+	 */
+	bool loadDictionaryFromDB(sqlite3 *database, std::vector<int>& chromIDMap);
+
+	/**
+	 * Translate the id of a chromosome through a map made by loadDictionaryFromDB
+	 *
+	 * @param chromIDMap The map, empty if the database has no dictionary
+	 * @param chromID The id of the chromosome in the database
+	 * @return The id of the chromosome in this genome, or 0 if the database
+	 * has a dictionary that does not list the id. Without a dictionary, the
+	 * ids of the database are taken as they are.
+	 */
+	static inline int mapChromID(const std::vector<int>& chromIDMap, int chromID) {
+		if(chromIDMap.empty())
+			return chromID;
+		if(chromID > 0 && chromID < (int)chromIDMap.size())
+			return chromIDMap[chromID];
+		return 0;
+	}
+
 protected:
 	RefGenome();
+
+	/**
+	 * Replace the genome
+	 *
+	 * @param names The names of the chromosomes, in genome order
+	 * @param lengths The lengths of the chromosomes
+	 */
+	void assign(const std::vector<std::string>& names, const std::vector<size_t>& lengths);
+
+	/**
+	 * Find a name in the hash table
+	 *
+	 * @param chrom The first character of the name
+	 * @param length The length of the name
+	 * @return The id of the chromosome, or 0 if the name is not in the table
+	 */
+	int lookupName(const char *chrom, size_t length) const;
+
+	/**
+	 * Add a name to the hash table, unless it is already there
+	 *
+	 * @param name The name
+	 * @param chromID The id of the chromosome
+	 */
+	void insertName(const std::string& name, int chromID);
+
 	static RefGenome * _refGenome;			/**< The singleton object */
-	std::map<int, size_t> _chromLengthMap; 	/**< The map between an chromosome id and its length */
 	std::vector<std::string> _chromNames; 	/**< The vector of all chromosomes, in string format */
 	std::vector<int> _chromIDs; 			/**< The vector of all chromosomes, in id format */
-	
+	std::vector<size_t> _chromLengths;		/**< The length of every chromosome, in genome order */
+	std::vector<size_t> _chromStarts;		/**< The start of every chromosome in the linear genome, plus the genome length */
+	std::vector<int> _indexOfID;			/**< The genome order of every chromosome id, or -1 */
+	std::vector<std::string> _nameOfID;		/**< The name of every chromosome id, genome or interned, or empty */
+	std::vector<std::string> _nameKeys;		/**< The names and aliases in the hash table */
+	std::vector<int> _nameIDs;				/**< The chromosome id of every name in the hash table */
+	std::vector<int> _nameSlots;			/**< Open-addressing hash table of indices into _nameKeys, or -1 */
 };
 
 
@@ -0,0 +1,279 @@
+/**
+ * @file SegFileReader.cc
+ * Implementation of the helper class SegFileReader
+ *
+ * @author Yi Qiao
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013 Yi Qiao
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <sstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "SegFileReader.h"
+#include "RefGenome.h"
+
+/**
+ * The number of columns of a segmentation file
+ */
+#define SEG_FILE_COLUMNS 6
+
+using namespace SubcloneSeeker;
+
+/**
+ * @brief A whitespace-delimited token of a line, not NUL-terminated
+ */
+struct SegToken {
+	const char *begin; /**< the first character */
+	const char *end; /**< one past the last character */
+
+	/**
+	 * @return A copy of the token
+	 */
+	inline std::string str() const {return std::string(begin, end - begin);}
+};
+
+/**
+ * Parse a number through strtod, for the notations not handled in place
+ *
+ * @param token The token
+ * @param value Receives the number
+ * @return false if the token is not a number
+ */
+static bool ParseSlowNumber(const SegToken& token, double& value) {
+	std::string str = token.str();
+	char *stop;
+	errno = 0;
+	value = strtod(str.c_str(), &stop);
+	return errno == 0 && stop != str.c_str() && *stop == '\0';
+}
+
+/**
+ * Parse an integer. Integers written in another notation, such as 1e+05,
+ * are accepted if they have an integral value.
+ *
+ * @param token The token
+ * @param value Receives the integer
+ * @return false if the token is not an integer
+ */
+static bool ParseInteger(const SegToken& token, long& value) {
+	const char *p = token.begin;
+	bool negative = false;
+	if(*p == '-' || *p == '+')
+		negative = (*p++ == '-');
+
+	long result = 0;
+	const char *digits = p;
+	while(p < token.end && *p >= '0' && *p <= '9' && p - digits < 18)
+		result = result * 10 + (*p++ - '0');
+
+	if(p == token.end && p > digits) {
+		value = negative ? -result : result;
+		return true;
+	}
+
+	double number;
+	if(not ParseSlowNumber(token, number) || number != floor(number))
+		return false;
+	value = (long)number;
+	return true;
+}
+
+/**
+ * Parse a decimal number. Numbers of at most 15 digits, without exponent,
+ * are parsed in place: the digits make an integer that a double holds
+ * exactly, and a single division by an exact power of ten then rounds
+ * the same way strtod does.
+ *
+ * @param token The token
+ * @param value Receives the number
+ * @return false if the token is not a number
+ */
+static bool ParseDecimal(const SegToken& token, double& value) {
+	static const double powersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8,
+		1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+
+	const char *p = token.begin;
+	bool negative = false;
+	if(*p == '-' || *p == '+')
+		negative = (*p++ == '-');
+
+	double mantissa = 0;
+	int numDigits = 0, numDecimals = 0;
+	bool seenPoint = false;
+	for(; p < token.end; p++) {
+		if(*p >= '0' && *p <= '9') {
+			// exact as long as it stays below 2^53
+			if(numDigits < 15)
+				mantissa = mantissa * 10 + (*p - '0');
+			numDigits++;
+			if(seenPoint)
+				numDecimals++;
+		}
+		else if(*p == '.' && not seenPoint)
+			seenPoint = true;
+		else
+			break;
+	}
+
+	if(p == token.end && numDigits > 0 && numDigits <= 15) {
+		value = mantissa / powersOfTen[numDecimals];
+		if(negative)
+			value = -value;
+		return true;
+	}
+
+	return ParseSlowNumber(token, value);
+}
+
+bool SegFileReader::fail(const std::string& message, size_t line) {
+	_segments.clear();
+	_error = message;
+	_errorLine = line;
+	return false;
+}
+
+bool SegFileReader::parse(const char *data, size_t size) {
+	clear();
+
+	const char *end = data + size;
+
+	// one segment at most per line
+	size_t numLines = 1;
+	for(const char *p = data; (p = (const char *)memchr(p, '\n', end - p)) != NULL; p++)
+		numLines++;
+	_segments.reserve(numLines);
+
+	RefGenome *refGenome = RefGenome::getInstance();
+	bool seenHeader = false;
+	size_t lineNo = 0;
+	const char *p = data;
+	while(p < end) {
+		const char *lineEnd = (const char *)memchr(p, '\n', end - p);
+		if(lineEnd == NULL)
+			lineEnd = end;
+		lineNo++;
+
+		SegToken tokens[SEG_FILE_COLUMNS];
+		int numTokens = 0;
+		while(p < lineEnd) {
+			while(p < lineEnd && (*p == ' ' || *p == '\t' || *p == '\r'))
+				p++;
+			if(p == lineEnd)
+				break;
+
+			const char *tokenBegin = p;
+			while(p < lineEnd && *p != ' ' && *p != '\t' && *p != '\r')
+				p++;
+
+			if(numTokens < SEG_FILE_COLUMNS) {
+				tokens[numTokens].begin = tokenBegin;
+				tokens[numTokens].end = p;
+			}
+			numTokens++;
+		}
+		p = lineEnd + 1;
+
+		// blank lines are skipped
+		if(numTokens == 0)
+			continue;
+
+		if(numTokens != SEG_FILE_COLUMNS) {
+			std::ostringstream message;
+			message<<numTokens<<" columns found where "<<SEG_FILE_COLUMNS<<" are expected";
+			return fail(message.str(), lineNo);
+		}
+
+		if(not seenHeader) {
+			seenHeader = true;
+			continue;
+		}
+
+		long startLoc, endLoc, numMark;
+		double segMean;
+		if(not ParseInteger(tokens[2], startLoc))
+			return fail("malformed start position '" + tokens[2].str() + "'", lineNo);
+		if(not ParseInteger(tokens[3], endLoc))
+			return fail("malformed end position '" + tokens[3].str() + "'", lineNo);
+		if(not ParseInteger(tokens[4], numMark))
+			return fail("malformed number of markers '" + tokens[4].str() + "'", lineNo);
+		if(not ParseDecimal(tokens[5], segMean))
+			return fail("malformed segment mean '" + tokens[5].str() + "'", lineNo);
+
+		_segments.push_back(CNV());
+		CNV& cnv = _segments.back();
+		cnv.range.chrom = refGenome->internChrom(tokens[1].begin, tokens[1].end - tokens[1].begin);
+		cnv.range.position = startLoc;
+		cnv.range.length = endLoc - startLoc;
+		cnv.frequency = pow(2, segMean);
+	}
+
+	if(not seenHeader)
+		return fail("the header line is missing", 0);
+
+	return true;
+}
+
+bool SegFileReader::read(const std::string& filename) {
+	int fd = open(filename.c_str(), O_RDONLY);
+	if(fd < 0)
+		return fail(filename + ": " + strerror(errno), 0);
+
+	struct stat st;
+	if(fstat(fd, &st) != 0) {
+		close(fd);
+		return fail(filename + ": " + strerror(errno), 0);
+	}
+
+	if(st.st_size == 0) {
+		close(fd);
+		return parse(NULL, 0);
+	}
+
+	void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(data == MAP_FAILED)
+		return fail(filename + ": " + strerror(errno), 0);
+
+	madvise(data, st.st_size, MADV_SEQUENTIAL);
+	bool status = parse((const char *)data, st.st_size);
+	munmap(data, st.st_size);
+	return status;
+}
+
+bool SegFileReader::readString(const std::string& content) {
+	return parse(content.data(), content.size());
+}
+
+void SegFileReader::clear() {
+	_segments.clear();
+	_error.clear();
+	_errorLine = 0;
+}
@@ -0,0 +1,137 @@
+#ifndef SEG_FILE_READER_H
+#define SEG_FILE_READER_H
+
+/**
+ * @file SegFileReader.h
+ * Interface description of the helper class SegFileReader
+ *
+ * @author Yi Qiao
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013 Yi Qiao
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include "SegmentalMutation.h"
+
+namespace SubcloneSeeker {
+
+	/**
+	 * @brief Reader of segmentation (.seg.txt) files
+	 *
+	 * A segmentation file starts with a header line, followed by one line per
+	 * segment with six whitespace-separated columns: sample id, chromosome,
+	 * start, end, number of markers and segment mean, the log2 ratio of the
+	 * tumor over the normal copy number.
+	 *
+	 * The file is memory-mapped and parsed in place. Integers and plain
+	 * decimal numbers are parsed without going through the locale, which
+	 * gives the same values as strtod, and other notations fall back to
+	 * strtod. Every segment becomes a CNV whose frequency is the copy number
+	 * ratio, 2 to the power of the segment mean, and whose chromosome is
+	 * interned in the reference genome. The CNVs are kept in an
+	 * arena that is sized once from the number of lines of the file, so that
+	 * they are not allocated one by one and pointers to them stay valid until
+	 * the reader is cleared, destroyed or reads another file.
+	 */
+	class SegFileReader {
+		protected:
+			std::vector<CNV> _segments; /**< the segments read */
+			std::string _error; /**< the description of the last error */
+			size_t _errorLine; /**< the line of the last error, or 0 */
+
+			/**
+			 * Parse the content of a segmentation file
+			 *
+			 * @param data The content of the file
+			 * @param size The size of the content
+			 * @return false if the content is not a valid segmentation file
+			 */
+			bool parse(const char *data, size_t size);
+
+			/**
+			 * Record an error
+			 *
+			 * @param message The description of the error
+			 * @param line The line of the error, or 0
+			 * @return false, for convenience
+			 */
+			bool fail(const std::string& message, size_t line);
+
+		public:
+			/**
+			 * Constructor. The reader is empty
+			 */
+			SegFileReader(): _errorLine(0) {}
+
+			/**
+			 * Read a segmentation file, replacing the segments previously read.
+			 * If the file cannot be read, or any of its lines is malformed, no
+			 * segment is kept.
+			 *
+			 * @param filename The path of the file
+			 * @return false if the file could not be read
+			 */
+			bool read(const std::string& filename);
+
+			/**
+			 * Read a segmentation file from memory, replacing the segments
+			 * previously read
+			 *
+			 * @param content The content of the file
+			 * @return false if the content is not a valid segmentation file
+			 */
+			bool readString(const std::string& content);
+
+			/**
+			 * Remove all the segments
+			 */
+			void clear();
+
+			/**
+			 * @return The number of segments read
+			 */
+			inline size_t size() const {return _segments.size();}
+
+			/**
+			 * @param index The index of the segment, in file order
+			 * @return The segment
+			 */
+			inline CNV& segment(size_t index) {return _segments[index];}
+
+			/**
+			 * @return The description of the last error
+			 */
+			inline const std::string& error() const {return _error;}
+
+			/**
+			 * @return The line of the last error, or 0 if the error is not
+			 * tied to a line
+			 */
+			inline size_t errorLine() const {return _errorLine;}
+	};
+}
+
+#endif
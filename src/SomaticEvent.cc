@@ -39,17 +39,23 @@ std::string SomaticEvent::createTableStatementStr() {
 	return ", frequency REAL NOT NULL, chrom INTEGER NOT NULL, start INTEGER NOT NULL, length INTEGER NULL, ofClusterID INTEGER NULL REFERENCES Clusters(id)";
 }
 
+std::vector<std::string> SomaticEvent::indexedColumnList() {
+	return std::vector<std::string>(1, "ofClusterID");
+}
+
 DBObjectID_vec SomaticEvent::allObjectsOfCluster(sqlite3 *database, sqlite3_int64 clusterID) {
-	std::string queryStr = "SELECT id FROM " + getTableName() + " WHERE ofClusterID=?;";
 	sqlite3_stmt *st;
 	int rc;
 	DBObjectID_vec res_vec;
 
-	rc = sqlite3_prepare_v2(database, queryStr.c_str(), -1, &st, 0);
-	if(rc != SQLITE_OK) return res_vec;
+	st = cachedStatement(database, "SELECT id FROM " + getTableName() + " WHERE ofClusterID=?;");
+	if(st == NULL) return res_vec;
 
 	rc = sqlite3_bind_int64(st, 1, clusterID);
-	if(rc != SQLITE_OK) return res_vec;
+	if(rc != SQLITE_OK) {
+		sqlite3_reset(st);
+		return res_vec;
+	}
 
 	while(sqlite3_step(st) == SQLITE_ROW) {
 		sqlite3_int64 newID;
@@ -57,7 +63,7 @@ DBObjectID_vec SomaticEvent::allObjectsOfCluster(sqlite3 *database, sqlite3_int6
 		res_vec.push_back(newID);
 	}
 
-	sqlite3_finalize(st);
+	sqlite3_reset(st);
 
 	return res_vec;
 }
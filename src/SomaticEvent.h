@@ -47,6 +47,7 @@ namespace SubcloneSeeker {
 		protected:
 			// Implements Archivable
 			virtual std::string createTableStatementStr();
+			virtual std::vector<std::string> indexedColumnList();
 
 			sqlite3_int64 ofClusterID; /**< to which cluster in database does this event belongs */
 
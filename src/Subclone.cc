@@ -34,6 +34,7 @@ THE SOFTWARE.
 #include "EventCluster.h"
 #include "SomaticEvent.h"
 #include "SegmentalMutation.h"
+#include "RefGenome.h"
 
 using namespace SubcloneSeeker;
 
@@ -61,6 +62,10 @@ std::string Subclone::createTableStatementStr() {
 	return ", fraction REAL NOT NULL, treeFraction REAL NOT NULL, parentId INTEGER NULL REFERENCES Subclones(id)";
 }
 
+std::vector<std::string> Subclone::indexedColumnList() {
+	return std::vector<std::string>(1, "parentId");
+}
+
 std::string Subclone::createObjectStatementStr() {
 	return "INSERT INTO Subclones (fraction, treeFraction, parentId) VALUES (?, ?, ?);";
 }
@@ -109,23 +114,26 @@ void SubcloneSaveTreeTraverser::processNode(TreeNode *node) {
 
 	// SAVE CLUSTERS
 	for(size_t i=0; i<clone->vecEventCluster().size(); i++) {
-		sqlite3_int64 oldCluID = clone->vecEventCluster()[i]->getId();
-		sqlite3_int64 oldSubcID = clone->vecEventCluster()[i]->subcloneID();
-		clone->vecEventCluster()[i]->setId(0);
-		clone->vecEventCluster()[i]->setSubcloneID(id);
-		sqlite3_int64 newCluID = clone->vecEventCluster()[i]->archiveObjectToDB(_database);
-		for(size_t j=0; j<clone->vecEventCluster()[i]->members().size(); j++) {
-			sqlite3_int64 oldEventID = clone->vecEventCluster()[i]->members()[j]->getId();
-			sqlite3_int64 oldOfCluID = clone->vecEventCluster()[i]->members()[j]->clusterID();
-			clone->vecEventCluster()[i]->members()[j]->setId(0);
-			clone->vecEventCluster()[i]->members()[j]->setClusterID(newCluID);
-			sqlite3_int64 newEventID = clone->vecEventCluster()[i]->members()[j]->archiveObjectToDB(_database);
-
-			clone->vecEventCluster()[i]->members()[j]->setId(oldEventID);
-			clone->vecEventCluster()[i]->members()[j]->setClusterID(oldOfCluID);
+		EventCluster *cluster = clone->vecEventCluster()[i];
+		sqlite3_int64 oldCluID = cluster->getId();
+		sqlite3_int64 oldSubcID = cluster->subcloneID();
+		cluster->setId(0);
+		cluster->setSubcloneID(id);
+		sqlite3_int64 newCluID = cluster->archiveObjectToDB(_database);
+		const std::vector<SomaticEvent *>& members = cluster->members();
+		for(size_t j=0; j<members.size(); j++) {
+			SomaticEvent *event = members[j];
+			sqlite3_int64 oldEventID = event->getId();
+			sqlite3_int64 oldOfCluID = event->clusterID();
+			event->setId(0);
+			event->setClusterID(newCluID);
+			event->archiveObjectToDB(_database);
+
+			event->setId(oldEventID);
+			event->setClusterID(oldOfCluID);
 		}
-		clone->vecEventCluster()[i]->setId(oldCluID);
-		clone->vecEventCluster()[i]->setSubcloneID(oldSubcID);
+		cluster->setId(oldCluID);
+		cluster->setSubcloneID(oldSubcID);
 	}
 }
 
@@ -180,6 +188,11 @@ std::vector<sqlite3_int64> SubcloneLoadTreeTraverser::nodesOfParentID(sqlite3 *d
 	return res;
 }
 
+SubcloneLoadTreeTraverser::SubcloneLoadTreeTraverser(sqlite3 *database, SubcloneArena *arena): _database(database), _arena(arena) {
+	// the dictionary is read once, for all the nodes loaded
+	RefGenome::getInstance()->loadDictionaryFromDB(database, _chromIDMap);
+}
+
 void SubcloneLoadTreeTraverser::processNode(TreeNode * node) {
 	Subclone *clone = dynamic_cast<Subclone *>(node);
 
@@ -187,15 +200,16 @@ void SubcloneLoadTreeTraverser::processNode(TreeNode * node) {
 	EventCluster dummyCluster;
 	DBObjectID_vec cluster_ids = dummyCluster.allObjectsOfSubclone(_database, clone->getId());
 	for(size_t i=0; i<cluster_ids.size(); i++) {
-		EventCluster *newCluster = new EventCluster();
+		EventCluster *newCluster = _arena != NULL ? _arena->createCluster() : new EventCluster();
 		newCluster->unarchiveObjectFromDB(_database, cluster_ids[i]);
 
 		// unarchive CNV
 		CNV dummyCNV;
 		DBObjectID_vec cnv_ids = dummyCNV.allObjectsOfCluster(_database, newCluster->getId());
 		for(size_t j=0; j<cnv_ids.size(); j++) {
-			CNV *newCNV = new CNV();
+			CNV *newCNV = _arena != NULL ? _arena->createCNV() : new CNV();
 			newCNV->unarchiveObjectFromDB(_database, cnv_ids[j]);
+			newCNV->range.chrom = RefGenome::mapChromID(_chromIDMap, newCNV->range.chrom);
 			newCluster->addEvent(newCNV, false);
 		}
 
@@ -205,8 +219,218 @@ void SubcloneLoadTreeTraverser::processNode(TreeNode * node) {
 	std::vector<sqlite3_int64> childrenIDs = nodesOfParentID(_database, clone->getId());
 
 	for(size_t i=0; i<childrenIDs.size(); i++) {
-		Subclone *children = new Subclone();
+		Subclone *children = _arena != NULL ? _arena->createSubclone() : new Subclone();
 		children->unarchiveObjectFromDB(_database, childrenIDs[i]);
 		clone->addChild(children);
 	}
 }
+
+// SubcloneArena
+SubcloneArena::SubcloneArena(size_t blockSize): _subclones(blockSize), _clusters(blockSize), _events(blockSize) {
+}
+
+SubcloneArena::~SubcloneArena() {
+	clear();
+}
+
+Subclone *SubcloneArena::createSubclone() {
+	return _subclones.create();
+}
+
+Subclone *SubcloneArena::createSubclone(const Subclone& other) {
+	return _subclones.create(other);
+}
+
+EventCluster *SubcloneArena::createCluster() {
+	return _clusters.create();
+}
+
+EventCluster *SubcloneArena::createCluster(const EventCluster& other) {
+	return _clusters.create(other);
+}
+
+CNV *SubcloneArena::createCNV() {
+	return _events.create();
+}
+
+CNV *SubcloneArena::createCNV(const CNV& other) {
+	return _events.create(other);
+}
+
+size_t SubcloneArena::size() const {
+	return _subclones.size() + _clusters.size() + _events.size();
+}
+
+void SubcloneArena::clear() {
+	// the trees refer to the clusters and events, which are released last
+	_subclones.clear();
+	_clusters.clear();
+	_events.clear();
+}
+
+// SubcloneTreeLoader
+
+/**
+ * Find a record by its database id
+ *
+ * @param records The records, ordered by id
+ * @param id The id to look for
+ * @return The index of the record, or records.size() if there is none
+ */
+template<class T>
+static size_t IndexOfRecord(const std::vector<T *>& records, sqlite3_int64 id) {
+	size_t lo = 0, hi = records.size();
+	while(lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if(records[mid]->getId() < id)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if(lo < records.size() && records[lo]->getId() == id)
+		return lo;
+	return records.size();
+}
+
+/**
+ * Copy a record into an arena
+ *
+ * @param arena The arena
+ * @param record The record
+ * @return The copy, owned by the arena
+ */
+static inline Subclone *CopyRecord(SubcloneArena& arena, const Subclone& record) {return arena.createSubclone(record);}
+static inline EventCluster *CopyRecord(SubcloneArena& arena, const EventCluster& record) {return arena.createCluster(record);}
+static inline CNV *CopyRecord(SubcloneArena& arena, const CNV& record) {return arena.createCNV(record);}
+
+/**
+ * Read all the records of a table, in the order of their ids
+ *
+ * @param database The database to read from
+ * @param arena The arena in which the records are created
+ * @param records Receives the records
+ * @return false if the table cannot be read
+ */
+template<class T>
+static bool ScanAllRecords(sqlite3 *database, SubcloneArena& arena, std::vector<T *>& records) {
+	T record;
+	sqlite3_stmt *scan = record.scanAllObjects(database);
+	if(scan == NULL)
+		return false;
+
+	while(record.unarchiveNextObject(scan))
+		records.push_back(CopyRecord(arena, record));
+	return true;
+}
+
+SubcloneTreeLoader::~SubcloneTreeLoader() {
+	clear();
+}
+
+void SubcloneTreeLoader::clear() {
+	_records.clear();
+	_subclones.clear();
+	_clusters.clear();
+	_events.clear();
+	_rootIDs.clear();
+	_children.clear();
+	_subcloneClusters.clear();
+	_clusterEvents.clear();
+}
+
+bool SubcloneTreeLoader::loadFromDB(sqlite3 *database) {
+	clear();
+
+	if(not ScanAllRecords(database, _records, _subclones))
+		return false;
+
+	// a database without any cluster or event has no such table
+	ScanAllRecords(database, _records, _clusters);
+	ScanAllRecords(database, _records, _events);
+
+	// the events refer to the chromosome ids of the database, when it has
+	// a dictionary of them
+	std::vector<int> chromIDMap;
+	if(RefGenome::getInstance()->loadDictionaryFromDB(database, chromIDMap)) {
+		for(size_t i=0; i<_events.size(); i++)
+			_events[i]->range.chrom = RefGenome::mapChromID(chromIDMap, _events[i]->range.chrom);
+	}
+
+	_children.resize(_subclones.size());
+	_subcloneClusters.resize(_subclones.size());
+	_clusterEvents.resize(_clusters.size());
+
+	for(size_t i=0; i<_subclones.size(); i++) {
+		sqlite3_int64 parentId = _subclones[i]->getParentId();
+		if(parentId == 0) {
+			_rootIDs.push_back(_subclones[i]->getId());
+			continue;
+		}
+
+		size_t parent = IndexOfRecord(_subclones, parentId);
+		if(parent < _subclones.size())
+			_children[parent].push_back(i);
+	}
+
+	for(size_t i=0; i<_clusters.size(); i++) {
+		size_t subclone = IndexOfRecord(_subclones, _clusters[i]->subcloneID());
+		if(subclone < _subclones.size())
+			_subcloneClusters[subclone].push_back(i);
+	}
+
+	for(size_t i=0; i<_events.size(); i++) {
+		size_t cluster = IndexOfRecord(_clusters, _events[i]->clusterID());
+		if(cluster < _clusters.size())
+			_clusterEvents[cluster].push_back(i);
+	}
+
+	return true;
+}
+
+Subclone *SubcloneTreeLoader::buildTree(sqlite3_int64 rootID) const {
+	size_t index = IndexOfRecord(_subclones, rootID);
+	if(index == _subclones.size())
+		return NULL;
+	return buildSubtree(index, NULL);
+}
+
+Subclone *SubcloneTreeLoader::buildTree(sqlite3_int64 rootID, SubcloneArena& arena) const {
+	size_t index = IndexOfRecord(_subclones, rootID);
+	if(index == _subclones.size())
+		return NULL;
+	return buildSubtree(index, &arena);
+}
+
+Subclone *SubcloneTreeLoader::buildSubtree(size_t index, SubcloneArena *arena) const {
+	Subclone *clone = arena != NULL ? arena->createSubclone(*_subclones[index]) : new Subclone(*_subclones[index]);
+
+	for(size_t i=0; i<_subcloneClusters[index].size(); i++) {
+		size_t cluster = _subcloneClusters[index][i];
+		EventCluster *newCluster = arena != NULL ? arena->createCluster(*_clusters[cluster]) : new EventCluster(*_clusters[cluster]);
+		for(size_t j=0; j<_clusterEvents[cluster].size(); j++) {
+			const CNV& event = *_events[_clusterEvents[cluster][j]];
+			newCluster->addEvent(arena != NULL ? arena->createCNV(event) : new CNV(event), false);
+		}
+		clone->addEventCluster(newCluster);
+	}
+
+	for(size_t i=0; i<_children[index].size(); i++)
+		clone->addChild(buildSubtree(_children[index][i], arena));
+
+	return clone;
+}
+
+void SubcloneTreeLoader::releaseTree(Subclone *root) {
+	for(size_t i=0; i<root->getVecChildren().size(); i++)
+		releaseTree(dynamic_cast<Subclone *>(root->getVecChildren()[i]));
+
+	for(size_t i=0; i<root->vecEventCluster().size(); i++) {
+		EventCluster *cluster = root->vecEventCluster()[i];
+		const std::vector<SomaticEvent *>& members = cluster->members();
+		for(size_t j=0; j<members.size(); j++)
+			delete members[j];
+		delete cluster;
+	}
+
+	delete root;
+}
@@ -33,12 +33,14 @@ THE SOFTWARE.
 
 #include "TreeNode.h"
 #include "Archivable.h"
+#include "ObjectPool.h"
 #include <vector>
 
 namespace SubcloneSeeker {
 
 	// forward declaration of EventCluster, so that pointers can be made
 	class EventCluster;
+	class CNV;
 	class SubcloneSaveTreeTraverser;
 	
 	/**
@@ -61,6 +63,7 @@ namespace SubcloneSeeker {
 			// Implements Archivable
 			virtual std::string getTableName();
 			virtual std::string createTableStatementStr();
+			virtual std::vector<std::string> indexedColumnList();
 			virtual std::string createObjectStatementStr();
 			virtual std::string updateObjectStatementStr();
 			virtual std::string selectObjectColumnListStr();
@@ -80,6 +83,11 @@ namespace SubcloneSeeker {
 			 */
 			inline void setParentId(sqlite3_int64 pid) {parentId = pid;}
 
+			/** get parent id
+			 * @return The database id of the parent node, 0 for a root
+			 */
+			inline sqlite3_int64 getParentId() const {return parentId;}
+
 			/**
 			 * return the fraction
 			 * @return percentage of this subclone
@@ -119,6 +127,79 @@ namespace SubcloneSeeker {
 			void addEventCluster(EventCluster *cluster);
 	};
 
+	/**
+	 * @brief Owns the subclones, clusters and events of a set of trees
+	 *
+	 * The objects are kept in one ObjectPool per type, so that a whole set of
+	 * trees, such as the trees of a database or a sample imported from text,
+	 * is allocated in large blocks and released at once, without walking the
+	 * trees. Objects created by an arena must not be deleted; they live until
+	 * the arena is cleared or destroyed.
+	 */
+	class SubcloneArena {
+		protected:
+			ObjectPool<Subclone> _subclones; /**< the subclones of the arena */
+			ObjectPool<EventCluster> _clusters; /**< the clusters of the arena */
+			ObjectPool<CNV> _events; /**< the events of the arena */
+
+		public:
+			/**
+			 * Constructor
+			 *
+			 * @param blockSize The number of objects of each type per block
+			 */
+			SubcloneArena(size_t blockSize = OBJECT_POOL_BLOCK_SIZE);
+
+			/**
+			 * Destructor. Releases all the objects of the arena
+			 */
+			~SubcloneArena();
+
+			/**
+			 * @return A new, empty subclone owned by the arena
+			 */
+			Subclone *createSubclone();
+
+			/**
+			 * @param other The subclone to be copied
+			 * @return A new copy of the subclone, owned by the arena
+			 */
+			Subclone *createSubclone(const Subclone& other);
+
+			/**
+			 * @return A new, empty cluster owned by the arena
+			 */
+			EventCluster *createCluster();
+
+			/**
+			 * @param other The cluster to be copied
+			 * @return A new copy of the cluster, owned by the arena
+			 */
+			EventCluster *createCluster(const EventCluster& other);
+
+			/**
+			 * @return A new CNV owned by the arena
+			 */
+			CNV *createCNV();
+
+			/**
+			 * @param other The CNV to be copied
+			 * @return A new copy of the CNV, owned by the arena
+			 */
+			CNV *createCNV(const CNV& other);
+
+			/**
+			 * @return The number of objects owned by the arena
+			 */
+			size_t size() const;
+
+			/**
+			 * Release all the objects of the arena. Its memory is kept for the
+			 * objects created next.
+			 */
+			void clear();
+	};
+
 	/**
 	 * @brief A tree traverser that saves an entire tree structure from a database
 	 *
@@ -151,18 +232,24 @@ namespace SubcloneSeeker {
 	 * should be performed on a node that is initialized through unarchiving (which would have its id 
 	 * field populated). The traverser will find all the children nodes in the database, unarchive them, 
 	 * add them as children to the node currently being processed, and continue the traverse.
+	 * The chromosome ids of the events are mapped through the chromosome dictionary of the
+	 * database, as SubcloneTreeLoader does.
 	 */
 	class SubcloneLoadTreeTraverser : public TreeTraverseDelegate {
 		protected:
 			sqlite3* _database; /**< From which database will be tree be loaded */
+			SubcloneArena *_arena; /**< The arena owning the loaded objects, or NULL */
+			std::vector<int> _chromIDMap; /**< maps the chromosome ids of the database onto the ones of the genome */
 
 		public:
 			/**
 			 * Constructor of the SubcloneLoadTreeTraverser class 
 			 *
 			 * @param database From which database will the tree be load
+			 * @param arena The arena in which the loaded nodes, clusters and events
+			 * are created. If NULL, they are allocated one by one, and owned by the caller
 			 */
-			SubcloneLoadTreeTraverser(sqlite3 *database): _database(database) {;}
+			SubcloneLoadTreeTraverser(sqlite3 *database, SubcloneArena *arena = NULL);
 			virtual void processNode(TreeNode *node);
 
 			/**
@@ -188,6 +275,88 @@ namespace SubcloneSeeker {
 	 * A vector of Subclone pointers
 	 */
 	typedef std::vector<Subclone *> SubclonePtr_vec;
+
+	/**
+	 * @brief Loads all the trees of a database at once
+	 *
+	 * SubcloneLoadTreeTraverser issues several queries for every node, cluster
+	 * and event of a tree. This loader instead reads the Subclones, Clusters and
+	 * Events_CNV tables with one ordered scan each, and keeps their records in
+	 * memory, indexed by parent. Trees are then built from memory, as many times
+	 * as needed, with the same structure and ordering as the traverser produces.
+	 */
+	class SubcloneTreeLoader {
+		protected:
+			SubcloneArena _records; /**< owns all the records */
+			std::vector<Subclone *> _subclones; /**< all subclone records, ordered by id */
+			std::vector<EventCluster *> _clusters; /**< all cluster records, ordered by id */
+			std::vector<CNV *> _events; /**< all CNV records, ordered by id */
+
+			DBObjectID_vec _rootIDs; /**< ids of the root subclones, in order */
+			std::vector<std::vector<size_t> > _children; /**< indices of the children of every subclone */
+			std::vector<std::vector<size_t> > _subcloneClusters; /**< indices of the clusters of every subclone */
+			std::vector<std::vector<size_t> > _clusterEvents; /**< indices of the events of every cluster */
+
+			/**
+			 * Free all the records read so far
+			 */
+			void clear();
+
+			/**
+			 * Build a copy of the subtree rooted at a subclone record
+			 *
+			 * @param index The index of the subclone record
+			 * @param arena The arena in which the subtree is created, or NULL
+			 * @return The root of the new subtree
+			 */
+			Subclone *buildSubtree(size_t index, SubcloneArena *arena) const;
+
+		public:
+			/**
+			 * Destructor
+			 */
+			~SubcloneTreeLoader();
+
+			/**
+			 * Read all the trees of a database, replacing what has been read before
+			 *
+			 * @param database The database from which the trees are read
+			 * @return Whether the operation is successful or not
+			 */
+			bool loadFromDB(sqlite3 *database);
+
+			/**
+			 * @return The ids of the root nodes in the database, in the same
+			 * order as SubcloneLoadTreeTraverser::rootNodes
+			 */
+			inline const DBObjectID_vec& rootIDs() const {return _rootIDs;}
+
+			/**
+			 * Build a tree, with its clusters and events, out of the records read
+			 *
+			 * @param rootID The database id of the root node
+			 * @return The root of the new tree, owned by the caller together with
+			 * all its nodes, clusters and events; NULL if no such subclone exists
+			 */
+			Subclone *buildTree(sqlite3_int64 rootID) const;
+
+			/**
+			 * Build a tree, with its clusters and events, out of the records read
+			 *
+			 * @param rootID The database id of the root node
+			 * @param arena The arena in which all the objects of the tree are
+			 * created, and which owns them
+			 * @return The root of the new tree; NULL if no such subclone exists
+			 */
+			Subclone *buildTree(sqlite3_int64 rootID, SubcloneArena& arena) const;
+
+			/**
+			 * Free a tree built by buildTree, with its clusters and events
+			 *
+			 * @param root The root of the tree
+			 */
+			static void releaseTree(Subclone *root);
+	};
 }
 
 #endif
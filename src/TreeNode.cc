@@ -57,54 +57,22 @@ void TreeNode::removeChild(TreeNode *child)
 
 void TreeNode::PreOrderTraverse(TreeNode * root, TreeTraverseDelegate &traverseDelegate)
 {
-	// check if premature-termination has happened
-	if(traverseDelegate.isTerminated())
-		return;
-	
-	// Check if the root node exists at all
-	if (root == NULL) return;
-	
-	// Do the bidding of the traverse delegate
-	traverseDelegate.processNode(root);
-
-	// Preprocess Hook
-	traverseDelegate.preprocessNode(root);
-	
-	// recursively traverse the children nodes
-	for(TreeNodeVec_t::iterator it = root->children.begin(); it != root->children.end(); it++) {
-		TreeNode::PreOrderTraverse(*it, traverseDelegate);
-		// check if premature-termination has happened
-		if(traverseDelegate.isTerminated())
-			return;
-	}
-
-	// Postprocess Hook
-	traverseDelegate.postprocessNode(root);
+	PreOrderVisit(root, traverseDelegate);
 }
 
 void TreeNode::PostOrderTraverse(TreeNode * root, TreeTraverseDelegate &traverseDelegate)
 {
-	// check if premature-termination has happened
-	if(traverseDelegate.isTerminated())
-		return;
-	
-	// Check if the root node exists at all
-	if (root == NULL) return;
-	
-	// Preprocess Hook
-	traverseDelegate.preprocessNode(root);
-	
-	// recursively traverse the children nodes
-	for(TreeNodeVec_t::iterator it = root->children.begin(); it != root->children.end(); it++) {
-		TreeNode::PostOrderTraverse(*it, traverseDelegate);
-		// check if premature-termination has happened
-		if(traverseDelegate.isTerminated())
-			return;
-	}
+	PostOrderVisit(root, traverseDelegate);
+}
 
-	// Postprocess Hook
-	traverseDelegate.postprocessNode(root);
+// TreeTraverser
 
-	// Do the bidding of the traverse delegate
-	traverseDelegate.processNode(root);
+void TreeTraverser::preOrderTraverse(TreeNode * root, TreeTraverseDelegate &traverseDelegate)
+{
+	preOrderVisit(root, traverseDelegate);
+}
+
+void TreeTraverser::postOrderTraverse(TreeNode * root, TreeTraverseDelegate &traverseDelegate)
+{
+	postOrderVisit(root, traverseDelegate);
 }
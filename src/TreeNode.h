@@ -34,6 +34,11 @@ THE SOFTWARE.
 #include <vector>
 #include <cstdio>
 
+/**
+ * The number of levels a TreeTraverser holds before its stack first grows
+ */
+#define TREE_TRAVERSER_MIN_DEPTH 64
+
 namespace SubcloneSeeker{
 		
 	// Forward Declaration so that the TreeTraverseDelegate
@@ -102,6 +107,85 @@ namespace SubcloneSeeker{
 		virtual void postprocessNode(TreeNode * /* node */) {;}
 	};
 
+	/**
+	 * @brief Base class of the visitors of the template traversals
+	 *
+	 * The template traversals, such as TreeNode::PreOrderVisit, take any
+	 * visitor type that has the four member functions below, and call them
+	 * directly, without going through virtual functions, so that they can be
+	 * inlined. A visitor derives from this class and hides the hooks it needs;
+	 * the others do nothing. The nodes are handed over as the node type of the
+	 * traversal, without any cast at run time.
+	 *
+	 * TreeTraverseDelegate has the same member functions, and is therefore a
+	 * visitor of TreeNode, with virtual hooks.
+	 *
+	 * @tparam Node The type of all the nodes of the trees visited
+	 */
+	template<class Node>
+	class TreeVisitor {
+	protected:
+		bool _isTerminated; /**< whether the traversing has been terminated */
+
+	public:
+		/**
+		 * Constructor
+		 */
+		TreeVisitor(): _isTerminated(false) {}
+
+		/**
+		 * terminate the traversing
+		 */
+		inline void terminate() {_isTerminated = true;}
+
+		/**
+		 * check whether the traversing has been terminated
+		 */
+		inline bool isTerminated() const {return _isTerminated;}
+
+		/**
+		 * Hook to call before children nodes are processed
+		 */
+		inline void preprocessNode(Node * /* node */) {}
+
+		/**
+		 * Process the given node during a tree traverse
+		 */
+		inline void processNode(Node * /* node */) {}
+
+		/**
+		 * Hook to call after children nodes are processed
+		 */
+		inline void postprocessNode(Node * /* node */) {}
+	};
+
+	/**
+	 * @brief Visitor calling a function, or any callable object, on every node
+	 *
+	 * @tparam Node The type of all the nodes of the trees visited
+	 * @tparam Function The type of the callable, taking a Node pointer
+	 */
+	template<class Node, class Function>
+	class TreeFunctionVisitor : public TreeVisitor<Node> {
+	protected:
+		Function& _function; /**< the callable, called on every node */
+
+	public:
+		/**
+		 * Constructor
+		 *
+		 * @param function The callable. It must outlive the visitor
+		 */
+		TreeFunctionVisitor(Function& function): _function(function) {}
+
+		/**
+		 * Call the callable on a node
+		 *
+		 * @param node The node
+		 */
+		inline void processNode(Node *node) {_function(node);}
+	};
+
 	/**
 	 * @brief Base class for any object that can seve as a tree node
 	 *
@@ -110,6 +194,9 @@ namespace SubcloneSeeker{
 	 * It also implements, as class method, two basic traversing algorithm:
 	 * . PreOrderTraverse
 	 * . PostOrderTraverse
+	 * which call a TreeTraverseDelegate through virtual functions, and are
+	 * thin adapters over the template traversals PreOrderVisit and
+	 * PostOrderVisit, which call any visitor directly.
 	 * Since the tree is not required to be binary, InOrder traverse makes
 	 * little sense.
 	 */
@@ -184,6 +271,81 @@ namespace SubcloneSeeker{
 		 * @param traverseDelegate An TreeTraverseDelegate object which defines the action performed on nodes
 		 */
 		static void PostOrderTraverse(TreeNode * root, TreeTraverseDelegate &traverseDelegate);
+
+		/**
+		 * Pre-Order traverse algorithm, with a visitor called directly
+		 *
+		 * The visitor is called in the same order as the delegate of
+		 * PreOrderTraverse, which is itself a visitor of TreeNode. All the
+		 * nodes of the tree must be of the type Node, to which the children
+		 * are converted without checking.
+		 *
+		 * @tparam Node The type of all the nodes of the tree
+		 * @tparam Visitor The type of the visitor, usually derived from TreeVisitor
+		 * @param root The root node of the (sub)tree the traversing takes place
+		 * @param visitor The visitor which defines the action performed on nodes
+		 */
+		template<class Node, class Visitor>
+		static void PreOrderVisit(Node * root, Visitor &visitor) {
+			if(visitor.isTerminated() || root == NULL)
+				return;
+
+			visitor.processNode(root);
+			visitor.preprocessNode(root);
+
+			// the children are looked up by index every time, as the
+			// visitor may add and remove some
+			TreeNodeVec_t& rootChildren = root->getVecChildren();
+			for(size_t i=0; i<rootChildren.size(); i++) {
+				PreOrderVisit(static_cast<Node *>(rootChildren[i]), visitor);
+				if(visitor.isTerminated())
+					return;
+			}
+
+			visitor.postprocessNode(root);
+		}
+
+		/**
+		 * Post-Order traverse algorithm, with a visitor called directly
+		 *
+		 * @tparam Node The type of all the nodes of the tree
+		 * @tparam Visitor The type of the visitor, usually derived from TreeVisitor
+		 * @param root The root node of the (sub)tree the traversing takes place
+		 * @param visitor The visitor which defines the action performed on nodes
+		 * @see PreOrderVisit
+		 */
+		template<class Node, class Visitor>
+		static void PostOrderVisit(Node * root, Visitor &visitor) {
+			if(visitor.isTerminated() || root == NULL)
+				return;
+
+			visitor.preprocessNode(root);
+
+			TreeNodeVec_t& rootChildren = root->getVecChildren();
+			for(size_t i=0; i<rootChildren.size(); i++) {
+				PostOrderVisit(static_cast<Node *>(rootChildren[i]), visitor);
+				if(visitor.isTerminated())
+					return;
+			}
+
+			visitor.postprocessNode(root);
+			visitor.processNode(root);
+		}
+
+		/**
+		 * Call a function, or any callable object, on every node of a tree,
+		 * in pre-order
+		 *
+		 * @tparam Node The type of all the nodes of the tree
+		 * @tparam Function The type of the callable, taking a Node pointer
+		 * @param root The root node of the (sub)tree the traversing takes place
+		 * @param function The callable
+		 */
+		template<class Node, class Function>
+		static void PreOrderForEach(Node * root, Function &function) {
+			TreeFunctionVisitor<Node, Function> visitor(function);
+			PreOrderVisit(root, visitor);
+		}
 	
 		/**
 		 * whether the node is a leaf node
@@ -199,6 +361,194 @@ namespace SubcloneSeeker{
 		 */
 		inline bool isRoot() const {return parent == NULL;}
 	};
+
+	/**
+	 * @brief Non-recursive tree traversal engine
+	 *
+	 * The traversals of TreeNode recurse on the call stack, one frame per
+	 * level of the tree. A TreeTraverser walks the tree with an explicit
+	 * stack instead, which holds a node and the index of its next child per
+	 * level, and which is kept from one traversal to the next, so that
+	 * traversing many trees with the same TreeTraverser allocates no memory
+	 * once the stack has grown to the depth of the deepest tree.
+	 *
+	 * The delegate sees exactly the same sequence of calls as with
+	 * TreeNode::PreOrderTraverse and TreeNode::PostOrderTraverse, including
+	 * on early termination. The children of a node are looked up by index
+	 * when they are visited, so that the delegate may add and remove
+	 * children of the nodes on the current path, as with the recursive
+	 * traversals. A TreeTraverser must not be used by two threads at once, nor
+	 * by a delegate of one of its own traversals. As with TreeNode, the
+	 * template traversals take visitors, which are called directly.
+	 *
+	 * The gain is the bounded use of the call stack, which lets a tree of any
+	 * depth be traversed, not speed: a step of the explicit stack costs
+	 * somewhat more than a call, and the traversal is 1.1 to 1.5 times as
+	 * slow as the recursive one (see utils/TreeNode_bench.cc).
+	 */
+	class TreeTraverser {
+	protected:
+		/**
+		 * @brief One level of the traversal
+		 */
+		struct Frame {
+			TreeNode *node; /**< the node being traversed */
+			TreeNodeVec_t *children; /**< the children of the node */
+			size_t nextChild; /**< the index of the next child of the node to be traversed */
+		};
+
+		std::vector<Frame> _stack; /**< the frames, of which the first ones make up the current path */
+
+		/**
+		 * Push a node onto the stack, growing the stack if it is full
+		 *
+		 * @param frames The frames of the stack, updated if the stack grows
+		 * @param depth The number of frames on the stack, incremented
+		 * @param node The node
+		 */
+		inline void push(Frame *& frames, size_t& depth, TreeNode *node) {
+			if(depth == _stack.size()) {
+				_stack.resize(2 * depth + TREE_TRAVERSER_MIN_DEPTH);
+				frames = &_stack[0];
+			}
+			Frame *frame = frames + depth++;
+			frame->node = node;
+			frame->children = &node->getVecChildren();
+			frame->nextChild = 0;
+		}
+
+	public:
+		/**
+		 * Constructor. The stack is made deep enough for most trees
+		 */
+		TreeTraverser(): _stack(TREE_TRAVERSER_MIN_DEPTH) {}
+		/**
+		 * Pre-Order traverse algorithm, without recursion
+		 *
+		 * @param root The root node of the (sub)tree the traversing takes place
+		 * @param traverseDelegate An TreeTraverseDelegate object which defines the action performed on nodes
+		 * @see TreeNode::PreOrderTraverse
+		 */
+		void preOrderTraverse(TreeNode * root, TreeTraverseDelegate &traverseDelegate);
+
+		/**
+		 * Post-Order traverse algorithm, without recursion
+		 *
+		 * @param root The root node of the (sub)tree the traversing takes place
+		 * @param traverseDelegate An TreeTraverseDelegate object which defines the action performed on nodes
+		 * @see TreeNode::PostOrderTraverse
+		 */
+		void postOrderTraverse(TreeNode * root, TreeTraverseDelegate &traverseDelegate);
+
+		/**
+		 * Pre-Order traverse algorithm, without recursion, with a visitor
+		 * called directly
+		 *
+		 * @tparam Node The type of all the nodes of the tree
+		 * @tparam Visitor The type of the visitor, usually derived from TreeVisitor
+		 * @param root The root node of the (sub)tree the traversing takes place
+		 * @param visitor The visitor which defines the action performed on nodes
+		 * @see TreeNode::PreOrderVisit
+		 */
+		template<class Node, class Visitor>
+		void preOrderVisit(Node * root, Visitor &visitor) {
+			if(visitor.isTerminated() || root == NULL)
+				return;
+
+			Frame *frames = &_stack[0];
+			size_t depth = 0;
+			visitor.processNode(root);
+			visitor.preprocessNode(root);
+			push(frames, depth, root);
+
+			// every step either enters the next child of the node on top of
+			// the stack, or leaves the node if it has no child left. A
+			// termination stops all the levels right away, as with the
+			// recursive traversal
+			while(depth > 0) {
+				Frame *frame = frames + depth - 1;
+
+				if(frame->nextChild >= frame->children->size()) {
+					visitor.postprocessNode(static_cast<Node *>(frame->node));
+					depth--;
+					if(visitor.isTerminated())
+						break;
+					continue;
+				}
+
+				Node *child = static_cast<Node *>((*frame->children)[frame->nextChild++]);
+				if(visitor.isTerminated())
+					break;
+				if(child == NULL)
+					continue;
+
+				visitor.processNode(child);
+				visitor.preprocessNode(child);
+
+				// leaves, which the visitor has not given any child, are
+				// left without going through the stack
+				if(child->getVecChildren().empty()) {
+					visitor.postprocessNode(child);
+					if(visitor.isTerminated())
+						break;
+				}
+				else
+					push(frames, depth, child);
+			}
+		}
+
+		/**
+		 * Post-Order traverse algorithm, without recursion, with a visitor
+		 * called directly
+		 *
+		 * @tparam Node The type of all the nodes of the tree
+		 * @tparam Visitor The type of the visitor, usually derived from TreeVisitor
+		 * @param root The root node of the (sub)tree the traversing takes place
+		 * @param visitor The visitor which defines the action performed on nodes
+		 * @see TreeNode::PostOrderVisit
+		 */
+		template<class Node, class Visitor>
+		void postOrderVisit(Node * root, Visitor &visitor) {
+			if(visitor.isTerminated() || root == NULL)
+				return;
+
+			Frame *frames = &_stack[0];
+			size_t depth = 0;
+			visitor.preprocessNode(root);
+			push(frames, depth, root);
+
+			while(depth > 0) {
+				Frame *frame = frames + depth - 1;
+
+				if(frame->nextChild >= frame->children->size()) {
+					Node *node = static_cast<Node *>(frame->node);
+					depth--;
+					visitor.postprocessNode(node);
+					visitor.processNode(node);
+					if(visitor.isTerminated())
+						break;
+					continue;
+				}
+
+				Node *child = static_cast<Node *>((*frame->children)[frame->nextChild++]);
+				if(visitor.isTerminated())
+					break;
+				if(child == NULL)
+					continue;
+
+				visitor.preprocessNode(child);
+
+				if(child->getVecChildren().empty()) {
+					visitor.postprocessNode(child);
+					visitor.processNode(child);
+					if(visitor.isTerminated())
+						break;
+				}
+				else
+					push(frames, depth, child);
+			}
+		}
+	};
 }
 
 #endif
@@ -88,6 +88,120 @@ SUITE(testEventCluster)
 		CHECK(cluster2 > cluster1);
 	}
 
+	TEST(RemoveEvent) {
+		SubcloneSeeker::EventCluster cluster;
+		SubcloneSeeker::CNV cnv1, cnv2, cnv3;
+
+		cnv1.frequency = 0.2;
+		cnv1.range.length = 1000L;
+		cnv2.frequency = 0.4;
+		cnv2.range.length = 3000L;
+		cnv3.frequency = 0.1;
+
+		cluster.addEvent(&cnv1);
+		cluster.addEvent(&cnv2);
+		cluster.addEvent(&cnv2);
+		CHECK(cluster.totalLength() == 4000L);
+		CHECK_CLOSE(cluster.cellFraction(), 0.35, 1e-6);
+
+		CHECK(not cluster.removeEvent(&cnv3));
+		CHECK(cluster.removeEvent(&cnv2));
+		CHECK(cluster.members().size() == 1);
+		CHECK(cluster.totalLength() == 1000L);
+		CHECK_CLOSE(cluster.cellFraction(), 0.2, 1e-6);
+
+		CHECK(cluster.removeEvent(&cnv1));
+		CHECK(cluster.members().size() == 0);
+		CHECK(cluster.totalLength() == 0);
+		CHECK_CLOSE(cluster.cellFraction(), 0, 1e-6);
+	}
+
+	TEST(AddEvents) {
+		SubcloneSeeker::EventCluster cluster, oneByOne;
+		SubcloneSeeker::CNV cnv1, cnv2, cnv3;
+
+		cnv1.frequency = 0.2;
+		cnv1.range.length = 1000L;
+		cnv2.frequency = 0.4;
+		cnv2.range.length = 3000L;
+		cnv3.frequency = 0.1;
+		cnv3.range.length = 1000L;
+
+		cluster.addEvent(&cnv1);
+		std::vector<SubcloneSeeker::SomaticEvent *> events;
+		events.push_back(&cnv2);
+		events.push_back(&cnv1);
+		events.push_back(&cnv3);
+		events.push_back(&cnv2);
+		cluster.addEvents(events);
+
+		oneByOne.addEvent(&cnv1);
+		oneByOne.addEvent(&cnv2);
+		oneByOne.addEvent(&cnv3);
+
+		CHECK(cluster.members() == oneByOne.members());
+		CHECK(cluster.totalLength() == 5000L);
+		CHECK_CLOSE(cluster.cellFraction(), oneByOne.cellFraction(), 1e-9);
+	}
+
+	TEST(ManyMembers) {
+		SubcloneSeeker::EventCluster cluster;
+		std::vector<SubcloneSeeker::CNV> cnvs(1000);
+
+		for(size_t i=0; i<cnvs.size(); i++) {
+			cnvs[i].frequency = 0.5;
+			cnvs[i].range.length = 10L;
+			cluster.addEvent(&cnvs[i]);
+			cluster.addEvent(&cnvs[i / 2]);
+		}
+		CHECK(cluster.members().size() == 1000);
+		CHECK(cluster.totalLength() == 10000L);
+
+		// removing drops the event from the lookup as well
+		CHECK(cluster.removeEvent(&cnvs[500]));
+		CHECK(not cluster.removeEvent(&cnvs[500]));
+		cluster.addEvent(&cnvs[500]);
+		cluster.addEvent(&cnvs[501]);
+		CHECK(cluster.members().size() == 1000);
+		CHECK(cluster.totalLength() == 10000L);
+		CHECK(cluster.members().back() == &cnvs[500]);
+	}
+
+	TEST(SortedClustering) {
+		SubcloneSeeker::CNV cnv[6];
+		double frequencies[] = {0.52, 0.1, 0.5, 0.12, 0.9, 0.48};
+		unsigned long lengths[] = {1000L, 3000L, 1000L, 1000L, 500L, 2000L};
+		std::vector<SubcloneSeeker::SomaticEvent *> events;
+		for(int i=0; i<6; i++) {
+			cnv[i].frequency = frequencies[i];
+			cnv[i].range.length = lengths[i];
+			events.push_back(&cnv[i]);
+		}
+		// an event given twice is only clustered once
+		events.push_back(&cnv[2]);
+
+		std::vector<SubcloneSeeker::EventCluster *> clusters = SubcloneSeeker::EventCluster::sortedClustering(events, 0.05);
+
+		CHECK(clusters.size() == 3);
+		CHECK(clusters[0]->members().size() == 2);
+		CHECK(clusters[0]->members()[0] == &cnv[1]);
+		CHECK(clusters[0]->members()[1] == &cnv[3]);
+		CHECK_CLOSE(clusters[0]->cellFraction(), 0.105, 1e-6);
+		CHECK(clusters[0]->totalLength() == 4000L);
+
+		CHECK(clusters[1]->members().size() == 3);
+		CHECK(clusters[1]->members()[0] == &cnv[5]);
+		CHECK_CLOSE(clusters[1]->cellFraction(), (0.48 * 2 + 0.5 + 0.52) / 4, 1e-6);
+
+		CHECK(clusters[2]->members().size() == 1);
+		CHECK_CLOSE(clusters[2]->cellFraction(), 0.9, 1e-6);
+
+		for(size_t i=0; i<clusters.size(); i++)
+			delete clusters[i];
+
+		CHECK(SubcloneSeeker::EventCluster::sortedClustering(events, 2).size() == 0);
+	}
+
 	TEST(EventClusterToDB) {
 		SubcloneSeeker::EventCluster cluster;
 		SubcloneSeeker::CNV cnv;
@@ -108,7 +222,7 @@ SUITE(testEventCluster)
 
 		CHECK(id != 0);
 
-		sqlite3_close(database);
+		SubcloneSeeker::Archivable::closeDatabase(database);
 		database = 0;
 
 		// read
@@ -121,7 +235,7 @@ SUITE(testEventCluster)
 		CHECK_CLOSE(cluster2.cellFraction(), 0.2, 1e-3);
 		CHECK(cluster2.members().size() == 0);
 
-		sqlite3_close(database);
+		SubcloneSeeker::Archivable::closeDatabase(database);
 
 #ifndef KEEP_TEST_DB
 		remove("test.sqlite");
@@ -0,0 +1,187 @@
+/**
+ * @file Unit tests for the clustering methods
+ *
+ * @see EventClusterer
+ * @author Yi Qiao
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013 Yi Qiao
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <vector>
+#include <cstdio>
+
+#include "EventClusterer.h"
+#include "SegmentalMutation.h"
+
+#include "common.h"
+
+/**
+ * Release the clusters returned by a clusterer
+ */
+static void releaseClusters(SubcloneSeeker::EventClusterPtr_vec& clusters) {
+	for(size_t i=0; i<clusters.size(); i++)
+		delete clusters[i];
+	clusters.clear();
+}
+
+SUITE(TestEventClusterer) {
+	TEST(ThresholdMethods) {
+		SubcloneSeeker::CNV cnv[4];
+		double frequencies[] = {0.5, 0.1, 0.52, 0.12};
+		SubcloneSeeker::SomaticEventPtr_vec events;
+		for(int i=0; i<4; i++) {
+			cnv[i].frequency = frequencies[i];
+			cnv[i].range.length = 1000L;
+			events.push_back(&cnv[i]);
+		}
+
+		SubcloneSeeker::GreedyEventClusterer greedy(0.05);
+		SubcloneSeeker::EventClusterer& clusterer = greedy;
+		SubcloneSeeker::EventClusterPtr_vec clusters = clusterer.cluster(events);
+		CHECK(clusters.size() == 2);
+		CHECK(clusters[0]->members()[0] == &cnv[0]);
+		releaseClusters(clusters);
+
+		SubcloneSeeker::SortedEventClusterer sorted(0.05);
+		clusters = sorted.cluster(events);
+		CHECK(clusters.size() == 2);
+		CHECK(clusters[0]->members()[0] == &cnv[1]);
+		CHECK_CLOSE(clusters[0]->cellFraction(), 0.11, 1e-6);
+		releaseClusters(clusters);
+	}
+
+	TEST(Dendrogram) {
+		SubcloneSeeker::CNV cnv[6];
+		double frequencies[] = {0.52, 0.1, 0.5, 0.16, 0.9, 0.46};
+		unsigned long lengths[] = {1000L, 3000L, 1000L, 1000L, 500L, 2000L};
+		SubcloneSeeker::SomaticEventPtr_vec events;
+		for(int i=0; i<6; i++) {
+			cnv[i].frequency = frequencies[i];
+			cnv[i].range.length = lengths[i];
+			events.push_back(&cnv[i]);
+		}
+		events.push_back(&cnv[2]);
+
+		SubcloneSeeker::EventDendrogram dendrogram;
+		dendrogram.build(events);
+		CHECK(dendrogram.size() == 6);
+
+		// later changes to the frequencies do not affect the cuts
+		cnv[4].frequency = 0.51;
+
+		double thresholds[] = {0, 0.03, 0.07, 0.35, 0.4, 1};
+		size_t expected[] = {6, 5, 3, 2, 1, 1};
+		for(int t=0; t<6; t++) {
+			SubcloneSeeker::EventClusterPtr_vec clusters = dendrogram.cut(thresholds[t]);
+			CHECK(clusters.size() == expected[t]);
+			CHECK(dendrogram.numClusters(thresholds[t]) == expected[t]);
+			releaseClusters(clusters);
+		}
+
+		SubcloneSeeker::EventClusterPtr_vec clusters = dendrogram.cut(0.07);
+		CHECK(clusters.size() == 3);
+		CHECK(clusters[0]->members().size() == 2);
+		CHECK_CLOSE(clusters[0]->cellFraction(), (0.1 * 3 + 0.16) / 4, 1e-6);
+		CHECK(clusters[1]->members().size() == 3);
+		CHECK(clusters[1]->members()[0] == &cnv[5]);
+		CHECK_CLOSE(clusters[1]->cellFraction(), (0.46 * 2 + 0.5 + 0.52) / 4, 1e-6);
+		CHECK(clusters[1]->totalLength() == 4000L);
+		CHECK(clusters[2]->members()[0] == &cnv[4]);
+		CHECK_CLOSE(clusters[2]->cellFraction(), 0.9, 1e-6);
+		releaseClusters(clusters);
+
+		CHECK(dendrogram.cut(2).size() == 0);
+	}
+
+	TEST(KMeans) {
+		SubcloneSeeker::CNV cnv[6];
+		double frequencies[] = {0.52, 0.1, 0.5, 0.12, 0.9, 0.48};
+		unsigned long lengths[] = {1000L, 3000L, 1000L, 1000L, 500L, 2000L};
+		SubcloneSeeker::SomaticEventPtr_vec events;
+		for(int i=0; i<6; i++) {
+			cnv[i].frequency = frequencies[i];
+			cnv[i].range.length = lengths[i];
+			events.push_back(&cnv[i]);
+		}
+		// an event given twice is only clustered once
+		events.push_back(&cnv[2]);
+
+		SubcloneSeeker::KMeansEventClusterer kmeans(3);
+		SubcloneSeeker::EventClusterPtr_vec clusters = kmeans.cluster(events);
+
+		CHECK(clusters.size() == 3);
+		CHECK(clusters[0]->members().size() == 2);
+		CHECK(clusters[0]->members()[0] == &cnv[1]);
+		CHECK(clusters[0]->members()[1] == &cnv[3]);
+		CHECK_CLOSE(clusters[0]->cellFraction(), 0.105, 1e-6);
+		CHECK(clusters[0]->totalLength() == 4000L);
+
+		CHECK(clusters[1]->members().size() == 3);
+		CHECK(clusters[1]->members()[0] == &cnv[5]);
+		CHECK_CLOSE(clusters[1]->cellFraction(), (0.48 * 2 + 0.5 + 0.52) / 4, 1e-6);
+
+		CHECK(clusters[2]->members().size() == 1);
+		CHECK_CLOSE(clusters[2]->cellFraction(), 0.9, 1e-6);
+		releaseClusters(clusters);
+
+		// no more clusters than distinct frequencies
+		SubcloneSeeker::KMeansEventClusterer tooMany(10);
+		clusters = tooMany.cluster(events);
+		CHECK(clusters.size() == 6);
+		releaseClusters(clusters);
+
+		SubcloneSeeker::KMeansEventClusterer none(0);
+		CHECK(none.cluster(events).size() == 0);
+		CHECK(kmeans.cluster(SubcloneSeeker::SomaticEventPtr_vec()).size() == 0);
+	}
+
+	TEST(KMeansThreads) {
+		std::vector<SubcloneSeeker::CNV> cnv(500);
+		SubcloneSeeker::SomaticEventPtr_vec events;
+		for(size_t i=0; i<cnv.size(); i++) {
+			cnv[i].frequency = 0.2 * (i % 5) + 0.001 * ((i * 37) % 23);
+			cnv[i].range.length = 1000L + (i * 7919) % 5000;
+			events.push_back(&cnv[i]);
+		}
+
+		// the result does not depend on the number of threads
+		SubcloneSeeker::KMeansEventClusterer single(5, 8, 1);
+		SubcloneSeeker::KMeansEventClusterer multi(5, 8, 4);
+		SubcloneSeeker::EventClusterPtr_vec clusters = single.cluster(events);
+		SubcloneSeeker::EventClusterPtr_vec others = multi.cluster(events);
+
+		CHECK(clusters.size() == 5);
+		CHECK(others.size() == clusters.size());
+		for(size_t i=0; i<clusters.size() && i<others.size(); i++) {
+			CHECK(clusters[i]->members() == others[i]->members());
+			CHECK(clusters[i]->cellFraction() == others[i]->cellFraction());
+			CHECK(clusters[i]->members().size() == 100);
+		}
+
+		releaseClusters(clusters);
+		releaseClusters(others);
+	}
+}
+
+TEST_MAIN
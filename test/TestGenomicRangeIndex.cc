@@ -0,0 +1,178 @@
+/**
+ * @file Unit tests for class GenomicRangeIndex
+ *
+ * @see GenomicRangeIndex
+ * @author Yi Qiao
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013 Yi Qiao
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <vector>
+#include "GenomicRangeIndex.h"
+#include "SegmentalMutation.h"
+
+#include "common.h"
+using namespace SubcloneSeeker;
+
+/**
+ * Make a range
+ */
+static GenomicRange makeRange(int chrom, unsigned long position, unsigned long length) {
+	GenomicRange range;
+	range.chrom = chrom;
+	range.position = position;
+	range.length = length;
+	return range;
+}
+
+SUITE(testGenomicRangeIndex) {
+	TEST(EmptyIndex) {
+		GenomicRangeIndex index;
+		std::vector<size_t> ids;
+		CHECK(index.size() == 0);
+		CHECK(index.equalWithin(makeRange(1, 100, 100), 1000, ids) == 0);
+		CHECK(ids.size() == 0);
+		CHECK(index.overlapping(makeRange(1, 100, 100), ids) == 0);
+		CHECK(not index.overlapsAny(makeRange(1, 100, 100)));
+	}
+
+	TEST(EqualWithin) {
+		GenomicRangeIndex index;
+		index.add(makeRange(1, 1000, 500), 0);
+		index.add(makeRange(2, 1000, 500), 1);
+		index.add(makeRange(1, 0, 1500), 2);
+		index.add(makeRange(1, 1900, 500), 3);
+		index.add(makeRange(1, 1099, 401), 4);
+		index.build();
+		CHECK(index.size() == 5);
+
+		std::vector<size_t> ids;
+		CHECK(index.equalWithin(makeRange(1, 1000, 500), 100, ids) == 2);
+		CHECK(ids[0] == 0);
+		CHECK(ids[1] == 4);
+
+		// a start or an end exactly resolution away does not match
+		CHECK(index.equalWithin(makeRange(1, 1000, 500), 99, ids) == 1);
+		CHECK(index.equalWithin(makeRange(1, 1000, 600), 100, ids) == 0);
+		CHECK(index.equalWithin(makeRange(1, 999, 501), 100, ids) == 1);
+		CHECK(ids[0] == 0);
+
+		CHECK(index.equalWithin(makeRange(1, 0, 1500), 1000, ids) == 1);
+		CHECK(ids[0] == 2);
+		CHECK(index.equalWithin(makeRange(2, 1000, 500), 1000000, ids) == 1);
+		CHECK(index.equalWithin(makeRange(3, 1000, 500), 1000000, ids) == 0);
+	}
+
+	TEST(Overlapping) {
+		GenomicRangeIndex index;
+		index.add(makeRange(1, 0, 10000), 0);
+		index.add(makeRange(1, 1000, 100), 1);
+		index.add(makeRange(1, 20000, 100), 2);
+		index.add(makeRange(2, 500, 100), 3);
+		index.build();
+
+		std::vector<size_t> ids;
+		CHECK(index.overlapping(makeRange(1, 1050, 10), ids) == 2);
+		CHECK(ids[0] == 0);
+		CHECK(ids[1] == 1);
+
+		// a long range started early still overlaps
+		CHECK(index.overlapping(makeRange(1, 9000, 100), ids) == 1);
+		CHECK(ids[0] == 0);
+
+		// touching ends overlap
+		CHECK(index.overlapsAny(makeRange(1, 10000, 5)));
+		CHECK(index.overlapsAny(makeRange(1, 19900, 100)));
+		CHECK(not index.overlapsAny(makeRange(1, 10001, 5000)));
+		CHECK(index.overlapping(makeRange(1, 10001, 5000), ids) == 0);
+
+		CHECK(index.overlapping(makeRange(1, 0, 30000), ids) == 3);
+		CHECK(index.overlapsAny(makeRange(2, 0, 600)));
+		CHECK(not index.overlapsAny(makeRange(2, 601, 600)));
+		CHECK(not index.overlapsAny(makeRange(3, 0, 30000)));
+	}
+
+	TEST(SameAsOverlaps) {
+		// compare with GenomicRange::overlaps over pseudo-random ranges
+		std::vector<GenomicRange> ranges(300);
+		GenomicRangeIndex index;
+		unsigned long seed = 54321;
+		for(size_t i=0; i<ranges.size(); i++) {
+			seed = seed * 1103515245UL + 12345UL;
+			ranges[i].chrom = (seed >> 8) % 3 + 1;
+			seed = seed * 1103515245UL + 12345UL;
+			ranges[i].position = (seed >> 8) % 1000000;
+			seed = seed * 1103515245UL + 12345UL;
+			ranges[i].length = (seed >> 8) % ((i % 10 == 0) ? 200000 : 2000);
+			if(i < 200)
+				index.add(ranges[i], i);
+		}
+		index.build();
+
+		std::vector<size_t> ids;
+		for(size_t i=0; i<ranges.size(); i++) {
+			index.overlapping(ranges[i], ids);
+			std::vector<bool> found(ranges.size(), false);
+			for(size_t k=0; k<ids.size(); k++)
+				found[ids[k]] = true;
+
+			bool any = false;
+			for(size_t j=0; j<200; j++) {
+				bool overlaps = ranges[j].overlaps(ranges[i]);
+				CHECK(found[j] == overlaps);
+				any = any || overlaps;
+			}
+			CHECK(index.overlapsAny(ranges[i]) == any);
+		}
+	}
+
+	TEST(SameAsCNVEquality) {
+		// compare with CNV::isEqualTo over pseudo-random ranges
+		std::vector<CNV> cnvs(300);
+		GenomicRangeIndex index;
+		unsigned long seed = 12345;
+		for(size_t i=0; i<cnvs.size(); i++) {
+			seed = seed * 1103515245UL + 12345UL;
+			cnvs[i].range.chrom = (seed >> 8) % 3 + 1;
+			seed = seed * 1103515245UL + 12345UL;
+			cnvs[i].range.position = (seed >> 8) % 100000;
+			seed = seed * 1103515245UL + 12345UL;
+			cnvs[i].range.length = (seed >> 8) % 20000;
+			index.add(cnvs[i].range, i);
+		}
+		index.build();
+
+		std::vector<size_t> ids;
+		for(size_t i=0; i<cnvs.size(); i++) {
+			index.equalWithin(cnvs[i].range, 5000, ids);
+			std::vector<bool> found(cnvs.size(), false);
+			for(size_t k=0; k<ids.size(); k++)
+				found[ids[k]] = true;
+			for(size_t j=0; j<cnvs.size(); j++)
+				CHECK(found[j] == cnvs[i].isEqualTo(&cnvs[j], 5000));
+		}
+	}
+}
+
+TEST_MAIN
@@ -0,0 +1,88 @@
+/**
+ * @file Unit tests for class ObjectPool
+ *
+ * @see ObjectPool
+ * @author Yi Qiao
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013 Yi Qiao
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <vector>
+#include "ObjectPool.h"
+
+#include "common.h"
+using namespace SubcloneSeeker;
+
+/**
+ * Counts the live objects of its type
+ */
+struct Counted {
+	static int live; /**< the number of live objects */
+	int value; /**< a value, checked after copies */
+
+	Counted(): value(0) {live++;}
+	Counted(const Counted& other): value(other.value) {live++;}
+	~Counted() {live--;}
+};
+
+int Counted::live = 0;
+
+SUITE(testObjectPool) {
+	TEST(CreateAndClear) {
+		{
+			ObjectPool<Counted> pool(4);
+			CHECK(pool.size() == 0);
+			CHECK(pool.capacity() == 0);
+
+			std::vector<Counted *> objects;
+			for(int i=0; i<10; i++) {
+				objects.push_back(pool.create());
+				objects.back()->value = i;
+			}
+			CHECK(pool.size() == 10);
+			CHECK(pool.capacity() == 12);
+			CHECK(Counted::live == 10);
+
+			// objects stay in place as the pool grows
+			for(int i=0; i<10; i++)
+				CHECK(objects[i]->value == i);
+
+			Counted *copy = pool.create(*objects[7]);
+			CHECK(copy->value == 7);
+			CHECK(Counted::live == 11);
+
+			// the memory is kept, and reused
+			pool.clear();
+			CHECK(pool.size() == 0);
+			CHECK(pool.capacity() == 12);
+			CHECK(Counted::live == 0);
+			CHECK(pool.create() == objects[0]);
+
+			pool.create();
+		}
+		CHECK(Counted::live == 0);
+	}
+}
+
+TEST_MAIN
@@ -0,0 +1,217 @@
+/**
+ * @file Unit tests for class RefGenome
+ *
+ * @see RefGenome
+ * @author Yi Qiao
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013 Yi Qiao
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <cstdio>
+#include <fstream>
+#include <sqlite3/sqlite3.h>
+#include "RefGenome.h"
+
+#include "common.h"
+
+SUITE(testRefGenome) {
+	TEST(HG19) {
+		RefGenome *genome = RefGenome::getInstance();
+
+		CHECK(genome->vec_chroms().size() == 24);
+		CHECK(genome->queryChromID("chr1") == 1);
+		CHECK(genome->queryChromID("10") == 10);
+		CHECK(genome->queryChromID("chr10") == 10);
+		CHECK(genome->queryChromID("X") == 23);
+		CHECK(genome->queryChromID("chrY") == 24);
+
+		// chromosomes outside the genome are mapped by number only
+		CHECK(genome->queryChromID("25") == 25);
+		CHECK(genome->queryChromID("chrM") == 0);
+		CHECK(genome->queryChromID("chr1_gl000191_random") == 0);
+
+		CHECK(genome->queryChromLengthWithID(1) == 249904550);
+		CHECK(genome->queryChromLengthWithID(24) == 59373566);
+		CHECK(genome->queryChromLengthWithID(25) == 0);
+		CHECK(genome->queryChromStartBase(1) == 0);
+		CHECK(genome->queryChromStartBase(3) == 249904550UL + 243199373UL);
+		CHECK(genome->queryChromStartBase(24) + genome->queryChromLengthWithID(24) == genome->queryGenomeLength());
+		CHECK(genome->queryGenomeLength() == 3098113028UL);
+	}
+
+	TEST(LoadFromFai) {
+		{
+			std::ofstream out("test.fai");
+			out<<"chr1\t248956422\t112\t70\t71\n";
+			out<<"chrM\t16569\t252513167\t70\t71\n";
+			out<<"chr1_KI270706v1_random\t175055\t252530133\t70\t71\n";
+			out<<"chrX\t156040895\t252707717\t70\t71\n";
+		}
+
+		RefGenome *genome = RefGenome::getInstance();
+		CHECK(genome->loadFromFile("test.fai"));
+		remove("test.fai");
+
+		CHECK(genome->vec_chroms().size() == 4);
+		CHECK(genome->vec_chroms()[1] == "chrM");
+		CHECK(genome->queryChromID("chr1") == 1);
+		CHECK(genome->queryChromID("1") == 1);
+		CHECK(genome->queryChromID("chrX") == 23);
+		CHECK(genome->queryChromID("chrM") == 25);
+		CHECK(genome->queryChromID("M") == 25);
+		CHECK(genome->queryChromID("chr1_KI270706v1_random") == 26);
+		CHECK(genome->queryChromID("chr2") == 2);
+
+		CHECK(genome->queryChromLengthWithID(25) == 16569);
+		CHECK(genome->queryChromStartBase(23) == 248956422UL + 16569UL + 175055UL);
+		CHECK(genome->queryChromStartBase(2) == 0);
+		CHECK(genome->queryGenomeLength() == 248956422UL + 16569UL + 175055UL + 156040895UL);
+
+		genome->loadHG19();
+		CHECK(genome->vec_chroms().size() == 24);
+		CHECK(genome->queryChromID("chrM") == 0);
+	}
+
+	TEST(LoadFromDict) {
+		{
+			std::ofstream out("test.dict");
+			out<<"@HD\tVN:1.5\n";
+			out<<"@SQ\tSN:2\tLN:242193529\tM5:f98db672eb0993dcfdabafe2a882905c\n";
+			out<<"@SQ\tSN:GL000009.2\tLN:201709\n";
+		}
+
+		RefGenome *genome = RefGenome::getInstance();
+		CHECK(genome->loadFromFile("test.dict"));
+		remove("test.dict");
+
+		CHECK(genome->vec_chromIDs().size() == 2);
+		CHECK(genome->queryChromID("chr2") == 2);
+		CHECK(genome->queryChromID("GL000009.2") == 25);
+		CHECK(genome->queryChromStartBase(25) == 242193529UL);
+
+		// a malformed file leaves the genome unchanged
+		{
+			std::ofstream out("test.fai");
+			out<<"chr1\tlong\n";
+		}
+		CHECK(not genome->loadFromFile("test.fai"));
+		remove("test.fai");
+		CHECK(not genome->loadFromFile("test.fai"));
+		CHECK(genome->vec_chromIDs().size() == 2);
+
+		genome->loadHG19();
+	}
+
+	TEST(Interning) {
+		RefGenome *genome = RefGenome::getInstance();
+
+		CHECK(genome->internChrom("chr7") == 7);
+		CHECK(genome->queryChromName(7) == "chr7");
+
+		// chromosomes outside the genome get the next free id
+		CHECK(genome->internChrom("chrM") == 25);
+		CHECK(genome->internChrom("M") == 25);
+		CHECK(genome->queryChromID("chrM") == 25);
+		CHECK(genome->queryChromName(25) == "chrM");
+		CHECK(genome->queryChromLengthWithID(25) == 0);
+
+		// a number taken by another chromosome is not reused
+		CHECK(genome->queryChromID("25") == 0);
+		CHECK(genome->internChrom("25") == 26);
+		CHECK(genome->queryChromName(26) == "25");
+
+		// the table grows as names are added
+		char name[32];
+		for(int i=0; i<200; i++) {
+			sprintf(name, "contig%d", i);
+			CHECK(genome->internChrom(name) == 27 + i);
+		}
+		CHECK(genome->queryChromID("chrcontig123") == 150);
+		CHECK(genome->queryChromName(226) == "contig199");
+		CHECK(genome->queryChromName(227).empty());
+
+		// a large number is not used as id
+		CHECK(genome->internChrom("chr123456789") == 227);
+		CHECK(genome->internChrom("987654321") == 228);
+		CHECK(genome->queryChromID("123456789") == 227);
+		CHECK(genome->queryChromName(228) == "987654321");
+		CHECK(genome->queryChromName(123456789).empty());
+
+		// the dictionary ends with the last id given
+		sqlite3 *database;
+		std::vector<int> chromIDMap;
+		sqlite3_open(":memory:", &database);
+		CHECK(genome->archiveDictionaryToDB(database));
+		CHECK(genome->loadDictionaryFromDB(database, chromIDMap));
+		CHECK(chromIDMap.size() == 229);
+		sqlite3_close(database);
+
+		genome->loadHG19();
+		CHECK(genome->queryChromID("chrM") == 0);
+		CHECK(genome->queryChromName(25).empty());
+	}
+
+	TEST_FIXTURE(DBFixture, DictionaryRoundTrip) {
+		RefGenome *genome = RefGenome::getInstance();
+		std::vector<int> chromIDMap;
+
+		CHECK(not genome->loadDictionaryFromDB(database, chromIDMap));
+		CHECK(chromIDMap.empty());
+
+		genome->internChrom("chrM");
+		genome->internChrom("chrUn_gl000220");
+		CHECK(genome->archiveDictionaryToDB(database));
+
+		// the same genome maps every id onto itself
+		CHECK(genome->loadDictionaryFromDB(database, chromIDMap));
+		CHECK(chromIDMap.size() == 27);
+		for(int chromID=1; chromID<=26; chromID++)
+			CHECK(RefGenome::mapChromID(chromIDMap, chromID) == chromID);
+
+		// another genome maps the ids by name
+		genome->loadHG19();
+		genome->internChrom("chrUn_gl000220");
+		CHECK(genome->loadDictionaryFromDB(database, chromIDMap));
+		CHECK(RefGenome::mapChromID(chromIDMap, 1) == 1);
+		CHECK(RefGenome::mapChromID(chromIDMap, 24) == 24);
+		CHECK(RefGenome::mapChromID(chromIDMap, 25) == 26);
+		CHECK(RefGenome::mapChromID(chromIDMap, 26) == 25);
+		CHECK(genome->queryChromName(26) == "chrM");
+
+		// an id missing from the dictionary is unknown, even when this
+		// genome gives the same id to another chromosome
+		CHECK(genome->internChrom("contig27") == 27);
+		CHECK(RefGenome::mapChromID(chromIDMap, 27) == 0);
+		CHECK(RefGenome::mapChromID(chromIDMap, 30) == 0);
+		CHECK(RefGenome::mapChromID(chromIDMap, 0) == 0);
+
+		// without a dictionary, the ids are kept
+		std::vector<int> noDictionary;
+		CHECK(RefGenome::mapChromID(noDictionary, 27) == 27);
+
+		genome->loadHG19();
+	}
+}
+
+TEST_MAIN
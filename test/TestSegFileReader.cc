@@ -0,0 +1,138 @@
+/**
+ * @file Unit tests for class SegFileReader
+ *
+ * @see SegFileReader
+ * @author Yi Qiao
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013 Yi Qiao
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "SegFileReader.h"
+
+#include "common.h"
+using namespace SubcloneSeeker;
+
+SUITE(testSegFileReader) {
+	TEST(ReadString) {
+		SegFileReader reader;
+		CHECK(reader.readString(
+			"ID\tchrom\tloc.start\tloc.end\tnum.mark\tseg.mean\n"
+			"s1\t1\t0\t4902\t9\t-0.0490\n"
+			"\n"
+			"s1  chrX   1e+05  200000  12  1\r\n"
+			"s1\t22\t5002\t13860\t9\t0.58"));
+		CHECK(reader.size() == 3);
+
+		CHECK(reader.segment(0).range.chrom == 1);
+		CHECK(reader.segment(0).range.position == 0);
+		CHECK(reader.segment(0).range.length == 4902);
+		CHECK(reader.segment(0).frequency == pow(2, -0.049));
+
+		CHECK(reader.segment(1).range.chrom == 23);
+		CHECK(reader.segment(1).range.position == 100000);
+		CHECK(reader.segment(1).range.length == 100000);
+		CHECK_CLOSE(reader.segment(1).frequency, 2, 1e-12);
+
+		// the last line needs no line break
+		CHECK(reader.segment(2).range.chrom == 22);
+		CHECK(reader.segment(2).frequency == pow(2, 0.58));
+
+		reader.clear();
+		CHECK(reader.size() == 0);
+	}
+
+	TEST(MalformedContent) {
+		SegFileReader reader;
+		CHECK(reader.readString("ID chrom loc.start loc.end num.mark seg.mean\ns1 1 0 100 9 0.1\n"));
+		CHECK(reader.size() == 1);
+
+		CHECK(not reader.readString("ID chrom loc.start loc.end num.mark seg.mean\ns1 1 0 100 9 0.1\ns1 1 100 200 0.2\n"));
+		CHECK(reader.errorLine() == 3);
+		CHECK(reader.size() == 0);
+
+		CHECK(not reader.readString("ID chrom loc.start loc.end num.mark seg.mean\ns1 1 0 100 9 0.1 extra\n"));
+		CHECK(reader.errorLine() == 2);
+
+		CHECK(not reader.readString("ID chrom loc.start loc.end num.mark seg.mean\ns1 1 0 1.5e2x 9 0.1\n"));
+		CHECK(reader.errorLine() == 2);
+		CHECK(not reader.readString("ID chrom loc.start loc.end num.mark seg.mean\ns1 1 0 100 9 NA\n"));
+		CHECK(not reader.readString("ID chrom loc.start loc.end num.mark seg.mean\ns1 1 0 100.5 9 0.1\n"));
+
+		CHECK(not reader.readString(""));
+		CHECK(reader.errorLine() == 0);
+		CHECK(not reader.error().empty());
+	}
+
+	TEST(SameAsStrtod) {
+		std::ostringstream content;
+		std::vector<std::string> means;
+		content<<"ID chrom loc.start loc.end num.mark seg.mean\n";
+		unsigned long seed = 2013;
+		for(int i=0; i<2000; i++) {
+			seed = seed * 1103515245UL + 12345UL;
+			std::ostringstream mean;
+			mean.precision(1 + (seed >> 8) % 17);
+			mean<<((double)((seed >> 4) % 2000000) - 1000000) / 237.0;
+			if(i % 100 == 0 && mean.str().find('e') == std::string::npos)
+				mean<<"e-1";
+			means.push_back(mean.str());
+			content<<"s1 1 "<<i * 100<<" "<<i * 100 + 50<<" 3 "<<mean.str()<<"\n";
+		}
+
+		SegFileReader reader;
+		CHECK(reader.readString(content.str()));
+		CHECK(reader.size() == means.size());
+		for(size_t i=0; i<reader.size() && i<means.size(); i++)
+			CHECK(reader.segment(i).frequency == pow(2, strtod(means[i].c_str(), NULL)));
+	}
+
+	TEST(ReadFile) {
+		{
+			std::ofstream out("test.seg.txt");
+			out<<"ID\tchrom\tloc.start\tloc.end\tnum.mark\tseg.mean\n";
+			for(int i=0; i<100; i++)
+				out<<"s1\tchr"<<i % 22 + 1<<"\t"<<i * 1000<<"\t"<<i * 1000 + 500<<"\t10\t0.25\n";
+		}
+
+		SegFileReader reader;
+		CHECK(reader.read("test.seg.txt"));
+		CHECK(reader.size() == 100);
+		CHECK(reader.segment(99).range.chrom == 12);
+		CHECK(reader.segment(99).range.position == 99000);
+		CHECK(reader.segment(99).frequency == pow(2, 0.25));
+		remove("test.seg.txt");
+
+		CHECK(not reader.read("test.seg.txt"));
+		CHECK(reader.size() == 0);
+		CHECK(not reader.error().empty());
+	}
+}
+
+TEST_MAIN
@@ -106,6 +106,36 @@ SUITE(TestSomaticEvent) {
 		CHECK(cnv2.range.length==1000L);
 	}
 
+	TEST_FIXTURE(DBFixture, CNVToDBRepeatedly) {
+		// the table is created on the first archive, and the cached
+		// statements are reused by the following ones
+		SubcloneSeeker::CNV cnv;
+		for(int i=0; i<10; i++) {
+			cnv.setId(0);
+			cnv.frequency = 0.1 * i;
+			cnv.range.chrom = 1;
+			cnv.range.position = 1000L * i;
+			cnv.range.length = 1000L;
+			cnv.setClusterID(i % 2 + 1);
+			CHECK(cnv.archiveObjectToDB(database) > 0);
+		}
+
+		// archiving an object with an id updates its record
+		cnv.frequency = 0.5;
+		sqlite3_int64 id = cnv.archiveObjectToDB(database);
+		CHECK(id == cnv.getId());
+
+		CHECK(cnv.vecAllObjectsID(database).size() == 10);
+		CHECK(cnv.allObjectsOfCluster(database, 1).size() == 5);
+		CHECK(cnv.allObjectsOfCluster(database, 3).size() == 0);
+
+		SubcloneSeeker::CNV cnv2;
+		CHECK(cnv2.unarchiveObjectFromDB(database, id));
+		CHECK_CLOSE(cnv2.frequency, 0.5, 1e-3);
+		CHECK(cnv2.range.position == 9000L);
+		CHECK(not cnv2.unarchiveObjectFromDB(database, 100));
+	}
+
 	TEST(LOH) {
 		SubcloneSeeker::LOH loh;
 		CHECK_CLOSE( loh.frequency, 0, 1e-3);
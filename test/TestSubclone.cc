@@ -35,6 +35,7 @@ THE SOFTWARE.
 
 #include "Subclone.h"
 #include "EventCluster.h"
+#include "SegmentalMutation.h"
 
 #include "common.h"
 
@@ -112,6 +113,215 @@ SUITE(TestSubclone) {
 		CHECK_CLOSE(newChild11->fraction(), 0.1, 1e-3);
 		CHECK(newChild11->isLeaf());
 	}
+
+	TEST_FIXTURE(DBFixture, SubcloneTableIndexes) {
+		SubcloneSeeker::Subclone subclone;
+		SubcloneSeeker::EventCluster cluster;
+		CHECK(subclone.createTableInDB(database));
+		CHECK(cluster.createTableInDB(database));
+		CHECK(subclone.createIndexesInDB(database));
+
+		sqlite3_stmt *statement;
+		sqlite3_prepare_v2(database, "SELECT tbl_name FROM sqlite_master WHERE type='index' ORDER BY name;", -1, &statement, 0);
+		CHECK(sqlite3_step(statement) == SQLITE_ROW);
+		CHECK(std::string((const char *)sqlite3_column_text(statement, 0)) == "Clusters");
+		CHECK(sqlite3_step(statement) == SQLITE_ROW);
+		CHECK(std::string((const char *)sqlite3_column_text(statement, 0)) == "Subclones");
+		CHECK(sqlite3_step(statement) == SQLITE_DONE);
+		sqlite3_finalize(statement);
+	}
+
+	TEST_FIXTURE(DBFixture, SubcloneToDBInSession) {
+		SubcloneSeeker::Subclone root, child1, child2;
+
+		root.setFraction(0.7);
+		child1.setFraction(0.5);
+		child2.setFraction(0.2);
+
+		root.addChild(&child1);
+		root.addChild(&child2);
+
+		SubcloneSeeker::SubcloneSaveTreeTraverser stt(database);
+		SubcloneSeeker::ArchiveSession session(database);
+		CHECK(session.isActive());
+
+		// a committed inner session is kept
+		{
+			SubcloneSeeker::ArchiveSession treeSession(database);
+			SubcloneSeeker::TreeNode::PreOrderTraverse(&root, stt);
+			CHECK(treeSession.commit());
+			CHECK(not treeSession.isActive());
+		}
+
+		// an inner session that is not committed is rolled back
+		{
+			SubcloneSeeker::ArchiveSession treeSession(database);
+			SubcloneSeeker::TreeNode::PreOrderTraverse(&root, stt);
+			CHECK(root.vecAllObjectsID(database).size() == 6);
+		}
+
+		CHECK(session.commit());
+		CHECK(root.vecAllObjectsID(database).size() == 3);
+		CHECK(SubcloneSeeker::SubcloneLoadTreeTraverser::rootNodes(database).size() == 1);
+
+		// a rolled back session leaves the database untouched
+		SubcloneSeeker::ArchiveSession discarded(database);
+		SubcloneSeeker::TreeNode::PreOrderTraverse(&root, stt);
+		discarded.rollback();
+		CHECK(not discarded.isActive());
+		CHECK(root.vecAllObjectsID(database).size() == 3);
+	}
+
+	TEST_FIXTURE(DBFixture, SubcloneTreeLoader) {
+		SubcloneSeeker::Subclone root, child1, child2, child11;
+		SubcloneSeeker::EventCluster cluster1, cluster2;
+		SubcloneSeeker::CNV cnv1, cnv2, cnv3;
+
+		root.setFraction(0.2);
+		child1.setFraction(0.4);
+		child2.setFraction(0.3);
+		child11.setFraction(0.1);
+
+		cnv1.range.chrom = 1;
+		cnv2.range.chrom = 2;
+		cnv3.range.chrom = 3;
+		cluster1.addEvent(&cnv1, false);
+		cluster1.addEvent(&cnv2, false);
+		cluster2.addEvent(&cnv3, false);
+		child1.addEventCluster(&cluster1);
+		child11.addEventCluster(&cluster2);
+
+		root.addChild(&child1);
+		root.addChild(&child2);
+		child1.addChild(&child11);
+
+		// two copies of the tree
+		SubcloneSeeker::SubcloneSaveTreeTraverser stt(database);
+		SubcloneSeeker::TreeNode::PreOrderTraverse(&root, stt);
+		SubcloneSeeker::TreeNode::PreOrderTraverse(&root, stt);
+
+		SubcloneSeeker::SubcloneTreeLoader loader;
+		CHECK(loader.loadFromDB(database));
+		CHECK(loader.rootIDs() == SubcloneSeeker::SubcloneLoadTreeTraverser::rootNodes(database));
+		CHECK(loader.rootIDs().size() == 2);
+		CHECK(loader.buildTree(1000) == NULL);
+
+		for(size_t i=0; i<loader.rootIDs().size(); i++) {
+			SubcloneSeeker::Subclone *newRoot = loader.buildTree(loader.rootIDs()[i]);
+			CHECK(newRoot->getId() == loader.rootIDs()[i]);
+			CHECK(newRoot->isRoot());
+			CHECK_CLOSE(newRoot->fraction(), 0.2, 1e-3);
+			CHECK(newRoot->getVecChildren().size() == 2);
+
+			SubcloneSeeker::Subclone *newChild1 = dynamic_cast<SubcloneSeeker::Subclone *>(newRoot->getVecChildren()[0]);
+			SubcloneSeeker::Subclone *newChild2 = dynamic_cast<SubcloneSeeker::Subclone *>(newRoot->getVecChildren()[1]);
+			CHECK_CLOSE(newChild1->fraction(), 0.4, 1e-3);
+			CHECK_CLOSE(newChild2->fraction(), 0.3, 1e-3);
+			CHECK(newChild2->isLeaf());
+			CHECK(newChild2->vecEventCluster().size() == 0);
+
+			CHECK(newChild1->vecEventCluster().size() == 1);
+			CHECK(newChild1->vecEventCluster()[0]->members().size() == 2);
+			SubcloneSeeker::CNV *newCNV = dynamic_cast<SubcloneSeeker::CNV *>(newChild1->vecEventCluster()[0]->members()[1]);
+			CHECK(newCNV != NULL);
+			CHECK(newCNV->range.chrom == 2);
+
+			SubcloneSeeker::Subclone *newChild11 = dynamic_cast<SubcloneSeeker::Subclone *>(newChild1->getVecChildren()[0]);
+			CHECK_CLOSE(newChild11->fraction(), 0.1, 1e-3);
+			CHECK(newChild11->vecEventCluster().size() == 1);
+			CHECK(newChild11->vecEventCluster()[0]->members().size() == 1);
+
+			SubcloneSeeker::SubcloneTreeLoader::releaseTree(newRoot);
+		}
+	}
+
+	TEST_FIXTURE(DBFixture, SubcloneTreeInArena) {
+		SubcloneSeeker::Subclone root, child1, child2;
+		SubcloneSeeker::EventCluster cluster1;
+		SubcloneSeeker::CNV cnv1, cnv2;
+
+		root.setFraction(0.5);
+		child1.setFraction(0.3);
+		child2.setFraction(0.2);
+		cnv1.range.chrom = 1;
+		cnv2.range.chrom = 2;
+		cluster1.addEvent(&cnv1, false);
+		cluster1.addEvent(&cnv2, false);
+		child1.addEventCluster(&cluster1);
+		root.addChild(&child1);
+		root.addChild(&child2);
+
+		SubcloneSeeker::SubcloneSaveTreeTraverser stt(database);
+		SubcloneSeeker::TreeNode::PreOrderTraverse(&root, stt);
+
+		SubcloneSeeker::SubcloneArena arena(2);
+		SubcloneSeeker::SubcloneTreeLoader loader;
+		CHECK(loader.loadFromDB(database));
+		CHECK(loader.buildTree(1000, arena) == NULL);
+
+		SubcloneSeeker::Subclone *newRoot = loader.buildTree(loader.rootIDs()[0], arena);
+		CHECK(arena.size() == 6);
+		CHECK(newRoot->getVecChildren().size() == 2);
+		SubcloneSeeker::Subclone *newChild1 = dynamic_cast<SubcloneSeeker::Subclone *>(newRoot->getVecChildren()[0]);
+		CHECK_CLOSE(newChild1->fraction(), 0.3, 1e-3);
+		CHECK(newChild1->vecEventCluster().size() == 1);
+		CHECK(newChild1->vecEventCluster()[0]->members().size() == 2);
+
+		// the traverser loads the same tree into the arena
+		arena.clear();
+		CHECK(arena.size() == 0);
+		newRoot = arena.createSubclone();
+		newRoot->unarchiveObjectFromDB(database, loader.rootIDs()[0]);
+		SubcloneSeeker::SubcloneLoadTreeTraverser ltt(database, &arena);
+		SubcloneSeeker::TreeNode::PreOrderTraverse(newRoot, ltt);
+		CHECK(arena.size() == 6);
+		CHECK(newRoot->getVecChildren().size() == 2);
+	}
+
+	TEST_FIXTURE(DBFixture, ChromosomeDictionary) {
+		SubcloneSeeker::Subclone root, child1;
+		SubcloneSeeker::EventCluster cluster1;
+		SubcloneSeeker::CNV cnv1, cnv2, cnv3;
+
+		cnv1.range.chrom = 1;
+		cnv2.range.chrom = 2;
+		cnv3.range.chrom = 3;
+		cluster1.addEvent(&cnv1, false);
+		cluster1.addEvent(&cnv2, false);
+		cluster1.addEvent(&cnv3, false);
+		child1.addEventCluster(&cluster1);
+		root.addChild(&child1);
+
+		SubcloneSeeker::SubcloneSaveTreeTraverser stt(database);
+		SubcloneSeeker::TreeNode::PreOrderTraverse(&root, stt);
+
+		// the database numbers the first two chromosomes the other way
+		// around, and does not know the third
+		CHECK(sqlite3_exec(database, "CREATE TABLE Chromosomes (id INTEGER PRIMARY KEY, name TEXT NOT NULL, length INTEGER NOT NULL);"
+					"INSERT INTO Chromosomes VALUES (1, 'chr2', 0);"
+					"INSERT INTO Chromosomes VALUES (2, 'chr1', 0);", NULL, NULL, NULL) == SQLITE_OK);
+
+		SubcloneSeeker::SubcloneArena arena;
+		SubcloneSeeker::SubcloneTreeLoader loader;
+		CHECK(loader.loadFromDB(database));
+		SubcloneSeeker::Subclone *loadedRoot = loader.buildTree(loader.rootIDs()[0], arena);
+
+		SubcloneSeeker::Subclone *traversedRoot = arena.createSubclone();
+		traversedRoot->unarchiveObjectFromDB(database, loader.rootIDs()[0]);
+		SubcloneSeeker::SubcloneLoadTreeTraverser ltt(database, &arena);
+		SubcloneSeeker::TreeNode::PreOrderTraverse(traversedRoot, ltt);
+
+		// both loaders give the events the same chromosome ids
+		SubcloneSeeker::Subclone *roots[] = {loadedRoot, traversedRoot};
+		for(size_t i=0; i<2; i++) {
+			SubcloneSeeker::Subclone *newChild1 = dynamic_cast<SubcloneSeeker::Subclone *>(roots[i]->getVecChildren()[0]);
+			const SubcloneSeeker::SomaticEventPtr_vec& members = newChild1->vecEventCluster()[0]->members();
+			CHECK(members.size() == 3);
+			CHECK(dynamic_cast<SubcloneSeeker::CNV *>(members[0])->range.chrom == 2);
+			CHECK(dynamic_cast<SubcloneSeeker::CNV *>(members[1])->range.chrom == 1);
+			CHECK(dynamic_cast<SubcloneSeeker::CNV *>(members[2])->range.chrom == 0);
+		}
+	}
 }
 
 TEST_MAIN
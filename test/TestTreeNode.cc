@@ -29,12 +29,134 @@ THE SOFTWARE.
 */
 
 #include <iostream>
+#include <vector>
 #include "TreeNode.h"
 
 #include "common.h"
 
 using namespace SubcloneSeeker;
 
+/**
+ * Records the calls it receives, and terminates the traversal after a
+ * given number of them. When growing, it gives every node reached at
+ * depth 1 two new children as it is processed.
+ */
+class RecordingTraverser : public TreeTraverseDelegate {
+	public:
+		std::vector<int> calls; /**< the calls received, as 3 * node index + kind */
+		std::vector<TreeNode> *nodes; /**< the nodes of the tree */
+		size_t maxCalls; /**< the number of calls before termination */
+		bool growing; /**< if the tree grows while it is traversed */
+		size_t numGrown; /**< the number of nodes added so far */
+
+		RecordingTraverser(std::vector<TreeNode> *treeNodes, size_t limit, bool grow): nodes(treeNodes), maxCalls(limit), growing(grow), numGrown(0) {;}
+
+		void record(TreeNode *node, int kind) {
+			calls.push_back(3 * (node - &(*nodes)[0]) + kind);
+			if(calls.size() >= maxCalls)
+				terminate();
+		}
+
+		virtual void preprocessNode(TreeNode *node) {record(node, 0);}
+		virtual void processNode(TreeNode *node) {
+			record(node, 1);
+			if(growing && node->getParent() != NULL && node->getParent()->isRoot()) {
+				node->addChild(&(*nodes)[10 + numGrown++]);
+				node->addChild(&(*nodes)[10 + numGrown++]);
+			}
+		}
+		virtual void postprocessNode(TreeNode *node) {record(node, 2);}
+};
+
+/**
+ * Records the calls it receives, as RecordingTraverser, without virtual
+ * functions
+ */
+class RecordingVisitor : public TreeVisitor<TreeNode> {
+	public:
+		std::vector<int> calls; /**< the calls received, as 3 * node index + kind */
+		TreeNode *firstNode; /**< the first node of the tree */
+		size_t maxCalls; /**< the number of calls before termination */
+
+		RecordingVisitor(TreeNode *first, size_t limit): firstNode(first), maxCalls(limit) {;}
+
+		void record(TreeNode *node, int kind) {
+			calls.push_back(3 * (node - firstNode) + kind);
+			if(calls.size() >= maxCalls)
+				terminate();
+		}
+
+		void preprocessNode(TreeNode *node) {record(node, 0);}
+		void processNode(TreeNode *node) {record(node, 1);}
+		void postprocessNode(TreeNode *node) {record(node, 2);}
+};
+
+/**
+ * A node carrying a value
+ */
+class ValueNode : public TreeNode {
+	public:
+		int value; /**< the value */
+
+		ValueNode(): value(0) {;}
+};
+
+/**
+ * Sums the values of the nodes it is called on
+ */
+struct ValueSum {
+	int sum; /**< the sum so far */
+
+	ValueSum(): sum(0) {;}
+	void operator()(ValueNode *node) {sum += node->value;}
+};
+
+/**
+ * Build a tree of 10 nodes, with room for 10 more, and a NULL child
+ */
+static void buildTree(std::vector<TreeNode>& nodes) {
+	nodes.clear();
+	nodes.resize(20);
+	nodes[0].addChild(&nodes[1]);
+	nodes[0].addChild(&nodes[2]);
+	nodes[0].addChild(&nodes[3]);
+	nodes[1].addChild(&nodes[4]);
+	nodes[1].addChild(&nodes[5]);
+	nodes[5].addChild(&nodes[6]);
+	nodes[6].addChild(&nodes[7]);
+	nodes[3].addChild(&nodes[8]);
+	nodes[3].getVecChildren().push_back(NULL);
+	nodes[3].addChild(&nodes[9]);
+}
+
+/**
+ * Check that the recursive and the iterative traversals make the same
+ * calls, for every termination point
+ */
+static bool sameCalls(bool preOrder, bool growing) {
+	TreeTraverser traverser;
+	for(size_t limit=1; limit<80; limit++) {
+		std::vector<TreeNode> recursiveNodes, iterativeNodes;
+		buildTree(recursiveNodes);
+		buildTree(iterativeNodes);
+
+		RecordingTraverser recursive(&recursiveNodes, limit, growing);
+		RecordingTraverser iterative(&iterativeNodes, limit, growing);
+		if(preOrder) {
+			TreeNode::PreOrderTraverse(&recursiveNodes[0], recursive);
+			traverser.preOrderTraverse(&iterativeNodes[0], iterative);
+		}
+		else {
+			TreeNode::PostOrderTraverse(&recursiveNodes[0], recursive);
+			traverser.postOrderTraverse(&iterativeNodes[0], iterative);
+		}
+
+		if(recursive.calls != iterative.calls)
+			return false;
+	}
+	return true;
+}
+
 SUITE(testTreeNode) {
 	TEST(ObjectCreation) {
 
@@ -61,6 +183,68 @@ SUITE(testTreeNode) {
 		CHECK(c1.getParent() == NULL);
 		CHECK(root.getVecChildren().size() == 0);
 	}
+
+	TEST(IterativeTraverse) {
+		std::vector<TreeNode> nodes;
+		buildTree(nodes);
+		RecordingTraverser all(&nodes, 1000, false);
+		TreeTraverser traverser;
+		traverser.preOrderTraverse(&nodes[0], all);
+		CHECK(all.calls.size() == 30);
+		CHECK(all.calls[0] == 1 && all.calls[1] == 0 && all.calls[29] == 2);
+
+		CHECK(sameCalls(true, false));
+		CHECK(sameCalls(false, false));
+		CHECK(sameCalls(true, true));
+		CHECK(sameCalls(false, true));
+
+		// a terminated delegate is not called
+		RecordingTraverser none(&nodes, 0, false);
+		none.terminate();
+		traverser.preOrderTraverse(&nodes[0], none);
+		traverser.postOrderTraverse(&nodes[0], none);
+		traverser.preOrderTraverse(NULL, all);
+		CHECK(none.calls.empty());
+	}
+
+	TEST(TemplateVisit) {
+		std::vector<TreeNode> nodes;
+		buildTree(nodes);
+		TreeTraverser traverser;
+
+		// visitors see the same calls as delegates, up to any termination
+		bool samePreOrder = true, samePostOrder = true;
+		for(size_t limit=1; limit<40; limit++) {
+			RecordingTraverser delegate(&nodes, limit, false);
+			RecordingVisitor recursive(&nodes[0], limit), iterative(&nodes[0], limit);
+			TreeNode::PreOrderTraverse(&nodes[0], delegate);
+			TreeNode::PreOrderVisit(&nodes[0], recursive);
+			traverser.preOrderVisit(&nodes[0], iterative);
+			samePreOrder = samePreOrder && delegate.calls == recursive.calls && delegate.calls == iterative.calls;
+
+			RecordingTraverser postDelegate(&nodes, limit, false);
+			RecordingVisitor postRecursive(&nodes[0], limit), postIterative(&nodes[0], limit);
+			TreeNode::PostOrderTraverse(&nodes[0], postDelegate);
+			TreeNode::PostOrderVisit(&nodes[0], postRecursive);
+			traverser.postOrderVisit(&nodes[0], postIterative);
+			samePostOrder = samePostOrder && postDelegate.calls == postRecursive.calls && postDelegate.calls == postIterative.calls;
+		}
+		CHECK(samePreOrder);
+		CHECK(samePostOrder);
+
+		// the nodes are handed over as their own type
+		ValueNode root, child1, child2, grandchild;
+		root.value = 1; child1.value = 2; child2.value = 4; grandchild.value = 8;
+		root.addChild(&child1);
+		root.addChild(&child2);
+		child2.addChild(&grandchild);
+
+		ValueSum sum;
+		TreeNode::PreOrderForEach(&root, sum);
+		CHECK(sum.sum == 15);
+		TreeNode::PreOrderForEach(&child2, sum);
+		CHECK(sum.sum == 27);
+	}
 }
 
 TEST_MAIN
@@ -33,6 +33,7 @@ THE SOFTWARE.
 
 #include <UnitTest++/src/UnitTest++.h>
 #include <sqlite3/sqlite3.h>
+#include "Archivable.h"
 #include <cstdio>
 
 /* Fixtures */
@@ -45,7 +46,7 @@ struct DBFixture {
 	}
 
 	~DBFixture() {
-		sqlite3_close(database);
+		SubcloneSeeker::Archivable::closeDatabase(database);
 		remove("test.sqlite");
 	}
 };
@@ -25,23 +25,32 @@ THE SOFTWARE.
 #include <fstream>
 #include <vector>
 #include <cstdio>
-#include <assert.h>
+#include <cstdlib>
+#include <getopt.h>
 #include <algorithm>
-#include <numeric>
-#include <cmath>
 
 #include "EventCluster.h"
 #include "Subclone.h"
 #include "SegmentalMutation.h"
+#include "RefGenome.h"
+#include "SubcloneSeeker_p.h"
 
-#define EPISLON (0.01)
+/**
+ * The maximum number of viable trees waiting to be written
+ */
+#define OUTPUT_QUEUE_SIZE (1024)
 
-sqlite3 *res_database;
+/**
+ * The number of viable trees written to the result database in one transaction
+ */
+#define OUTPUT_BATCH_SIZE (10000)
 
-static int _num_solutions;
-static std::vector<int> _tree_depth;
+sqlite3 *res_database;
 
-using namespace SubcloneSeeker;
+static long _num_solutions;
+static long _sum_tree_depth;
+static int _num_threads;
+static char *_prog_name;
 
 int treeDepth(TreeNode *root) {
 	if(root->isLeaf())
@@ -56,24 +65,88 @@ int treeDepth(TreeNode *root) {
 	return 1+max_subtree_depth;
 }
 
-void TreeEnumeration(Subclone * root, std::vector<EventCluster> vecClusters, size_t symIdx);
-void TreeAssessment(Subclone * root, std::vector<EventCluster> vecClusters);
+// First of all, a tree traverser that will print out the tree.
+// This will be used when the program decides to output a tree
+	
+// Tree Print Traverser. This one will just print the symbol id
+// of the node that is given to it.
+class TreePrintTraverser: public TreeVisitor<Subclone> {
+	public:
+		void preprocessNode(Subclone *node) {
+			if(!node->isLeaf())
+				std::cerr<<"(";
+		}
+
+		void processNode(Subclone * node) {
+			std::cerr<<node->fraction()<<",";
+		}
+
+		void postprocessNode(Subclone *node) {
+			if(!node->isLeaf())
+				std::cerr<<")";
+		}
+};
+
+// Tree Recorder. Prints every viable tree, saves it to the result
+// database and collects the summary statistics. It runs on the writer
+// thread of an AsyncTreeDelegate
+class TreeRecorder: public TreeEnumerationDelegate {
+	public:
+		virtual void viableTreeFound(Subclone *root) {
+			TreePrintTraverser printTraverser;
+			std::cerr<<"Viable Tree! Pre-Orer: ";
+			TreeNode::PreOrderVisit(root, printTraverser);
+			std::cerr<<std::endl;
+
+			// save tree to database, as a whole or not at all
+			if(res_database != NULL) {
+				ArchiveSession session(res_database);
+				SubcloneSaveTreeTraverser stt(res_database);
+				TreeNode::PreOrderTraverse(root, stt);
+				session.commit();
+			}
+
+			_num_solutions++;
+			_sum_tree_depth += treeDepth(root);
+		}
+};
+
+void usage() {
+	std::cerr<<"Usage: "<<_prog_name<<" <cluster-archive-sqlite-db> [output-db]"<<std::endl;
+	std::cerr<<"\t\t Options:"<<std::endl;
+	std::cerr<<"\t\t -j threads\t[default = 1]\t\tThe number of threads used to enumerate the trees"<<std::endl;
+	exit(0);
+}
 
 int main(int argc, char* argv[])
 {
+	_prog_name = *argv;
+	_num_threads = 1;
+
+	int c;
+	while((c = getopt(argc, argv, "j:h")) != -1) {
+		switch(c) {
+			case 'j':
+				_num_threads = atoi(optarg); break;
+			default:
+				usage();
+				break;
+		}
+	}
+
+	argc -= optind; argv += optind;
 
-	if(argc < 2) {
-		std::cerr<<"Usage: "<<argv[0]<<" <cluster-archive-sqlite-db> [output-db]"<<std::endl;
-		return(0);
+	if(argc < 1 || _num_threads < 1) {
+		usage();
 	}
 
 	res_database=NULL;
 
 	sqlite3 *database;
 	int rc;
-	rc = sqlite3_open_v2(argv[1], &database, SQLITE_OPEN_READONLY, NULL);
+	rc = sqlite3_open_v2(argv[0], &database, SQLITE_OPEN_READONLY, NULL);
 	if(rc != SQLITE_OK) {
-		std::cerr<<"Unable to open database "<<argv[1]<<std::endl;
+		std::cerr<<"Unable to open database "<<argv[0]<<std::endl;
 		return(1);
 	}
 
@@ -86,6 +159,12 @@ int main(int argc, char* argv[])
 		return(1);
 	}
 
+	// map the chromosome ids of the database onto ours
+	std::vector<int> chromIDMap;
+	RefGenome::getInstance()->loadDictionaryFromDB(database, chromIDMap);
+
+	// the events live as long as the clusters referring to them
+	SubcloneArena eventArena;
 	std::vector<EventCluster> vecClusters;
 	for(size_t i=0; i<clusterIDs.size(); i++) {
 		EventCluster newCluster;
@@ -95,249 +174,50 @@ int main(int argc, char* argv[])
 		CNV dummyCNV;
 		DBObjectID_vec memberCNV_IDs = dummyCNV.allObjectsOfCluster(database, newCluster.getId());
 		for(size_t j=0; j<memberCNV_IDs.size(); j++) {
-			CNV *newCNV = new CNV();
+			CNV *newCNV = eventArena.createCNV();
 			newCNV->unarchiveObjectFromDB(database, memberCNV_IDs[j]);
+			newCNV->range.chrom = RefGenome::mapChromID(chromIDMap, newCNV->range.chrom);
 			newCluster.addEvent(newCNV, false);
 		}
 
 		vecClusters.push_back(newCluster);
 	}
 
-	sqlite3_close(database);
+	Archivable::closeDatabase(database);
 
 	std::sort(vecClusters.begin(), vecClusters.end());
 	std::reverse(vecClusters.begin(), vecClusters.end());
 
-	// Mutation list read. Start to enumerate trees
-	// 1. Create a node contains no mutation (symId = 0).
-	// this node will act as the root of the trees
-	Subclone *root = new Subclone();
-	root->setFraction(-1);
-	root->setTreeFraction(-1);
-
 	if(argc >= 2) {
-		int rc = sqlite3_open(argv[2], &res_database);
+		int rc = sqlite3_open(argv[1], &res_database);
 		if(rc != SQLITE_OK ) {
 			std::cerr<<"Unable to open result database for writting."<<std::endl;
 			return(1);
 		}
+		Archivable::tuneDatabaseForWriting(res_database);
+		if(not RefGenome::getInstance()->archiveDictionaryToDB(res_database)) {
+			std::cerr<<"Unable to write the chromosome dictionary into the result database."<<std::endl;
+			return(1);
+		}
 	}
 	
-	TreeEnumeration(root, vecClusters, 0);	
+	// Mutation list read. Start to enumerate trees
+	ClusterTable clusterTable(vecClusters);
+	// Viable trees are printed and saved by a separate writer thread, in
+	// large transactions, while the enumeration goes on
+	TreeRecorder recorder;
+	AsyncTreeDelegate writer(recorder, OUTPUT_QUEUE_SIZE, res_database, OUTPUT_BATCH_SIZE);
+	if(_num_threads > 1)
+		ParallelTreeEnumeration(clusterTable, _num_threads, writer);
+	else
+		TreeEnumeration(clusterTable, writer);
+	writer.finish();
 
 	if(res_database != NULL) 
-		sqlite3_close(res_database);
+		Archivable::closeDatabase(res_database);
 
-	if(_tree_depth.size()> 0)
-		std::cout<<_num_solutions<<"\t"<<std::accumulate(_tree_depth.begin(), _tree_depth.end(), 0)/float(_tree_depth.size())<<std::endl;
+	if(_num_solutions > 0)
+		std::cout<<_num_solutions<<"\t"<<_sum_tree_depth/float(_num_solutions)<<std::endl;
 
 	return 0;
 }
-
-// First of all, a tree traverser that will print out the tree.
-// This will be used when the program decides to output a tree
-	
-// Tree Print Traverser. This one will just print the symbol id
-// of the node that is given to it.
-class TreePrintTraverser: public TreeTraverseDelegate {
-	public:
-		virtual void preprocessNode(TreeNode *node) {
-			if(!node->isLeaf())
-				std::cerr<<"(";
-		}
-
-		virtual void processNode(TreeNode * node) {
-			std::cerr<<((Subclone *)node)->fraction()<<",";
-		}
-
-		virtual void postprocessNode(TreeNode *node) {
-			if(!node->isLeaf())
-				std::cerr<<")";
-		}
-};
-
-// This function will recursively construct all possible tree structures
-// using the given mutation list, starting with the mutation identified by symIdx
-//
-// The idea behind this is quite simple. If a node is not the last symbol on the 
-// mutation list, it will try to add this particular node to every other existing
-// node's children list. After one addition, the traverser calls the TreeEnumeration
-// again but with a incremented symIdx, so that the next symbol can be treated in the
-// same way. When the last symbol has been reached, the tree is printed out, in both
-// Pre-Order and Post-Order, by the TreePrintTraverser class, so that each tree can be 
-// uniquely identified.
-
-void TreeEnumeration(Subclone * root, std::vector<EventCluster> vecClusters, size_t symIdx)
-{	
-	// Tree Enum Traverser. It will check if the last symbol has been
-	// treated or not. If yes, the tree is complete and it will call
-	// TreeAssessment to assess the viability of the tree; If no, it 
-	// will add the current untreated symbol as a children to the node 
-	// that is given to it, and call TreeEnumeration again to go into 
-	// one more level of the recursion.
-	class TreeEnumTraverser : public TreeTraverseDelegate {
-	protected:
-		// Some state variables that the TreeEnumeration
-		// function needs to expose to the traverser
-		std::vector<EventCluster>& _vecClusters;
-		size_t _symIdx;
-		Subclone *_floatNode;
-		Subclone *_root;
-		
-	public:
-		
-		TreeEnumTraverser(std::vector<EventCluster>& vecClusters,
-						  size_t symIdx,
-						  Subclone *floatNode,
-						  Subclone *root):
-						_vecClusters(vecClusters), _symIdx(symIdx), 
-						_floatNode(floatNode), _root(root) {;}
-								
-		
-		virtual void processNode(TreeNode * node) {
-			Subclone *clone = dynamic_cast<Subclone *>(node);
-			
-			// Add the floating node as the chilren of the current node
-			clone->addChild(_floatNode);
-			
-			// Move on to the next symbol
-			TreeEnumeration(_root, _vecClusters, _symIdx);
-			
-			// Remove the child
-			node->removeChild(_floatNode);
-		}
-	};
-
-	if(symIdx == vecClusters.size()) {
-		TreeAssessment(root, vecClusters);
-		return;
-	}
-
-	// Create the new tree node
-	Subclone *newClone = new Subclone();
-	newClone->setFraction(-1);
-	newClone->setTreeFraction(-1);
-	newClone->addEventCluster(&vecClusters[symIdx]);
-
-	// add more cluster into the same subclone if they share
-	// the same frequency. This is unlikely to happen if
-	// the clusters are generated from a clustering algorithm
-	// run on the raw data. But when using external dataset this
-	// could be possible
-	float currentFraction = vecClusters[symIdx].cellFraction();
-	symIdx++;
-
-	while(symIdx < vecClusters.size() && 
-			fabs(vecClusters[symIdx].cellFraction() - currentFraction) < EPISLON) {
-		newClone->addEventCluster(&vecClusters[symIdx]);
-		symIdx++;
-	}
-
-	// Configure the tree traverser
-	TreeEnumTraverser TreeEnumTraverserObj(vecClusters, symIdx, newClone, root);
-	
-	// Traverse the tree
-	TreeNode::PreOrderTraverse(root, TreeEnumTraverserObj);
-	
-	delete newClone;
-}
-
-void TreeAssessment(Subclone * root, std::vector<EventCluster> vecClusters)
-{
-	class FracAsnTraverser : public TreeTraverseDelegate {
-	protected:
-		std::vector<EventCluster>& _vecClusters;
-		
-	public:
-		FracAsnTraverser(std::vector<EventCluster>& vecClusters): _vecClusters(vecClusters) {;}
-		virtual void processNode(TreeNode * node) {
-
-			Subclone *clone = dynamic_cast<Subclone *>(node);
-
-			if(node->isLeaf()) {
-				// direct assign
-				((Subclone *)node)->setFraction(((Subclone *)node)->vecEventCluster()[0]->cellFraction());
-				((Subclone *)node)->setTreeFraction(((Subclone *)node)->vecEventCluster()[0]->cellFraction());
-			}
-			else {
-				// intermediate node. assign it's mutation fraction - subtree_fraction
-				// actually, if it's root, assign 1
-				if(clone->isRoot()) 
-					clone->setTreeFraction(1);
-				else 
-					clone->setTreeFraction(clone->vecEventCluster()[0]->cellFraction());
-				
-				assert(clone->treeFraction() >= -EPISLON && clone->treeFraction() <= 1 + EPISLON);
-							
-				double childrenFraction = 0;
-				for(size_t i=0; i<node->getVecChildren().size(); i++) 
-					childrenFraction += ((Subclone *)node->getVecChildren()[i])->treeFraction();
-									
-				double nodeFraction = ((Subclone *)node)->treeFraction() - childrenFraction;
-
-				if(nodeFraction < EPISLON && nodeFraction > -EPISLON)
-					nodeFraction = 0;
-				
-				// check tree viability
-				if(nodeFraction < -EPISLON) {
-					terminate();
-				}
-				else {
-					((Subclone *)node)->setFraction(nodeFraction);
-					assert(((Subclone *)node)->fraction() >= -EPISLON && ((Subclone *)node)->fraction() <= 1+EPISLON);
-				}
-			}
-		}
-	};
-	
-	// Fraction Reset Traverser. This will go through the nodes and
-	// reset the fraction to uninitialized state so that the same nodes
-	// can be used for another structure's evaluation
-	class NodeResetTraverser : public TreeTraverseDelegate {
-	public:
-		virtual void processNode(TreeNode * node) {
-			((Subclone *)node)->setFraction(-1);
-			((Subclone *)node)->setTreeFraction(-1);
-			((Subclone *)node)->setParentId(0);
-			((Subclone *)node)->setId(0);
-
-		}
-	};
-		
-	// check if the root is sane
-	if(root == NULL)
-		return;
-
-	// reset node and tree fractions
-	NodeResetTraverser nrTraverser;
-	TreeNode::PreOrderTraverse(root, nrTraverser);
-
-	// calcuate tree fractions
-	FracAsnTraverser fracTraverser(vecClusters);
-	TreeNode::PostOrderTraverse(root, fracTraverser);
-	
-	// if the tree is viable, output it
-	if(root->fraction() >= -EPISLON) {
-		TreePrintTraverser printTraverser;
-		std::cerr<<"Viable Tree! Pre-Orer: ";
-		TreeNode::PreOrderTraverse(root, printTraverser);
-		std::cerr<<std::endl;
-
-		// save tree to database
-		if(res_database != NULL) {
-			SubcloneSaveTreeTraverser stt(res_database);
-			TreeNode::PreOrderTraverse(root, stt);
-		}
-
-		_num_solutions++;
-		_tree_depth.push_back(treeDepth(root));
-	}
-	else
-	{
-		TreePrintTraverser printTraverser;
-		std::cerr<<"Unviable Tree! Pre-Orer: ";
-		TreeNode::PreOrderTraverse(root, printTraverser);
-		std::cerr<<std::endl;
-
-	}
-}
@@ -0,0 +1,158 @@
+/**
+ * @file SubcloneSeeker_bench.cc
+ * Benchmark for the tree enumeration of ssmain. It enumerates all the trees
+ * of two synthetic cluster lists, one where most placements are viable and
+ * one where most are pruned, and reports the run time and the heap traffic
+ * per viable tree.
+ *
+ * Usage: ssmain.bench [number of clusters = 10] [events per cluster = 20] [threads = 1]
+ *
+ * @author Yi Qiao
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013 Yi Qiao
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <iostream>
+#include <vector>
+#include <new>
+#include <cstdlib>
+#include <sys/time.h>
+#include "SubcloneSeeker_p.h"
+
+#include "EventCluster.h"
+#include "SegmentalMutation.h"
+#include "Subclone.h"
+
+using namespace SubcloneSeeker;
+
+// Heap traffic counters, updated by the replacement operator new below.
+// Only read after all the worker threads have been joined.
+static size_t _num_allocations;
+static size_t _num_bytes;
+
+void *operator new(std::size_t size) {
+	__sync_fetch_and_add(&_num_allocations, 1);
+	__sync_fetch_and_add(&_num_bytes, size);
+	void *p = malloc(size == 0 ? 1 : size);
+	if(p == NULL)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void *p) throw() {
+	free(p);
+}
+
+// Sized deallocation must release memory the same way, or the compiler
+// may pair the replacement operator new with the library's sized delete
+void operator delete(void *p, std::size_t) throw() {
+	operator delete(p);
+}
+
+// Counts the trees without looking at them
+class TreeCounter : public TreeEnumerationDelegate {
+	public:
+		size_t numViableTrees;
+
+		TreeCounter(): numViableTrees(0) {;}
+
+		virtual void viableTreeFound(Subclone * /* root */) {
+			numViableTrees++;
+		}
+};
+
+static double now() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+// Enumerate the trees of one synthetic cluster list and report the results
+static void runBenchmark(const char *name, const std::vector<double>& fractions, int numEvents, int numThreads) {
+	std::vector<EventCluster> vecClusters;
+	SomaticEventPtr_vec events;
+	for(size_t i=0; i<fractions.size(); i++) {
+		EventCluster cluster;
+		cluster.setCellFraction(fractions[i]);
+		for(int j=0; j<numEvents; j++) {
+			CNV *event = new CNV();
+			event->range.chrom = j % 22 + 1;
+			event->range.position = i * 1000000L;
+			event->range.length = 500000L;
+			cluster.addEvent(event, false);
+			events.push_back(event);
+		}
+		vecClusters.push_back(cluster);
+	}
+
+	TreeCounter counter;
+	size_t allocationsBefore = _num_allocations;
+	size_t bytesBefore = _num_bytes;
+	double start = now();
+
+	ClusterTable table(vecClusters);
+	if(numThreads > 1)
+		ParallelTreeEnumeration(table, numThreads, counter);
+	else
+		TreeEnumeration(table, counter);
+
+	double elapsed = now() - start;
+	size_t allocations = _num_allocations - allocationsBefore;
+	size_t bytes = _num_bytes - bytesBefore;
+	size_t numTrees = counter.numViableTrees;
+
+	std::cout<<name<<" fractions, clusters: "<<fractions.size()<<"\tevents/cluster: "<<numEvents<<"\tthreads: "<<numThreads<<std::endl;
+	std::cout<<"\tviable trees: "<<numTrees<<std::endl;
+	std::cout<<"\ttime: "<<elapsed<<"s"<<std::endl;
+	std::cout<<"\tallocations: "<<allocations<<"\tper tree: "<<(numTrees > 0 ? double(allocations) / numTrees : 0)<<std::endl;
+	std::cout<<"\tbytes allocated: "<<bytes<<"\tper tree: "<<(numTrees > 0 ? double(bytes) / numTrees : 0)<<std::endl;
+
+	for(size_t i=0; i<events.size(); i++)
+		delete events[i];
+}
+
+int main(int argc, char *argv[]) {
+	int numClusters = argc > 1 ? atoi(argv[1]) : 10;
+	int numEvents = argc > 2 ? atoi(argv[2]) : 20;
+	int numThreads = argc > 3 ? atoi(argv[3]) : 1;
+
+	// geometrically decreasing cluster fractions, so that a good share
+	// of the placements is viable
+	std::vector<double> fractions;
+	double fraction = 0.95;
+	for(int i=0; i<numClusters; i++) {
+		fractions.push_back(fraction);
+		fraction *= 0.6;
+	}
+	runBenchmark("geometric", fractions, numEvents, numThreads);
+
+	// evenly spaced cluster fractions, where most placements overfill
+	// a node and are pruned
+	fractions.clear();
+	for(int i=0; i<numClusters; i++)
+		fractions.push_back(0.5 - 0.45 * i / numClusters);
+	runBenchmark("linear", fractions, numEvents, numThreads);
+
+	return 0;
+}
@@ -0,0 +1,610 @@
+/**
+ * @file SubcloneSeeker_p.cc
+ * The implementation file for the implementation part of 'ssmain'
+ *
+ * @author Yi Qiao
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013 Yi Qiao
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include "SubcloneSeeker_p.h"
+#include <assert.h>
+#include <cmath>
+#include <deque>
+#include <pthread.h>
+
+#include "EventCluster.h"
+#include "Subclone.h"
+
+size_t nextSymbolIndex(const std::vector<EventCluster>& vecClusters, size_t symIdx) {
+	// add more cluster into the same subclone if they share
+	// the same frequency. This is unlikely to happen if
+	// the clusters are generated from a clustering algorithm
+	// run on the raw data. But when using external dataset this
+	// could be possible
+	float currentFraction = vecClusters[symIdx].cellFraction();
+	symIdx++;
+
+	while(symIdx < vecClusters.size() &&
+			fabs(vecClusters[symIdx].cellFraction() - currentFraction) < EPISLON) {
+		symIdx++;
+	}
+
+	return symIdx;
+}
+
+ClusterTable::ClusterTable(std::vector<EventCluster>& vecClusters): _vecClusters(vecClusters) {
+	for(size_t symIdx = 0; symIdx < vecClusters.size(); symIdx = nextSymbolIndex(vecClusters, symIdx))
+		_symbolStart.push_back(symIdx);
+	_symbolStart.push_back(vecClusters.size());
+}
+
+Subclone *ClusterTable::createRootNode() const {
+	Subclone *root = new Subclone();
+	root->setFraction(1);
+	root->setTreeFraction(1);
+	return root;
+}
+
+Subclone *ClusterTable::createSymbolNode(size_t symIdx) const {
+	Subclone *newClone = new Subclone();
+	newClone->setFraction(symbolFraction(symIdx));
+	newClone->setTreeFraction(symbolFraction(symIdx));
+
+	for(size_t i=_symbolStart[symIdx]; i<_symbolStart[symIdx+1]; i++)
+		newClone->addEventCluster(&_vecClusters[i]);
+
+	return newClone;
+}
+
+EnumerationTree::EnumerationTree(const ClusterTable& table): _table(table), _numAttached(0) {
+	size_t numNodes = table.numSymbols() + 1;
+
+	_parents.reserve(numNodes);
+	_treeFraction.reserve(numNodes);
+	_childrenFraction.assign(numNodes, 0);
+	_numChildren.assign(numNodes, 0);
+	_savedChildrenFraction.reserve(numNodes);
+	_nodes.reserve(numNodes);
+
+	// the root takes the whole sample, and has no parent
+	_parents.push_back(0);
+	_treeFraction.push_back(1);
+	_nodes.push_back(table.createRootNode());
+
+	for(size_t i=0; i<table.numSymbols(); i++) {
+		_treeFraction.push_back(table.symbolFraction(i));
+		_nodes.push_back(table.createSymbolNode(i));
+	}
+}
+
+EnumerationTree::~EnumerationTree() {
+	for(size_t i=0; i<_nodes.size(); i++)
+		delete _nodes[i];
+}
+
+bool EnumerationTree::place(size_t parent) {
+	size_t node = _parents.size();
+	assert(parent < node && node < _treeFraction.size());
+
+	double childrenFraction = _childrenFraction[parent] + _treeFraction[node];
+
+	// Cell fractions are non-negative, so once the children of a node
+	// take more than its tree fraction, no placement of the remaining
+	// symbols can make the tree viable again
+	if(_treeFraction[parent] - childrenFraction < -EPISLON)
+		return false;
+
+	_savedChildrenFraction.push_back(_childrenFraction[parent]);
+	_childrenFraction[parent] = childrenFraction;
+	_numChildren[parent]++;
+	_parents.push_back(parent);
+	return true;
+}
+
+void EnumerationTree::unplace() {
+	assert(numPlaced() > 0);
+
+	size_t node = _parents.size() - 1;
+	size_t parent = _parents.back();
+
+	// the node is the last child of its parent in the Subclone graph
+	bool attached = node <= _numAttached;
+	if(attached) {
+		_nodes[parent]->removeChild(_nodes[node]);
+		_numAttached = node - 1;
+	}
+
+	_parents.pop_back();
+	_numChildren[parent]--;
+	_childrenFraction[parent] = _savedChildrenFraction.back();
+	_savedChildrenFraction.pop_back();
+
+	if(attached)
+		updateNodeFraction(parent);
+}
+
+void EnumerationTree::updateNodeFraction(size_t node) {
+	// a leaf takes its whole tree fraction. an intermediate node
+	// takes what its children left
+	double nodeFraction = _treeFraction[node];
+	if(_numChildren[node] > 0) {
+		nodeFraction = _treeFraction[node] - _childrenFraction[node];
+		if(nodeFraction < EPISLON && nodeFraction > -EPISLON)
+			nodeFraction = 0;
+	}
+
+	assert(nodeFraction >= -EPISLON && nodeFraction <= 1+EPISLON);
+	_nodes[node]->setFraction(nodeFraction);
+}
+
+void EnumerationTree::emit(TreeEnumerationDelegate& delegate) {
+	assert(isComplete());
+
+	// Bring the Subclone graph up to date. Only the nodes placed since the
+	// last complete tree need to be attached, and only their parents have
+	// new fractions; the rest is still in place, and a detached node always
+	// has all of its children detached before it, leaving it a leaf.
+	// Children are attached in symbol order, so that their order, and the
+	// order in which their fractions were summed up, match the tree
+	for(size_t i=_numAttached+1; i<_nodes.size(); i++) {
+		_nodes[_parents[i]]->addChild(_nodes[i]);
+		updateNodeFraction(_parents[i]);
+	}
+	_numAttached = _nodes.size() - 1;
+
+	delegate.viableTreeFound(_nodes[0]);
+}
+
+// This function will recursively construct all possible tree structures,
+// starting with the first symbol that has not been placed yet
+//
+// The idea behind this is quite simple. If a node is not the last symbol on the
+// mutation list, it will try to add this particular node to every other existing
+// node's children list. After one addition, TreeEnumeration is called again so
+// that the next symbol can be treated in the same way. When the last symbol has
+// been placed, the tree is handed to the delegate. Placements that overfill a
+// node are refused by the tree, which prunes the whole branch.
+
+void TreeEnumeration(EnumerationTree& tree, TreeEnumerationDelegate& delegate)
+{
+	if(tree.isComplete()) {
+		tree.emit(delegate);
+		return;
+	}
+
+	size_t numNodes = tree.numPlaced() + 1;
+	for(size_t parent=0; parent<numNodes; parent++) {
+		if(tree.place(parent)) {
+			TreeEnumeration(tree, delegate);
+			tree.unplace();
+		}
+	}
+}
+
+void TreeEnumeration(const ClusterTable& table, TreeEnumerationDelegate& delegate)
+{
+	EnumerationTree tree(table);
+	TreeEnumeration(tree, delegate);
+}
+
+/*******************************/
+/*  PARALLEL TREE ENUMERATION  */
+/*******************************/
+
+/**
+ * @brief An independent subproblem of the enumeration
+ *
+ * A task describes a partial tree by the placement of its first few symbols.
+ * The i-th entry of parents is the node to which the i-th symbol is attached,
+ * where 0 stands for the root and k for the node holding the k-th symbol.
+ */
+struct EnumerationTask {
+	std::vector<size_t> parents; /**< placement of the symbols already in the tree */
+};
+
+/**
+ * @brief Delegate adaptor that serializes the calls made from all workers
+ */
+class SerializedEnumerationDelegate : public TreeEnumerationDelegate {
+	protected:
+		TreeEnumerationDelegate& _delegate;
+		pthread_mutex_t _lock;
+
+	public:
+		SerializedEnumerationDelegate(TreeEnumerationDelegate& delegate): _delegate(delegate) {
+			pthread_mutex_init(&_lock, NULL);
+		}
+
+		virtual ~SerializedEnumerationDelegate() {
+			pthread_mutex_destroy(&_lock);
+		}
+
+		virtual void viableTreeFound(Subclone *root) {
+			pthread_mutex_lock(&_lock);
+			_delegate.viableTreeFound(root);
+			pthread_mutex_unlock(&_lock);
+		}
+};
+
+/**
+ * @brief A task deque owned by one worker
+ *
+ * The owner pushes and pops tasks at the back, while other workers steal
+ * from the front, where the tasks describing the largest subtrees are.
+ */
+struct EnumerationTaskDeque {
+	std::deque<EnumerationTask> tasks;
+	pthread_mutex_t lock;
+};
+
+/**
+ * @brief State shared by all the workers of a parallel enumeration
+ */
+struct ParallelEnumerationState {
+	const ClusterTable *table; /**< the shared, read only cluster table */
+	std::vector<EnumerationTaskDeque> deques; /**< one deque per worker */
+	TreeEnumerationDelegate *delegate; /**< the serialized delegate */
+
+	pthread_mutex_t lock; /**< protects the counters below */
+	pthread_cond_t workAvailable; /**< signaled when tasks are queued or all work is done */
+	size_t queuedTasks; /**< tasks sitting in any deque */
+	size_t outstandingTasks; /**< tasks queued or being worked on */
+	int idleWorkers; /**< workers waiting for tasks */
+};
+
+/**
+ * @brief Arguments handed to a worker thread
+ */
+struct EnumerationWorkerArgs {
+	ParallelEnumerationState *state;
+	size_t workerIdx;
+};
+
+// Split a task by placing its next symbol under every node of the partial tree
+static std::vector<EnumerationTask> ExpandTask(const EnumerationTask& task) {
+	std::vector<EnumerationTask> subtasks;
+
+	for(size_t p=0; p<=task.parents.size(); p++) {
+		EnumerationTask subtask;
+		subtask.parents = task.parents;
+		subtask.parents.push_back(p);
+		subtasks.push_back(subtask);
+	}
+	return subtasks;
+}
+
+// Replay the placements of a task on the worker's private tree, enumerate
+// the remaining symbols and undo the placements again. Tasks whose partial
+// tree is already unviable are dropped
+static void RunTask(const EnumerationTask& task, EnumerationTree& tree, TreeEnumerationDelegate& delegate) {
+	size_t numPlaced = 0;
+	while(numPlaced < task.parents.size() && tree.place(task.parents[numPlaced]))
+		numPlaced++;
+
+	if(numPlaced == task.parents.size())
+		TreeEnumeration(tree, delegate);
+
+	for(; numPlaced > 0; numPlaced--)
+		tree.unplace();
+}
+
+// Queue tasks on a worker's deque and wake up idle workers
+static void PushTasks(ParallelEnumerationState *state, size_t workerIdx, const std::vector<EnumerationTask>& tasks) {
+	EnumerationTaskDeque& dq = state->deques[workerIdx];
+	pthread_mutex_lock(&dq.lock);
+	for(size_t i=0; i<tasks.size(); i++)
+		dq.tasks.push_back(tasks[i]);
+	pthread_mutex_unlock(&dq.lock);
+
+	pthread_mutex_lock(&state->lock);
+	state->queuedTasks += tasks.size();
+	state->outstandingTasks += tasks.size();
+	pthread_cond_broadcast(&state->workAvailable);
+	pthread_mutex_unlock(&state->lock);
+}
+
+// Take a task from the worker's own deque, or steal one from another worker
+static bool AcquireTask(ParallelEnumerationState *state, size_t workerIdx, EnumerationTask& task) {
+	size_t numWorkers = state->deques.size();
+	bool found = false;
+
+	for(size_t i=0; i<numWorkers && !found; i++) {
+		size_t victim = (workerIdx + i) % numWorkers;
+		EnumerationTaskDeque& dq = state->deques[victim];
+
+		pthread_mutex_lock(&dq.lock);
+		if(!dq.tasks.empty()) {
+			if(victim == workerIdx) {
+				task = dq.tasks.back();
+				dq.tasks.pop_back();
+			}
+			else {
+				task = dq.tasks.front();
+				dq.tasks.pop_front();
+			}
+			found = true;
+		}
+		pthread_mutex_unlock(&dq.lock);
+	}
+
+	if(found) {
+		pthread_mutex_lock(&state->lock);
+		state->queuedTasks--;
+		pthread_mutex_unlock(&state->lock);
+	}
+
+	return found;
+}
+
+static void *EnumerationWorker(void *arg) {
+	EnumerationWorkerArgs *args = (EnumerationWorkerArgs *)arg;
+	ParallelEnumerationState *state = args->state;
+
+	// the worker's private tree. The clusters it points to are shared
+	EnumerationTree tree(*state->table);
+
+	while(true) {
+		EnumerationTask task;
+
+		if(!AcquireTask(state, args->workerIdx, task)) {
+			pthread_mutex_lock(&state->lock);
+			if(state->outstandingTasks == 0) {
+				pthread_mutex_unlock(&state->lock);
+				break;
+			}
+			if(state->queuedTasks == 0) {
+				state->idleWorkers++;
+				pthread_cond_wait(&state->workAvailable, &state->lock);
+				state->idleWorkers--;
+			}
+			pthread_mutex_unlock(&state->lock);
+			continue;
+		}
+
+		// If some workers are starving and there are enough symbols left
+		// for the task to be worth splitting, split it one more level and
+		// leave the subtasks for others to steal
+		pthread_mutex_lock(&state->lock);
+		bool shouldSplit = state->idleWorkers > 0 && task.parents.size() + 2 < state->table->numSymbols();
+		pthread_mutex_unlock(&state->lock);
+
+		if(shouldSplit)
+			PushTasks(state, args->workerIdx, ExpandTask(task));
+		else
+			RunTask(task, tree, *state->delegate);
+
+		pthread_mutex_lock(&state->lock);
+		state->outstandingTasks--;
+		if(state->outstandingTasks == 0)
+			pthread_cond_broadcast(&state->workAvailable);
+		pthread_mutex_unlock(&state->lock);
+	}
+
+	return NULL;
+}
+
+void ParallelTreeEnumeration(const ClusterTable& table, int numThreads, TreeEnumerationDelegate& delegate) {
+	if(numThreads < 1)
+		numThreads = 1;
+
+	SerializedEnumerationDelegate serializedDelegate(delegate);
+
+	ParallelEnumerationState state;
+	state.table = &table;
+	state.delegate = &serializedDelegate;
+	state.queuedTasks = 0;
+	state.outstandingTasks = 0;
+	state.idleWorkers = 0;
+	pthread_mutex_init(&state.lock, NULL);
+	pthread_cond_init(&state.workAvailable, NULL);
+
+	// Split the search space breadth first, until there are a few tasks
+	// for every worker or the shallow levels are exhausted
+	std::vector<EnumerationTask> tasks(1);
+	while(tasks.size() < (size_t)numThreads * 4 && tasks[0].parents.size() < table.numSymbols()) {
+		std::vector<EnumerationTask> nextLevel;
+		for(size_t i=0; i<tasks.size(); i++) {
+			std::vector<EnumerationTask> subtasks = ExpandTask(tasks[i]);
+			nextLevel.insert(nextLevel.end(), subtasks.begin(), subtasks.end());
+		}
+		tasks.swap(nextLevel);
+	}
+
+	// Deal the initial tasks to the workers
+	state.deques.resize(numThreads);
+	for(int i=0; i<numThreads; i++)
+		pthread_mutex_init(&state.deques[i].lock, NULL);
+	for(size_t i=0; i<tasks.size(); i++)
+		state.deques[i % numThreads].tasks.push_back(tasks[i]);
+	state.queuedTasks = tasks.size();
+	state.outstandingTasks = tasks.size();
+
+	std::vector<pthread_t> threads(numThreads);
+	std::vector<EnumerationWorkerArgs> args(numThreads);
+	for(int i=0; i<numThreads; i++) {
+		args[i].state = &state;
+		args[i].workerIdx = i;
+		pthread_create(&threads[i], NULL, EnumerationWorker, &args[i]);
+	}
+
+	for(int i=0; i<numThreads; i++)
+		pthread_join(threads[i], NULL);
+
+	for(int i=0; i<numThreads; i++)
+		pthread_mutex_destroy(&state.deques[i].lock);
+	pthread_cond_destroy(&state.workAvailable);
+	pthread_mutex_destroy(&state.lock);
+}
+
+/*******************************/
+/*      ASYNCHRONOUS OUTPUT    */
+/*******************************/
+
+void TreeSnapshot::assign(Subclone * root) {
+	_parents.clear();
+	_fractions.clear();
+	_treeFractions.clear();
+	_clusters.clear();
+	_clusterStart.clear();
+
+	append(root, 0);
+	_clusterStart.push_back(_clusters.size());
+}
+
+void TreeSnapshot::append(Subclone * node, size_t parent) {
+	size_t index = _parents.size();
+
+	_parents.push_back(parent);
+	_fractions.push_back(node->fraction());
+	_treeFractions.push_back(node->treeFraction());
+	_clusterStart.push_back(_clusters.size());
+	_clusters.insert(_clusters.end(), node->vecEventCluster().begin(), node->vecEventCluster().end());
+
+	for(size_t i=0; i<node->getVecChildren().size(); i++)
+		append((Subclone *)node->getVecChildren()[i], index);
+}
+
+Subclone *TreeSnapshot::materialize(std::vector<Subclone *>& nodes) const {
+	nodes.clear();
+
+	for(size_t i=0; i<_parents.size(); i++) {
+		Subclone *clone = new Subclone();
+		clone->setFraction(_fractions[i]);
+		clone->setTreeFraction(_treeFractions[i]);
+		for(size_t j=_clusterStart[i]; j<_clusterStart[i+1]; j++)
+			clone->addEventCluster(_clusters[j]);
+
+		if(i > 0)
+			nodes[_parents[i]]->addChild(clone);
+		nodes.push_back(clone);
+	}
+
+	return nodes.empty() ? NULL : nodes[0];
+}
+
+AsyncTreeDelegate::AsyncTreeDelegate(TreeEnumerationDelegate& target, size_t capacity, sqlite3 *database, size_t batchSize):
+	_target(target), _database(database), _batchSize(batchSize),
+	_queue(capacity > 0 ? capacity : 1), _head(0), _count(0), _finished(false) {
+
+	if(_batchSize == 0)
+		_batchSize = 1;
+
+	pthread_mutex_init(&_lock, NULL);
+	pthread_cond_init(&_notEmpty, NULL);
+	pthread_cond_init(&_notFull, NULL);
+	_running = pthread_create(&_writer, NULL, writerThread, this) == 0;
+}
+
+AsyncTreeDelegate::~AsyncTreeDelegate() {
+	finish();
+	pthread_cond_destroy(&_notFull);
+	pthread_cond_destroy(&_notEmpty);
+	pthread_mutex_destroy(&_lock);
+}
+
+void AsyncTreeDelegate::viableTreeFound(Subclone * root) {
+	// without a writer thread, fall back to writing synchronously
+	if(!_running) {
+		_target.viableTreeFound(root);
+		return;
+	}
+
+	pthread_mutex_lock(&_lock);
+	assert(!_finished);
+	while(_count == _queue.size())
+		pthread_cond_wait(&_notFull, &_lock);
+
+	// the writer never touches the slot past the last queued tree
+	_queue[(_head + _count) % _queue.size()].assign(root);
+	_count++;
+
+	pthread_cond_signal(&_notEmpty);
+	pthread_mutex_unlock(&_lock);
+}
+
+void AsyncTreeDelegate::finish() {
+	if(!_running)
+		return;
+
+	pthread_mutex_lock(&_lock);
+	_finished = true;
+	pthread_cond_signal(&_notEmpty);
+	pthread_mutex_unlock(&_lock);
+
+	pthread_join(_writer, NULL);
+	_running = false;
+}
+
+void *AsyncTreeDelegate::writerThread(void *arg) {
+	((AsyncTreeDelegate *)arg)->writerLoop();
+	return NULL;
+}
+
+void AsyncTreeDelegate::writerLoop() {
+	std::vector<Subclone *> nodes;
+	ArchiveSession *session = NULL;
+	size_t numInTransaction = 0;
+
+	while(true) {
+		pthread_mutex_lock(&_lock);
+		while(_count == 0 && !_finished)
+			pthread_cond_wait(&_notEmpty, &_lock);
+
+		if(_count == 0) {
+			pthread_mutex_unlock(&_lock);
+			break;
+		}
+
+		// the producer does not touch the head slot until it is released
+		const TreeSnapshot& snapshot = _queue[_head];
+		pthread_mutex_unlock(&_lock);
+
+		if(_database != NULL && numInTransaction == 0)
+			session = new ArchiveSession(_database);
+
+		Subclone *root = snapshot.materialize(nodes);
+		_target.viableTreeFound(root);
+		for(size_t i=0; i<nodes.size(); i++)
+			delete nodes[i];
+
+		if(_database != NULL && ++numInTransaction == _batchSize) {
+			session->commit();
+			delete session;
+			session = NULL;
+			numInTransaction = 0;
+		}
+
+		pthread_mutex_lock(&_lock);
+		_head = (_head + 1) % _queue.size();
+		_count--;
+		pthread_cond_signal(&_notFull);
+		pthread_mutex_unlock(&_lock);
+	}
+
+	if(session != NULL) {
+		session->commit();
+		delete session;
+	}
+}
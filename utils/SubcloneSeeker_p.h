@@ -0,0 +1,354 @@
+/**
+ * @file SubcloneSeeker_p.h
+ * The header file for the implementation part of 'ssmain', which enumerates
+ * all the subclonal structures that can be built from a list of event
+ * clusters and keeps the ones whose cell fractions are consistent. The
+ * purpose for using a separate implementation source file is to decouple
+ * the logic from the command-line interface so that automated test cases
+ * can be constructed.
+ *
+ * @author Yi Qiao
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013 Yi Qiao
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef SUBCLONESEEKER_P_H
+#define SUBCLONESEEKER_P_H
+
+#include <vector>
+#include <pthread.h>
+#include "EventCluster.h"
+#include "Subclone.h"
+
+/**
+ * The tolerance used when comparing cell fractions
+ */
+#define EPISLON (0.01)
+
+using namespace SubcloneSeeker;
+
+/**
+ * @brief Delegate class receiving the trees produced by the enumeration
+ *
+ * When the enumeration runs on multiple threads, calls to the delegate are
+ * serialized, so implementations do not need to be thread-safe. The tree
+ * passed in is only valid for the duration of the call.
+ */
+class TreeEnumerationDelegate {
+	public:
+		/**
+		 * Destructor
+		 */
+		virtual ~TreeEnumerationDelegate() {}
+
+		/**
+		 * Called for every tree whose cell fractions are consistent. The
+		 * fraction and tree fraction of all nodes have been assigned.
+		 * Unviable trees are pruned during the enumeration and never
+		 * reported.
+		 *
+		 * @param root The root of the viable tree
+		 */
+		virtual void viableTreeFound(Subclone * /* root */) = 0;
+};
+
+/**
+ * Find the end of the symbol starting at a given cluster. Clusters sharing
+ * the same cell fraction (within EPISLON) are placed into the same subclone,
+ * and together make up one symbol of the enumeration.
+ *
+ * @param vecClusters The clusters, sorted by descending cell fraction
+ * @param symIdx The index of the first cluster of the symbol
+ * @return The index of the first cluster after the symbol
+ */
+size_t nextSymbolIndex(const std::vector<EventCluster>& vecClusters, size_t symIdx);
+
+/**
+ * @brief The clusters to be placed, grouped into enumeration symbols
+ *
+ * The table is built once before the enumeration and is then only read,
+ * so that a single table can be shared by all the recursion levels and
+ * all the worker threads of a search. It does not own the clusters.
+ */
+class ClusterTable {
+	protected:
+		std::vector<EventCluster>& _vecClusters; /**< the clusters, sorted by descending cell fraction */
+		std::vector<size_t> _symbolStart; /**< index of the first cluster of each symbol, plus an end marker */
+
+	public:
+		/**
+		 * Constructor
+		 *
+		 * @param vecClusters The clusters, sorted by descending cell fraction
+		 */
+		ClusterTable(std::vector<EventCluster>& vecClusters);
+
+		/**
+		 * @return The number of symbols to be placed
+		 */
+		inline size_t numSymbols() const {return _symbolStart.size() - 1;}
+
+		/**
+		 * @param symIdx The index of the symbol
+		 * @return The cell fraction of the symbol
+		 */
+		inline double symbolFraction(size_t symIdx) const {return _vecClusters[_symbolStart[symIdx]].cellFraction();}
+
+		/**
+		 * Create a new root node, which holds no cluster and takes the
+		 * whole sample
+		 *
+		 * @return The new node, owned by the caller
+		 */
+		Subclone *createRootNode() const;
+
+		/**
+		 * Create a new, detached tree node holding the clusters of a symbol
+		 *
+		 * @param symIdx The index of the symbol
+		 * @return The new node, owned by the caller
+		 */
+		Subclone *createSymbolNode(size_t symIdx) const;
+};
+
+/**
+ * @brief Compact encoding of the partial tree explored by the enumeration
+ *
+ * Node 0 is the root and node k+1 holds the k-th symbol. Symbols are placed
+ * in order, each under one of the nodes already in the tree, and the tree is
+ * kept as a parent index per node, with the tree fraction of every node and
+ * the sum of the tree fractions of its children in parallel arrays. The
+ * Subclone graph, made of nodes allocated once, is only brought up to date
+ * when a complete tree is handed to a delegate, and a node is detached from
+ * it only when its placement is undone.
+ */
+class EnumerationTree {
+	protected:
+		const ClusterTable& _table; /**< the symbols to be placed */
+		std::vector<size_t> _parents; /**< parent of every placed node */
+		std::vector<double> _treeFraction; /**< tree fraction of every node */
+		std::vector<double> _childrenFraction; /**< sum of the children's tree fractions of every node */
+		std::vector<size_t> _numChildren; /**< number of children of every node */
+		std::vector<double> _savedChildrenFraction; /**< parent's children sum before each placement, for exact undo */
+		std::vector<Subclone *> _nodes; /**< Subclone of every node, used to emit complete trees */
+		size_t _numAttached; /**< number of placed nodes attached in the Subclone graph */
+
+		/**
+		 * Assign the fraction of a node in the Subclone graph from its tree
+		 * fraction and the tree fractions of its children
+		 *
+		 * @param node The index of the node
+		 */
+		void updateNodeFraction(size_t node);
+
+	public:
+		/**
+		 * Constructor. The tree initially holds the root only
+		 *
+		 * @param table The cluster table. It must outlive the tree
+		 */
+		EnumerationTree(const ClusterTable& table);
+
+		/**
+		 * Destructor
+		 */
+		~EnumerationTree();
+
+		/**
+		 * @return The number of symbols placed so far, which is also the
+		 * index of the next symbol to be placed
+		 */
+		inline size_t numPlaced() const {return _parents.size() - 1;}
+
+		/**
+		 * @return If all the symbols have been placed
+		 */
+		inline bool isComplete() const {return numPlaced() == _table.numSymbols();}
+
+		/**
+		 * Place the next symbol under a node, unless the node does not have
+		 * room for it
+		 *
+		 * @param parent The node to place the symbol under, at most numPlaced()
+		 * @return false if the children of the node would take more than its
+		 * tree fraction, in which case the tree is left unchanged
+		 */
+		bool place(size_t parent);
+
+		/**
+		 * Undo the last placement
+		 */
+		void unplace();
+
+		/**
+		 * Bring the Subclone graph of a complete tree up to date, with the
+		 * fraction and tree fraction of every node assigned, and hand it to
+		 * a delegate. The delegate must not change the structure of the graph.
+		 *
+		 * @param delegate The delegate receiving the tree
+		 */
+		void emit(TreeEnumerationDelegate& delegate);
+};
+
+/**
+ * Recursively construct all viable tree structures by placing the remaining
+ * symbols, and hand every complete tree to the delegate. A branch is
+ * abandoned as soon as one of its nodes is overfilled.
+ *
+ * @param tree The partial tree built so far. It is restored before returning
+ * @param delegate The delegate receiving the viable trees
+ */
+void TreeEnumeration(EnumerationTree& tree, TreeEnumerationDelegate& delegate);
+
+/**
+ * Enumerate all viable tree structures that can be built from a cluster table
+ *
+ * @param table The cluster table
+ * @param delegate The delegate receiving the viable trees
+ */
+void TreeEnumeration(const ClusterTable& table, TreeEnumerationDelegate& delegate);
+
+/**
+ * Enumerate all viable tree structures on multiple threads.
+ *
+ * The search space is split at shallow placement levels into independent
+ * subproblems. Each worker thread owns a private EnumerationTree, and
+ * idle workers steal subproblems from the others. The set of trees reported
+ * is the same as the one reported by TreeEnumeration, although not
+ * necessarily in the same order.
+ *
+ * @param table The cluster table, shared by all the workers
+ * @param numThreads The number of worker threads
+ * @param delegate The delegate receiving the viable trees
+ */
+void ParallelTreeEnumeration(const ClusterTable& table, int numThreads, TreeEnumerationDelegate& delegate);
+
+/**
+ * @brief A self-contained copy of a tree
+ *
+ * The nodes are stored in pre-order, so that every node comes after its
+ * parent and the children of a node keep their order. The clusters are
+ * referred to, not copied.
+ */
+class TreeSnapshot {
+	protected:
+		std::vector<size_t> _parents; /**< index of the parent of every node, unused for the root */
+		std::vector<double> _fractions; /**< fraction of every node */
+		std::vector<double> _treeFractions; /**< tree fraction of every node */
+		std::vector<EventCluster *> _clusters; /**< clusters of all nodes, node after node */
+		std::vector<size_t> _clusterStart; /**< index of the first cluster of every node, plus an end marker */
+
+		/**
+		 * Append a subtree to the snapshot
+		 *
+		 * @param node The root of the subtree
+		 * @param parent The index of the parent of the subtree's root
+		 */
+		void append(Subclone * node, size_t parent);
+
+	public:
+		/**
+		 * Replace the content of the snapshot by a copy of a tree. The
+		 * storage of the previous content is reused.
+		 *
+		 * @param root The root of the tree
+		 */
+		void assign(Subclone * root);
+
+		/**
+		 * Build a new Subclone graph out of the snapshot
+		 *
+		 * @param nodes Receives all the nodes of the graph, root first, which
+		 * are owned by the caller
+		 * @return The root of the graph
+		 */
+		Subclone *materialize(std::vector<Subclone *>& nodes) const;
+};
+
+/**
+ * @brief Delegate adaptor that hands the trees over to a writer thread
+ *
+ * viableTreeFound copies the tree into a bounded queue and returns right
+ * away, unless the queue is full. A dedicated writer thread takes the trees
+ * off the queue and passes them, in the same order, to the target delegate.
+ * If a database is given, the writer wraps its calls into ArchiveSessions of
+ * up to batchSize trees, so that the target can write to the database cheaply.
+ * The target is only ever called from the writer thread.
+ */
+class AsyncTreeDelegate : public TreeEnumerationDelegate {
+	protected:
+		TreeEnumerationDelegate& _target; /**< the delegate called by the writer thread */
+		sqlite3 *_database; /**< the database the target writes to, or NULL */
+		size_t _batchSize; /**< the number of trees written in one transaction */
+
+		std::vector<TreeSnapshot> _queue; /**< ring buffer of queued trees */
+		size_t _head; /**< the oldest queued tree */
+		size_t _count; /**< the number of queued trees */
+		bool _finished; /**< no more trees will be queued */
+
+		pthread_mutex_t _lock; /**< protects the queue state */
+		pthread_cond_t _notEmpty; /**< signaled when a tree is queued or the queue is finished */
+		pthread_cond_t _notFull; /**< signaled when a tree is taken off the queue */
+		pthread_t _writer; /**< the writer thread */
+		bool _running; /**< if the writer thread has not been joined yet */
+
+		/**
+		 * The body of the writer thread
+		 */
+		void writerLoop();
+
+		/**
+		 * Entry point of the writer thread
+		 *
+		 * @param arg The AsyncTreeDelegate object
+		 */
+		static void *writerThread(void *arg);
+
+	public:
+		/**
+		 * Constructor. Starts the writer thread
+		 *
+		 * @param target The delegate receiving the trees on the writer thread
+		 * @param capacity The maximum number of trees waiting in the queue
+		 * @param database The database written by the target, or NULL
+		 * @param batchSize The maximum number of trees written in one transaction
+		 */
+		AsyncTreeDelegate(TreeEnumerationDelegate& target, size_t capacity, sqlite3 *database = NULL, size_t batchSize = 1000);
+
+		/**
+		 * Destructor. Waits for the queued trees to be written
+		 */
+		virtual ~AsyncTreeDelegate();
+
+		virtual void viableTreeFound(Subclone * root);
+
+		/**
+		 * Wait for all the queued trees to be handed to the target, commit
+		 * the last transaction and stop the writer thread. No tree may be
+		 * queued afterwards.
+		 */
+		void finish();
+};
+
+#endif
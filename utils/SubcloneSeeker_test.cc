@@ -0,0 +1,272 @@
+/**
+ * @file SubcloneSeeker_test.cc
+ * Test cases for the tree enumeration logics of ssmain
+ *
+ * @author Yi Qiao
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013 Yi Qiao
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <UnitTest++/src/UnitTest++.h>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <sstream>
+#include "SubcloneSeeker_p.h"
+
+#include "EventCluster.h"
+#include "TreeNode.h"
+#include "Subclone.h"
+
+using namespace SubcloneSeeker;
+
+// Records the structure of every tree reported by the enumeration
+class TreeCollector : public TreeEnumerationDelegate {
+	protected:
+		class TreeStringTraverser : public TreeTraverseDelegate {
+			public:
+				std::ostringstream out;
+
+				virtual void preprocessNode(TreeNode *node) {
+					if(!node->isLeaf())
+						out<<"(";
+				}
+
+				virtual void processNode(TreeNode *node) {
+					out<<((Subclone *)node)->fraction()<<",";
+				}
+
+				virtual void postprocessNode(TreeNode *node) {
+					if(!node->isLeaf())
+						out<<")";
+				}
+		};
+
+		std::string treeString(Subclone *root) {
+			TreeStringTraverser traverser;
+			TreeNode::PreOrderTraverse(root, traverser);
+			return traverser.out.str();
+		}
+
+	public:
+		std::vector<std::string> viableTrees;
+
+		virtual void viableTreeFound(Subclone *root) {
+			viableTrees.push_back(treeString(root));
+		}
+
+		std::vector<std::string> sortedViableTrees() const {
+			std::vector<std::string> trees(viableTrees);
+			std::sort(trees.begin(), trees.end());
+			return trees;
+		}
+};
+
+struct _ClusterListFixture {
+	std::vector<EventCluster> vecClusters;
+
+	void addCluster(double fraction) {
+		EventCluster cluster;
+		cluster.setCellFraction(fraction);
+		vecClusters.push_back(cluster);
+	}
+
+	void serialEnumeration(TreeCollector& collector) {
+		ClusterTable table(vecClusters);
+		TreeEnumeration(table, collector);
+	}
+
+	void parallelEnumeration(TreeCollector& collector, int numThreads) {
+		ClusterTable table(vecClusters);
+		ParallelTreeEnumeration(table, numThreads, collector);
+	}
+
+	// Count the viable trees without any pruning, by checking the fraction
+	// constraints on every labeled tree, given as the parent of each symbol
+	size_t bruteForceViableTrees(std::vector<size_t>& parents) {
+		size_t numSymbols = vecClusters.size();
+		size_t symIdx = parents.size();
+
+		if(symIdx == numSymbols) {
+			std::vector<double> treeFraction(numSymbols + 1);
+			std::vector<double> childrenFraction(numSymbols + 1, 0);
+			std::vector<bool> hasChildren(numSymbols + 1, false);
+			treeFraction[0] = 1;
+			for(size_t i=0; i<numSymbols; i++) {
+				treeFraction[i+1] = vecClusters[i].cellFraction();
+				childrenFraction[parents[i]] += treeFraction[i+1];
+				hasChildren[parents[i]] = true;
+			}
+			for(size_t i=0; i<=numSymbols; i++)
+				if(hasChildren[i] && treeFraction[i] - childrenFraction[i] < -EPISLON)
+					return 0;
+			return 1;
+		}
+
+		size_t count = 0;
+		for(size_t p=0; p<=symIdx; p++) {
+			parents.push_back(p);
+			count += bruteForceViableTrees(parents);
+			parents.pop_back();
+		}
+		return count;
+	}
+};
+
+SUITE(TestTreeEnumeration) {
+	TEST_FIXTURE(_ClusterListFixture, T_TwoClusters) {
+		addCluster(0.6); addCluster(0.3);
+
+		TreeCollector collector;
+		serialEnumeration(collector);
+
+		CHECK(collector.viableTrees.size() == 2);
+	}
+
+	TEST_FIXTURE(_ClusterListFixture, T_SameFraction) {
+		// clusters sharing the same fraction end up in the same node
+		addCluster(0.5); addCluster(0.5); addCluster(0.2);
+
+		CHECK(nextSymbolIndex(vecClusters, 0) == 2);
+		CHECK(nextSymbolIndex(vecClusters, 2) == 3);
+
+		ClusterTable table(vecClusters);
+		CHECK(table.numSymbols() == 2);
+
+		Subclone *node = table.createSymbolNode(0);
+		CHECK(node->vecEventCluster().size() == 2);
+		CHECK(node->vecEventCluster()[0] == &vecClusters[0]);
+		delete node;
+
+		TreeCollector collector;
+		serialEnumeration(collector);
+
+		CHECK(collector.viableTrees.size() == 2);
+	}
+
+	TEST_FIXTURE(_ClusterListFixture, T_ParallelTwoClusters) {
+		addCluster(0.6); addCluster(0.3);
+
+		TreeCollector serial, parallel;
+		serialEnumeration(serial);
+		parallelEnumeration(parallel, 4);
+
+		CHECK(parallel.sortedViableTrees() == serial.sortedViableTrees());
+	}
+
+	TEST_FIXTURE(_ClusterListFixture, T_Overfilled) {
+		// no node can hold both 0.6 and 0.5
+		addCluster(0.6); addCluster(0.5);
+
+		TreeCollector collector;
+		serialEnumeration(collector);
+
+		CHECK(collector.viableTrees.size() == 1);
+		CHECK(collector.viableTrees[0] == "0.4,(0.1,(0.5,))");
+	}
+
+	TEST_FIXTURE(_ClusterListFixture, T_EnumerationTree) {
+		addCluster(0.6); addCluster(0.5); addCluster(0.2);
+		ClusterTable table(vecClusters);
+		EnumerationTree tree(table);
+
+		CHECK(tree.numPlaced() == 0);
+		CHECK(tree.place(0));
+		CHECK(tree.place(1));
+
+		// 0.5 already takes most of 0.6
+		CHECK(not tree.place(1));
+		CHECK(tree.numPlaced() == 2);
+
+		CHECK(tree.place(2));
+		CHECK(tree.isComplete());
+
+		TreeCollector collector;
+		tree.emit(collector);
+		CHECK(collector.viableTrees.size() == 1);
+		CHECK(collector.viableTrees[0] == "0.4,(0.1,(0.3,(0.2,)))");
+
+		tree.unplace();
+		tree.unplace();
+		CHECK(tree.numPlaced() == 1);
+
+		// the room taken by the removed symbols is given back
+		CHECK(tree.place(0) == false);
+		CHECK(tree.place(1));
+		CHECK(tree.place(0));
+		CHECK(tree.isComplete());
+	}
+
+	TEST_FIXTURE(_ClusterListFixture, T_PruningKeepsViableTrees) {
+		addCluster(0.9); addCluster(0.5); addCluster(0.4); addCluster(0.3);
+		addCluster(0.2); addCluster(0.1); addCluster(0.05);
+
+		std::vector<size_t> parents;
+		size_t expected = bruteForceViableTrees(parents);
+
+		TreeCollector collector;
+		serialEnumeration(collector);
+
+		CHECK(expected > 0);
+		CHECK(collector.viableTrees.size() == expected);
+	}
+
+	TEST_FIXTURE(_ClusterListFixture, T_ParallelSameAsSerial) {
+		addCluster(0.9); addCluster(0.7); addCluster(0.45); addCluster(0.3);
+		addCluster(0.2); addCluster(0.15); addCluster(0.05);
+
+		TreeCollector serial;
+		serialEnumeration(serial);
+
+		CHECK(serial.viableTrees.size() > 0);
+
+		for(int numThreads=1; numThreads<=4; numThreads++) {
+			TreeCollector parallel;
+			parallelEnumeration(parallel, numThreads);
+
+			CHECK(parallel.sortedViableTrees() == serial.sortedViableTrees());
+		}
+	}
+
+	TEST_FIXTURE(_ClusterListFixture, T_AsyncDelegate) {
+		addCluster(0.9); addCluster(0.5); addCluster(0.4); addCluster(0.3);
+		addCluster(0.2); addCluster(0.1);
+
+		TreeCollector direct;
+		serialEnumeration(direct);
+
+		// a tiny queue makes the enumeration wait for the writer
+		TreeCollector queued;
+		AsyncTreeDelegate writer(queued, 2);
+		ClusterTable table(vecClusters);
+		TreeEnumeration(table, writer);
+		writer.finish();
+
+		CHECK(queued.viableTrees == direct.viableTrees);
+	}
+}
+
+int main() {
+	return UnitTest::RunAllTests();
+}
@@ -0,0 +1,135 @@
+/**
+ * @file TreeNode_bench.cc
+ * Benchmark for the tree traversals. It traverses a wide tree, whose root
+ * has many leaves as children, and a deep tree, which is a single chain of
+ * nodes, with the recursive traversals of TreeNode and with a TreeTraverser,
+ * through a delegate and through a visitor, and reports the time per node.
+ * The iterative traversals are expected to be somewhat slower than the
+ * recursive ones; what they save is the depth of the call stack.
+ *
+ * Usage: traverse.bench [number of nodes = 10000] [repetitions = 1000]
+ *
+ * @author Yi Qiao
+ */
+
+/*
+The MIT License (MIT)
+
+Copyright (c) 2013 Yi Qiao
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <sys/time.h>
+
+#include "TreeNode.h"
+
+using namespace SubcloneSeeker;
+
+// Counts the calls it receives
+class CallCounter : public TreeTraverseDelegate {
+	public:
+		size_t numCalls;
+
+		CallCounter(): numCalls(0) {;}
+
+		virtual void preprocessNode(TreeNode * /* node */) {numCalls++;}
+		virtual void processNode(TreeNode * /* node */) {numCalls++;}
+		virtual void postprocessNode(TreeNode * /* node */) {numCalls++;}
+};
+
+// Counts the calls it receives, without virtual functions
+class CallCountingVisitor : public TreeVisitor<TreeNode> {
+	public:
+		size_t numCalls;
+
+		CallCountingVisitor(): numCalls(0) {;}
+
+		void preprocessNode(TreeNode * /* node */) {numCalls++;}
+		void processNode(TreeNode * /* node */) {numCalls++;}
+		void postprocessNode(TreeNode * /* node */) {numCalls++;}
+};
+
+static double now() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+// Report the time taken by one kind of traversal
+static void report(const char *kind, double elapsed, double numVisits) {
+	std::cout<<"\t"<<kind<<": "<<elapsed<<"s\tper node: "<<elapsed / numVisits * 1e9<<"ns"<<std::endl;
+}
+
+// Traverse one tree in pre-order, recursively then iteratively, through a
+// delegate then a visitor, and report the results
+static void runBenchmark(const char *name, std::vector<TreeNode>& nodes, int numRepetitions) {
+	CallCounter recursiveCounter, iterativeCounter;
+	CallCountingVisitor recursiveVisitor, iterativeVisitor;
+	TreeTraverser traverser;
+	double numVisits = double(nodes.size()) * numRepetitions;
+	std::cout<<name<<" tree, nodes: "<<nodes.size()<<"\trepetitions: "<<numRepetitions<<std::endl;
+
+	double start = now();
+	for(int i=0; i<numRepetitions; i++)
+		TreeNode::PreOrderTraverse(&nodes[0], recursiveCounter);
+	report("recursive, delegate", now() - start, numVisits);
+
+	start = now();
+	for(int i=0; i<numRepetitions; i++)
+		traverser.preOrderTraverse(&nodes[0], iterativeCounter);
+	report("iterative, delegate", now() - start, numVisits);
+
+	start = now();
+	for(int i=0; i<numRepetitions; i++)
+		TreeNode::PreOrderVisit(&nodes[0], recursiveVisitor);
+	report("recursive, visitor", now() - start, numVisits);
+
+	start = now();
+	for(int i=0; i<numRepetitions; i++)
+		traverser.preOrderVisit(&nodes[0], iterativeVisitor);
+	report("iterative, visitor", now() - start, numVisits);
+
+	if(recursiveCounter.numCalls != iterativeCounter.numCalls || recursiveVisitor.numCalls != recursiveCounter.numCalls || iterativeVisitor.numCalls != recursiveCounter.numCalls)
+		std::cout<<"\tthe traversals made different numbers of calls!"<<std::endl;
+}
+
+int main(int argc, char *argv[]) {
+	int numNodes = argc > 1 ? atoi(argv[1]) : 10000;
+	int numRepetitions = argc > 2 ? atoi(argv[2]) : 1000;
+	if(numNodes < 1 || numRepetitions < 1) {
+		std::cerr<<"Usage: "<<argv[0]<<" [number of nodes = 10000] [repetitions = 1000]"<<std::endl;
+		return 1;
+	}
+
+	// the nodes are allocated at once, so that they do not move
+	std::vector<TreeNode> wide(numNodes);
+	for(int i=1; i<numNodes; i++)
+		wide[0].addChild(&wide[i]);
+	runBenchmark("wide", wide, numRepetitions);
+
+	std::vector<TreeNode> deep(numNodes);
+	for(int i=1; i<numNodes; i++)
+		deep[i - 1].addChild(&deep[i]);
+	runBenchmark("deep", deep, numRepetitions);
+
+	return 0;
+}
@@ -1,6 +1,7 @@
 #include "Subclone.h"
 #include "EventCluster.h"
 #include "SegmentalMutation.h"
+#include "RefGenome.h"
 #include <iostream>
 #include <cstdio>
 #include <sqlite3/sqlite3.h>
@@ -36,12 +37,14 @@ int main(int argc, char* argv[]) {
 		std::cerr<<"Unable to create primary database file "<<pri_db_fn<<std::endl;
 		return(2);
 	}
+	Archivable::tuneDatabaseForWriting(pri_database);
 
 	sqlite3 *rel_database;
 	if(sqlite3_open(rel_db_fn, &rel_database) != SQLITE_OK) {
 		std::cerr<<"Unable to create relapse database file "<<rel_db_fn<<std::endl;
 		return(2);
 	}
+	Archivable::tuneDatabaseForWriting(rel_database);
 
 	float maxPriFreq, maxRelFreq;
 	float priFreq, relFreq;
@@ -51,6 +54,7 @@ int main(int argc, char* argv[]) {
 
 	int counter = 1;
 
+	SubcloneArena snpArena;
 	std::vector<CNV *> vec_primary_snps;
 	std::vector<CNV *> vec_relapse_snps;
 
@@ -65,12 +69,19 @@ int main(int argc, char* argv[]) {
 
 		CNV *priSNP, *relSNP;
 
-		priSNP = new CNV(); relSNP = new CNV();
+		priSNP = snpArena.createCNV(); relSNP = snpArena.createCNV();
+
+		// every line is put on a chromosome of its own, named after the
+		// line, so that the events of the two samples match one another
+		// and the chromosome dictionary describes the ids stored
+		char chromName[32];
+		sprintf(chromName, "cluster%d", counter);
+		int chromID = RefGenome::getInstance()->internChrom(chromName);
 		
-		priSNP->range.chrom = counter;
+		priSNP->range.chrom = chromID;
 		priSNP->frequency = priFreq;
 
-		relSNP->range.chrom = counter;
+		relSNP->range.chrom = chromID;
 		relSNP->frequency = relFreq;
 
 		vec_primary_snps.push_back(priSNP);
@@ -86,6 +97,12 @@ int main(int argc, char* argv[]) {
 		return(3);
 	}
 
+	ArchiveSession priSession(pri_database);
+	ArchiveSession relSession(rel_database);
+	if(not RefGenome::getInstance()->archiveDictionaryToDB(pri_database) || not RefGenome::getInstance()->archiveDictionaryToDB(rel_database)) {
+		std::cerr<<"Unable to write the chromosome dictionary into the databases"<<std::endl;
+		return(4);
+	}
 	for(size_t i=0; i<vec_primary_snps.size(); i++) {
 		CNV* priSNP = dynamic_cast<CNV *>(vec_primary_snps[i]);
 		CNV* relSNP = dynamic_cast<CNV *>(vec_relapse_snps[i]);
@@ -114,7 +131,12 @@ int main(int argc, char* argv[]) {
 		}
 	}
 
-	sqlite3_close(pri_database);
-	sqlite3_close(rel_database);
+	if(not priSession.commit() || not relSession.commit()) {
+		std::cerr<<"Unable to commit the clusters into the databases"<<std::endl;
+		return(4);
+	}
+
+	Archivable::closeDatabase(pri_database);
+	Archivable::closeDatabase(rel_database);
 	return(0);
 }
@@ -3,10 +3,12 @@
 #include <sqlite3/sqlite3.h>
 #include <cassert>
 #include <cstdlib>
+#include <cstdio>
 #include "SegmentalMutation.h"
 #include "EventCluster.h"
 #include "SomaticEvent.h"
 #include "Subclone.h"
+#include "RefGenome.h"
 
 using namespace std;
 using namespace SubcloneSeeker;
@@ -14,6 +16,17 @@ using namespace SubcloneSeeker;
 static vector<int> preceedingStack;
 static map< int, map<int, int> > occuranceMap;
 
+// the name of a chromosome, or its id if it has no name
+static string chromLabel(int chrom) {
+	string name = RefGenome::getInstance()->queryChromName(chrom);
+	if(not name.empty())
+		return name;
+
+	char idStr[16];
+	sprintf(idStr, "%d", chrom);
+	return idStr;
+}
+
 void countOccurrance(int chr1, int chr2) {
 	if(occuranceMap.find(chr1) == occuranceMap.end()) {
 		occuranceMap[chr1][chr2] = 1;
@@ -26,20 +39,13 @@ void countOccurrance(int chr1, int chr2) {
 	}
 }
 
-class CoexistanceTraverseDelegate : public TreeTraverseDelegate {
+class CoexistanceTraverseDelegate : public TreeVisitor<Subclone> {
 
 	public:
 
 		// before processing any child nodes, push the events in the current
 		// node onto the preceeding event stack
-		virtual void preprocessNode(TreeNode * node) {
-			Subclone *clone = dynamic_cast<Subclone *>(node);
-			if(clone == NULL) {
-				cerr<<"TreeNode is not Subclone, terminating"<<endl;
-				terminate();
-				return;
-			}
-
+		void preprocessNode(Subclone * clone) {
 			int numOfEvents = clone->vecEventCluster().size();
 
 			for(size_t i=0; i<numOfEvents; i++) {
@@ -51,14 +57,7 @@ class CoexistanceTraverseDelegate : public TreeTraverseDelegate {
 			}
 		}
 
-		virtual void processNode(TreeNode *node) {
-			Subclone *clone = dynamic_cast<Subclone *>(node);
-			if(clone == NULL) {
-				cerr<<"TreeNode is not Subclone, terminating"<<endl;
-				terminate();
-				return;
-			}
-
+		void processNode(Subclone *clone) {
 			for(size_t i=0; i<clone->vecEventCluster().size(); i++) {
 				EventCluster *ec = clone->vecEventCluster()[i];
 				assert(ec->members().size() == 1);
@@ -71,13 +70,7 @@ class CoexistanceTraverseDelegate : public TreeTraverseDelegate {
 			}
 		}
 
-		virtual void postprocessNode(TreeNode * node) {
-			Subclone *clone = dynamic_cast<Subclone *>(node);
-			if(clone == NULL) {
-				cerr<<"TreeNode is not Subclone, terminating"<<endl;
-				terminate();
-				return;
-			}
+		void postprocessNode(Subclone * clone) {
 			int numOfEvents = clone->vecEventCluster().size();
 
 			for(int i=0; i<numOfEvents; i++) {
@@ -101,19 +94,22 @@ int main(int argc, char* argv[])
 	}
 
 	CoexistanceTraverseDelegate ctd;
-	SubcloneLoadTreeTraverser loadTraverser(dbh);
+	SubcloneTreeLoader loader;
+	if(not loader.loadFromDB(dbh)) {
+		cerr<<"Unable to load subclone structures from "<<argv[1]<<endl;
+		exit(1);
+	}
 
-	DBObjectID_vec rootIDs = SubcloneLoadTreeTraverser::rootNodes(dbh);
+	const DBObjectID_vec& rootIDs = loader.rootIDs();
 
 	cout<<rootIDs.size()<<endl;
 
 	DBObjectID_vec::const_iterator it;
 	for(it = rootIDs.begin(); it != rootIDs.end(); it++) {
-		Subclone *root = new Subclone();
 		assert(preceedingStack.size() == 0);
-		root->unarchiveObjectFromDB(dbh, *it);
-		TreeNode::PreOrderTraverse(root, loadTraverser);
-		TreeNode::PreOrderTraverse(root, ctd);
+		Subclone *root = loader.buildTree(*it);
+		TreeNode::PreOrderVisit(root, ctd);
+		SubcloneTreeLoader::releaseTree(root);
 	}
 
 	map< int, map<int, int> >::const_iterator it1;
@@ -121,9 +117,9 @@ int main(int argc, char* argv[])
 
 	for(it1 = occuranceMap.begin(); it1 != occuranceMap.end(); it1++) {
 		for(it2 = occuranceMap[it1->first].begin(); it2 != occuranceMap[it1->first].end(); it2++) {
-			cout<<it1->first<<"\t"<<it2->first<<"\t"<<it2->second<<endl;
+			cout<<chromLabel(it1->first)<<"\t"<<chromLabel(it2->first)<<"\t"<<it2->second<<endl;
 		}
 	}
 
-	sqlite3_close(dbh);
+	Archivable::closeDatabase(dbh);
 }
@@ -35,17 +35,32 @@ THE SOFTWARE.
 #include <getopt.h>
 #include <cstdlib>
 #include <cstring>
+#include <string>
+#include <vector>
 
 #include "SomaticEvent.h"
 #include "SegmentalMutation.h"
 #include "EventCluster.h"
+#include "EventClusterer.h"
 #include "RefGenome.h"
+#include "GenomicRangeIndex.h"
+#include "SegFileReader.h"
 
 #define _EPISLON 1e-3
 
 #define CORR_AUTO 1
 #define CORR_PROXIMITY 2
 
+#define CLUSTER_GREEDY 1
+#define CLUSTER_SORTED 2
+#define CLUSTER_KMEANS 3
+#define CLUSTER_LINKAGE 4
+
+/**
+ * The number of seedings tried by the 'kmeans' method
+ */
+#define KMEANS_RESTARTS 10
+
 static int _ploidy;
 static double _purity;
 static double _neutral_level;
@@ -54,9 +69,16 @@ static double _threshold;
 static char *_prog_name;
 static char *_mask_fn;
 static unsigned long _min_length;
+static int _cluster_method;
+static int _num_clusters;
+static int _num_threads;
+static char *_sweep_list;
+static char *_genome_fn;
 
 using namespace SubcloneSeeker;
 
+EventClusterer *CreateClusterer(double threshold);
+int SaveClusters(std::vector<EventCluster *>& clusters, const std::string& dbName);
 void SegmentalMeanCorrection(std::vector<EventCluster *>& clusters);
 void SegmentalMean2Frequency(std::vector<EventCluster *>& clusters);
 double SegmentalMeanModal(const EventClusterPtr_vec& clusters);
@@ -83,8 +105,13 @@ void usage() {
 	std::cout<<"\t\t -n ratio\t[default = 1]\t\tA tumor/normal ratio where the copy number neutral regions are found"<<std::endl;
 	std::cout<<"\t\t -m \t\t\t\t\tFraction correction by modal value"<<std::endl;
 	std::cout<<"\t\t -r mask-file\t\t\t\tA mask file for regions to exclude"<<std::endl;
+	std::cout<<"\t\t -g genome-file\t[default = hg19]\tA .fai or .dict file describing the reference genome"<<std::endl;
 	std::cout<<"\t\t -t threshold\t[default = 0.05]\tThe ratio threshold for merging two segments into a cluster"<<std::endl;
 	std::cout<<"\t\t -e length\t[default=0]\tThe minimal cumulative length of a cluster to be included in the result"<<std::endl;
+	std::cout<<"\t\t -c method\t[default = greedy]\tThe clustering method: 'greedy', in input order, 'sorted', by frequency, 'linkage', single-linkage, or 'kmeans'"<<std::endl;
+	std::cout<<"\t\t -k clusters\t\t\t\tThe number of clusters of the 'kmeans' method"<<std::endl;
+	std::cout<<"\t\t -s thresholds\t\t\t\tA comma-separated list of thresholds, each clustering saved to <result database>.<threshold>"<<std::endl;
+	std::cout<<"\t\t -j threads\t[default = 1]\t\tThe number of threads used by the 'kmeans' method"<<std::endl;
 	exit(0);
 }
 
@@ -97,9 +124,14 @@ int main(int argc, char* argv[]) {
 	_threshold = 0.05;
 	_mask_fn=NULL;
 	_min_length = 0;
+	_cluster_method = CLUSTER_GREEDY;
+	_num_clusters = 0;
+	_num_threads = 1;
+	_sweep_list = NULL;
+	_genome_fn = NULL;
 
 	int c;
-	while((c = getopt(argc, argv, "p:q:n:mr:t:e:h")) != -1) {
+	while((c = getopt(argc, argv, "p:q:n:mr:g:t:e:c:k:j:s:h")) != -1) {
 		switch(c) {
 			case 'p':
 				_purity = atof(optarg); break;
@@ -111,10 +143,32 @@ int main(int argc, char* argv[]) {
 				_correct_model = 1; break;
 			case 'r':
 				_mask_fn = strdup(optarg); break;
+			case 'g':
+				_genome_fn = strdup(optarg); break;
 			case 't':
 				_threshold = atof(optarg); break;
 			case 'e':
 				_min_length = atoi(optarg); break;
+			case 'c':
+				if(strcmp(optarg, "greedy") == 0)
+					_cluster_method = CLUSTER_GREEDY;
+				else if(strcmp(optarg, "sorted") == 0)
+					_cluster_method = CLUSTER_SORTED;
+				else if(strcmp(optarg, "linkage") == 0)
+					_cluster_method = CLUSTER_LINKAGE;
+				else if(strcmp(optarg, "kmeans") == 0)
+					_cluster_method = CLUSTER_KMEANS;
+				else {
+					std::cerr<<"Unknown clustering method "<<optarg<<std::endl;
+					usage();
+				}
+				break;
+			case 'k':
+				_num_clusters = atoi(optarg); break;
+			case 'j':
+				_num_threads = atoi(optarg); break;
+			case 's':
+				_sweep_list = strdup(optarg); break;
 			default:
 				std::cerr<<"Unrecognized option "<<(char)c<<std::endl;
 				usage();
@@ -124,14 +178,28 @@ int main(int argc, char* argv[]) {
 
 	argc -= optind; argv += optind;
 
-	if(argc < 2) {
+	if(argc < 2 || _num_threads < 1) {
+		usage();
+	}
+
+	if(_cluster_method == CLUSTER_KMEANS && _num_clusters < 1) {
+		std::cerr<<"The 'kmeans' method needs the number of clusters"<<std::endl;
+		usage();
+	}
+
+	if(_cluster_method == CLUSTER_KMEANS && _sweep_list != NULL) {
+		std::cerr<<"The 'kmeans' method does not take a threshold"<<std::endl;
 		usage();
 	}
 
 	RefGenome *refGenome = RefGenome::getInstance();
+	if(_genome_fn != NULL && not refGenome->loadFromFile(_genome_fn)) {
+		std::cerr<<"Unable to read reference genome "<<_genome_fn<<std::endl;
+		return(1);
+	}
 
 	// open mask file if supplied
-	SomaticEventPtr_vec maskEvents;
+	GenomicRangeIndex maskRegions;
 
 	if(_mask_fn != NULL) {
 		std::ifstream in_mask_file;
@@ -146,79 +214,122 @@ int main(int argc, char* argv[]) {
 
 		in_mask_file >> chrom >> startLoc >> endLoc;
 		while(!in_mask_file.eof()) {
-			CNV *cnv = new CNV();
-			cnv->range.chrom = refGenome->queryChromID(chrom);
-			cnv->range.position = startLoc;
-			cnv->range.length = endLoc - startLoc;
+			GenomicRange region;
+			region.chrom = refGenome->internChrom(chrom);
+			region.position = startLoc;
+			region.length = endLoc - startLoc;
 
-			maskEvents.push_back(cnv);
+			maskRegions.add(region, maskRegions.size());
 			in_mask_file >> chrom >> startLoc >> endLoc;
 		}
 
 		in_mask_file.close();
+		maskRegions.build();
 	}
 
 
 	// *************************************
 	// Read content of .seg.txt file as CNVs
 	// *************************************
-	std::ifstream in_segtxt_file;
-	in_segtxt_file.open(*argv);
-	if(!in_segtxt_file.is_open()) {
-		perror("Unable to open seg.txt file");
+	SegFileReader segments;
+	if(not segments.read(*argv)) {
+		std::cerr<<"Unable to read seg.txt file "<<*argv;
+		if(segments.errorLine() > 0)
+			std::cerr<<", line "<<segments.errorLine();
+		std::cerr<<": "<<segments.error()<<std::endl;
 		return(1);
 	}
 
 	argc--; argv++;
 
-	// read event lists
+	// mask the segments
 	std::vector<SomaticEvent *> events;
-	std::string id, chrom;
-	long startLoc, endLoc, numMark;
-	double segMean;
+	for(size_t i=0; i<segments.size(); i++) {
+		CNV *cnv = &segments.segment(i);
+		if(not maskRegions.overlapsAny(cnv->range))
+			events.push_back(cnv);
+	}
 
-	in_segtxt_file >> id >> id >> id >> id >> id >> id; // Skip the header line
-	while(!in_segtxt_file.eof()) {
-		in_segtxt_file >> id >> chrom >> startLoc >> endLoc >> numMark >> segMean;
-		if(in_segtxt_file.eof())
-			break;
+	// *******************************
+	// Cluster the CNVs based on ratio
+	// *******************************
+	if(_sweep_list == NULL) {
+		EventClusterer *clusterer = CreateClusterer(_threshold);
+		std::vector<EventCluster *> clusters = clusterer->cluster(events);
+		delete clusterer;
 
-		segMean = pow(2, segMean);
-		
-		CNV *cnv = new CNV();
-		cnv->range.chrom = refGenome->queryChromID(chrom);
-		cnv->range.position = startLoc;
-		cnv->range.length = endLoc - startLoc;
-		cnv->frequency = segMean;
-
-		bool masked = false;
-		for(size_t i=0; i<maskEvents.size(); i++) {
-			CNV *otherEvent = dynamic_cast<CNV*>(maskEvents[i]);
-			if(otherEvent == NULL) continue;
-			if(otherEvent->range.overlaps(cnv->range)) {
-				masked = true;
-				break;
-			}
+		return SaveClusters(clusters, *argv);
+	}
+
+	// ***************************************
+	// Sweep the thresholds over the same CNVs
+	// ***************************************
+	std::vector<std::string> thresholdStrs;
+	for(char *tok = strtok(_sweep_list, ","); tok != NULL; tok = strtok(NULL, ","))
+		thresholdStrs.push_back(tok);
+
+	// the correction changes the frequencies and the neutral level, which
+	// are restored before each threshold
+	std::vector<double> frequencies(events.size());
+	for(size_t i=0; i<events.size(); i++)
+		frequencies[i] = events[i]->frequency;
+	double neutralLevel = _neutral_level;
+
+	EventDendrogram dendrogram;
+	if(_cluster_method == CLUSTER_LINKAGE)
+		dendrogram.build(events);
+
+	int rc = 0;
+	for(size_t t=0; t<thresholdStrs.size(); t++) {
+		double threshold = atof(thresholdStrs[t].c_str());
+		for(size_t i=0; i<events.size(); i++) {
+			events[i]->frequency = frequencies[i];
+			events[i]->setId(0);
+		}
+		_neutral_level = neutralLevel;
+
+		std::vector<EventCluster *> clusters;
+		if(_cluster_method == CLUSTER_LINKAGE) {
+			clusters = dendrogram.cut(threshold);
 		}
+		else {
+			EventClusterer *clusterer = CreateClusterer(threshold);
+			clusters = clusterer->cluster(events);
+			delete clusterer;
+		}
+
+		std::cerr<<"threshold "<<thresholdStrs[t]<<": "<<clusters.size()<<" clusters"<<std::endl;
+		if(SaveClusters(clusters, *argv + std::string(".") + thresholdStrs[t]) != 0)
+			rc = 1;
 
-		if(not masked) events.push_back(cnv);
+		for(size_t i=0; i<clusters.size(); i++)
+			delete clusters[i];
 	}
-	in_segtxt_file.close();
 
+	return(rc);
+}
+
+EventClusterer *CreateClusterer(double threshold) {
+	if(_cluster_method == CLUSTER_KMEANS)
+		return new KMeansEventClusterer(_num_clusters, KMEANS_RESTARTS, _num_threads);
+	if(_cluster_method == CLUSTER_LINKAGE)
+		return new LinkageEventClusterer(threshold);
+	if(_cluster_method == CLUSTER_SORTED)
+		return new SortedEventClusterer(threshold);
+	return new GreedyEventClusterer(threshold);
+}
+
+int SaveClusters(std::vector<EventCluster *>& clusters, const std::string& dbName) {
 	// ********************
 	// Open output database
 	// ********************
 
 	sqlite3 *database;
-	if(sqlite3_open(*argv, &database) != SQLITE_OK) {
+	if(sqlite3_open(dbName.c_str(), &database) != SQLITE_OK) {
 		std::cerr<<"Unable to open database for writing result"<<std::endl;
 		return(1);
 	}
-
-	// *******************************
-	// Cluster the CNVs based on ratio
-	// *******************************
-	std::vector<EventCluster *> clusters = EventCluster::clustering(events, _threshold);
+	Archivable::tuneDatabaseForWriting(database);
 
 	// ************************************************
 	// Correct the clusters by purity and neutral level
@@ -239,20 +350,15 @@ int main(int argc, char* argv[]) {
 	// ****************
 	// Save the results
 	// ****************
+	ArchiveSession session(database);
+	if(not RefGenome::getInstance()->archiveDictionaryToDB(database))
+		std::cerr<<"Error occurred while writing the chromosome dictionary into database"<<std::endl;
 	for(size_t i=0; i<clusters.size(); i++) {
 		// do not save neutral segments
 		if(clusters[i]->cellFraction() < _EPISLON)
 			continue;
 
-		unsigned long cumLen = 0;
-		for(size_t j=0; j<clusters[i]->members().size(); j++) {
-			SegmentalMutation *theSeg = dynamic_cast<SegmentalMutation *>(clusters[i]->members()[j]);
-			if(theSeg == NULL)
-				cumLen += 1;
-			else
-				cumLen += theSeg->range.length;
-		}
-		if(cumLen < _min_length) {
+		if(clusters[i]->totalLength() < _min_length) {
 			std::cerr<<"cluster "<<i<<" removed because too short"<<std::endl;
 			continue;
 		}
@@ -266,8 +372,14 @@ int main(int argc, char* argv[]) {
 			clusters[i]->members()[j]->archiveObjectToDB(database);
 		}
 	}
+	if(not session.commit()) {
+		std::cerr<<"Error occurred while committing the results into database"<<std::endl;
+		session.rollback();
+		Archivable::closeDatabase(database);
+		return(1);
+	}
 
-	sqlite3_close(database);
+	Archivable::closeDatabase(database);
 	return(0);
 }
 
@@ -317,13 +429,7 @@ double SegmentalMeanModal(const EventClusterPtr_vec& clusters) {
 
 
 	for(size_t i=0; i<clusters.size(); i++) {
-		unsigned long len = 0;
-		for(size_t j=0; j<clusters[i]->members().size(); j++) {
-			CNV *member = dynamic_cast<CNV *>(clusters[i]->members()[j]);
-			if(member != NULL)
-				len += member->range.length;
-		}
-
+		unsigned long len = clusters[i]->totalLength();
 		if(len > maxLen) {
 			maxLen = len;
 			maxLenIdx = i;
@@ -354,12 +460,10 @@ void SegmentalMean2Frequency(std::vector<EventCluster *>& clusters) {
 		}
 
 		if(cnDelta < -0.5 && _mask_fn==NULL) {
-			//output mask
+			//output mask, all the events are the CNVs read from the segment file
 			for(size_t j=0; j<clusters[i]->members().size(); j++) {
-				CNV * member = dynamic_cast<CNV*>(clusters[i]->members()[j]);
-				if(member != NULL) {
-					std::cerr<<member->range.chrom<<"\t"<<member->range.position<<"\t"<<member->range.position+member->range.length<<std::endl;
-				}
+				CNV * member = static_cast<CNV*>(clusters[i]->members()[j]);
+				std::cerr<<member->range.chrom<<"\t"<<member->range.position<<"\t"<<member->range.position+member->range.length<<std::endl;
 			}
 		}
 		
@@ -374,6 +478,7 @@ void SegmentalMean2Frequency(std::vector<EventCluster *>& clusters) {
 	}
 
 	for(int i=toBeRemoved.size()-1; i>=0; i--) {
+		delete clusters[toBeRemoved[i]];
 		clusters.erase(clusters.begin() + toBeRemoved[i]);
 	}
 }
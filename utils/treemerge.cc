@@ -38,6 +38,8 @@ THE SOFTWARE.
 #include <sstream>
 #include <algorithm>
 #include <assert.h>
+#include <cstdlib>
+#include <getopt.h>
 #include "Archivable.h"
 #include "SomaticEvent.h"
 #include "SegmentalMutation.h"
@@ -49,16 +51,32 @@ THE SOFTWARE.
 using namespace SubcloneSeeker;
 
 void usage(const char *prog_name) {
-	std::cout<<"Usage: "<<prog_name<<" <tree-set 1 database file> <tree-set 2 database file>"<<std::endl;
+	std::cout<<"Usage: "<<prog_name<<" [-j threads] <tree-set 1 database file> <tree-set 2 database file>"<<std::endl;
+	std::cout<<"\t\t Options:"<<std::endl;
+	std::cout<<"\t\t -j threads\t[default = 1]\t\tThe number of threads used to check the tree pairs"<<std::endl;
 	exit(0);
 }
 
 int main(int argc, char* argv[]) {
 	sqlite3 *ts1_db, *ts2_db;
-	int rc;
+	const char *prog_name = argv[0];
+	int num_threads = 1;
+
+	int c;
+	while((c = getopt(argc, argv, "j:h")) != -1) {
+		switch(c) {
+			case 'j':
+				num_threads = atoi(optarg); break;
+			default:
+				usage(prog_name);
+				break;
+		}
+	}
 
-	if(argc < 3) {
-		usage(argv[0]);
+	argc -= optind - 1; argv += optind - 1;
+
+	if(argc < 3 || num_threads < 1) {
+		usage(prog_name);
 	}
 
 	// ******** OPEN TREE-SET 1 DATABASE ********
@@ -66,7 +84,12 @@ int main(int argc, char* argv[]) {
 		std::cerr<<"Unable to open tree-set 1 database file "<<argv[1]<<std::endl;
 		return(1);
 	}
-	DBObjectID_vec ts1RootIDs = SubcloneLoadTreeTraverser::rootNodes(ts1_db);
+	SubcloneTreeLoader pLoader;
+	if(not pLoader.loadFromDB(ts1_db)) {
+		std::cerr<<"Unable to load trees from tree-set 1 database file "<<argv[1]<<std::endl;
+		return(1);
+	}
+	const DBObjectID_vec& ts1RootIDs = pLoader.rootIDs();
 	std::cerr<<ts1RootIDs.size()<<" primary trees found!"<<std::endl;
 
 	// ******** OPEN TREE-SET 2 DATABASE ********
@@ -74,27 +97,38 @@ int main(int argc, char* argv[]) {
 		std::cerr<<"Unable to open tree-set 2 database file "<<argv[2]<<std::endl;
 		return(1);
 	}
-	DBObjectID_vec ts2RootIDs = SubcloneLoadTreeTraverser::rootNodes(ts2_db);
+	SubcloneTreeLoader sLoader;
+	if(not sLoader.loadFromDB(ts2_db)) {
+		std::cerr<<"Unable to load trees from tree-set 2 database file "<<argv[2]<<std::endl;
+		return(1);
+	}
+	const DBObjectID_vec& ts2RootIDs = sLoader.rootIDs();
 	std::cerr<<ts2RootIDs.size()<<" secondary trees found!"<<std::endl;
 
-	SubcloneLoadTreeTraverser pLoadTraverser(ts1_db);
-	SubcloneLoadTreeTraverser sLoadTraverser(ts2_db);
-
-	for(size_t i=0; i<ts1RootIDs.size(); i++) {
-		for(size_t j=0; j<ts2RootIDs.size(); j++) {
-			Subclone *pRoot = new Subclone();
-			pRoot->unarchiveObjectFromDB(ts1_db, ts1RootIDs[i]);
-			TreeNode::PreOrderTraverse(pRoot, pLoadTraverser);
-
-			Subclone *sRoot = new Subclone();
-			sRoot->unarchiveObjectFromDB(ts2_db, ts2RootIDs[j]);
-			TreeNode::PreOrderTraverse(sRoot, sLoadTraverser);
-		
-			if(TreeMerge(pRoot, sRoot)) {
-				std::cout<<"Primary tree "<<pRoot->getId()<<" is compatible with Secondary tree "<<sRoot->getId()<<std::endl;
+	// Build every tree once. The merge changes the primary tree, and the
+	// changes are undone after each pair. All the trees live in one arena
+	SubcloneArena treeArena;
+	SubclonePtr_vec ts1Roots, ts2Roots;
+	for(size_t i=0; i<ts1RootIDs.size(); i++)
+		ts1Roots.push_back(pLoader.buildTree(ts1RootIDs[i], treeArena));
+	for(size_t j=0; j<ts2RootIDs.size(); j++)
+		ts2Roots.push_back(sLoader.buildTree(ts2RootIDs[j], treeArena));
+
+	// The pairs are checked in any order, but reported in the order of the
+	// primary trees, then of the secondary trees
+	std::vector<std::vector<bool> > compatible;
+	PairwiseTreeMerge(ts1Roots, ts2Roots, num_threads, compatible);
+
+	for(size_t i=0; i<ts1Roots.size(); i++) {
+		for(size_t j=0; j<ts2Roots.size(); j++) {
+			if(compatible[i][j]) {
+				std::cout<<"Primary tree "<<ts1Roots[i]->getId()<<" is compatible with Secondary tree "<<ts2Roots[j]->getId()<<std::endl;
 			}
 		}
 	}
 
+	Archivable::closeDatabase(ts1_db);
+	Archivable::closeDatabase(ts2_db);
+
 	return 0;
 }
@@ -33,11 +33,15 @@ THE SOFTWARE.
 #include <cmath>
 #include <algorithm>
 #include <iostream>
+#include <cstring>
+#include <typeinfo>
+#include <pthread.h>
 
 #include "SomaticEvent.h"
 #include "SegmentalMutation.h"
 #include "EventCluster.h"
 #include "Subclone.h"
+#include "GenomicRangeIndex.h"
 
 /**
  * The minimal fraction a subclone has to have to be considered in the merging process
@@ -54,16 +58,431 @@ THE SOFTWARE.
 	std::cout<<std::endl;
 
 
-static SubclonePtr_vec extrudeNodeList;
-static int extSubId = 500;
+/**
+ * @return The number of bits set in a word
+ */
+static inline size_t CountBits(unsigned long word) {
+#ifdef __GNUC__
+	return __builtin_popcountl(word);
+#else
+	size_t numBits = 0;
+	for(; word != 0; word &= word - 1)
+		numBits++;
+	return numBits;
+#endif
+}
+
+// EventClassSet
+void EventClassSet::reset(size_t numClasses) {
+	size_t bitsPerWord = 8 * sizeof(unsigned long);
+	_numWords = (numClasses + bitsPerWord - 1) / bitsPerWord;
+	if(_numWords > EVENT_CLASS_SET_INLINE_WORDS)
+		_heapWords.assign(_numWords, 0);
+	else
+		std::fill(_inlineWords, _inlineWords + _numWords, 0UL);
+}
+
+void EventClassSet::subtract(const EventClassSet& other) {
+	unsigned long *thisWords = words();
+	const unsigned long *otherWords = other.words();
+	for(size_t i=0; i<_numWords; i++)
+		thisWords[i] &= ~otherWords[i];
+}
+
+void EventClassSet::intersect(const EventClassSet& other) {
+	unsigned long *thisWords = words();
+	const unsigned long *otherWords = other.words();
+	for(size_t i=0; i<_numWords; i++)
+		thisWords[i] &= otherWords[i];
+}
+
+void EventClassSet::unite(const EventClassSet& other) {
+	unsigned long *thisWords = words();
+	const unsigned long *otherWords = other.words();
+	for(size_t i=0; i<_numWords; i++)
+		thisWords[i] |= otherWords[i];
+}
+
+size_t EventClassSet::count() const {
+	const unsigned long *thisWords = words();
+	size_t numClasses = 0;
+	for(size_t i=0; i<_numWords; i++)
+		numClasses += CountBits(thisWords[i]);
+	return numClasses;
+}
+
+size_t EventClassSet::countCommon(const EventClassSet& other) const {
+	const unsigned long *thisWords = words();
+	const unsigned long *otherWords = other.words();
+	size_t numClasses = 0;
+	for(size_t i=0; i<_numWords; i++)
+		numClasses += CountBits(thisWords[i] & otherWords[i]);
+	return numClasses;
+}
+
+bool EventClassSet::isEmpty() const {
+	const unsigned long *thisWords = words();
+	for(size_t i=0; i<_numWords; i++) {
+		if(thisWords[i] != 0)
+			return false;
+	}
+	return true;
+}
+
+bool EventClassSet::isSubsetOf(const EventClassSet& other) const {
+	const unsigned long *thisWords = words();
+	const unsigned long *otherWords = other.words();
+	for(size_t i=0; i<_numWords; i++) {
+		if(thisWords[i] & ~otherWords[i])
+			return false;
+	}
+	return true;
+}
+
+// EventClassIndex
+
+/**
+ * Order events so that the segmental ones come first, sorted by chromosome,
+ * position, length and type, and the others follow in no particular order
+ */
+static bool EventValueLess(SomaticEvent *a, SomaticEvent *b) {
+	SegmentalMutation *segA = dynamic_cast<SegmentalMutation *>(a);
+	SegmentalMutation *segB = dynamic_cast<SegmentalMutation *>(b);
+	if(segA == NULL || segB == NULL) {
+		if(segA != NULL || segB != NULL)
+			return segA != NULL;
+		return a < b;
+	}
+
+	if(segA->range.chrom != segB->range.chrom)
+		return segA->range.chrom < segB->range.chrom;
+	if(segA->range.position != segB->range.position)
+		return segA->range.position < segB->range.position;
+	if(segA->range.length != segB->range.length)
+		return segA->range.length < segB->range.length;
+	return strcmp(typeid(*a).name(), typeid(*b).name()) < 0;
+}
+
+/**
+ * @return If two events are interchangeable: segmental events of the same type over the same range
+ */
+static bool EventValueEqual(SomaticEvent *a, SomaticEvent *b) {
+	SegmentalMutation *segA = dynamic_cast<SegmentalMutation *>(a);
+	SegmentalMutation *segB = dynamic_cast<SegmentalMutation *>(b);
+	if(segA == NULL || segB == NULL)
+		return a == b;
+	return segA->range == segB->range && typeid(*a) == typeid(*b);
+}
+
+/**
+ * @return The first slot to look an event or a node up at, in a hash table of mask+1 slots
+ */
+static inline size_t PointerSlot(const void *pointer, size_t mask) {
+	return ((reinterpret_cast<size_t>(pointer) >> 4) * 2654435761UL) & mask;
+}
+
+/**
+ * Find the representative of a class in a union-find forest
+ */
+static size_t FindClassRoot(std::vector<size_t>& parents, size_t x) {
+	while(parents[x] != x) {
+		parents[x] = parents[parents[x]];
+		x = parents[x];
+	}
+	return x;
+}
+
+void EventClassIndex::build(const SomaticEventPtr_vec& events) {
+	_slotEvents.clear();
+	_slotClasses.clear();
+	_numClasses = 0;
+	_isExact = true;
+
+	// Interchangeable events are given the same value
+	SomaticEventPtr_vec sorted(events);
+	std::sort(sorted.begin(), sorted.end(), EventValueLess);
+	SomaticEventPtr_vec values;
+	std::vector<size_t> valueOf(sorted.size());
+	for(size_t i=0; i<sorted.size(); i++) {
+		if(i == 0 || not EventValueEqual(sorted[i-1], sorted[i]))
+			values.push_back(sorted[i]);
+		valueOf[i] = values.size() - 1;
+	}
+
+	// Join the values that are equal either way. Equal segments are looked
+	// up by range, and every value counts the values it is equal to
+	GenomicRangeIndex rangeIndex;
+	for(size_t a=0; a<values.size(); a++) {
+		SegmentalMutation *segA = dynamic_cast<SegmentalMutation *>(values[a]);
+		if(segA != NULL)
+			rangeIndex.add(segA->range, a);
+	}
+	rangeIndex.build();
+
+	std::vector<size_t> parents(values.size());
+	std::vector<size_t> numEqual(values.size(), 0);
+	std::vector<size_t> candidates;
+	for(size_t a=0; a<values.size(); a++)
+		parents[a] = a;
+	for(size_t a=0; a<values.size(); a++) {
+		SegmentalMutation *segA = dynamic_cast<SegmentalMutation *>(values[a]);
+		if(segA == NULL) {
+			candidates.assign(1, a);
+		}
+		else
+			rangeIndex.equalWithin(segA->range, BOUNDRY_RESOLUTION, candidates);
+
+		for(size_t i=0; i<candidates.size(); i++) {
+			size_t b = candidates[i];
+			bool isEqual = values[a]->isEqualTo(values[b], BOUNDRY_RESOLUTION);
+			if(isEqual)
+				numEqual[a]++;
+			if(isEqual || values[b]->isEqualTo(values[a], BOUNDRY_RESOLUTION))
+				parents[FindClassRoot(parents, a)] = FindClassRoot(parents, b);
+		}
+	}
+
+	// Number the classes. They are exact if every value is equal to all the
+	// values of its class, itself included
+	std::vector<long> classOfRoot(values.size(), -1);
+	std::vector<size_t> valueClass(values.size());
+	std::vector<size_t> classSize;
+	for(size_t a=0; a<values.size(); a++) {
+		size_t root = FindClassRoot(parents, a);
+		if(classOfRoot[root] < 0) {
+			classOfRoot[root] = classSize.size();
+			classSize.push_back(0);
+		}
+		valueClass[a] = classOfRoot[root];
+		classSize[valueClass[a]]++;
+	}
+	_numClasses = classSize.size();
+
+	for(size_t a=0; a<values.size(); a++) {
+		if(numEqual[a] != classSize[valueClass[a]])
+			_isExact = false;
+	}
+
+	// Hash the events, with at least half of the slots left empty
+	size_t numSlots = 16;
+	while(numSlots < 2 * sorted.size())
+		numSlots *= 2;
+	_slotEvents.assign(numSlots, NULL);
+	_slotClasses.assign(numSlots, 0);
+	for(size_t i=0; i<sorted.size(); i++) {
+		size_t slot = PointerSlot(sorted[i], numSlots - 1);
+		while(_slotEvents[slot] != NULL && _slotEvents[slot] != sorted[i])
+			slot = (slot + 1) & (numSlots - 1);
+		_slotEvents[slot] = sorted[i];
+		_slotClasses[slot] = valueClass[valueOf[i]];
+	}
+}
+
+long EventClassIndex::classOf(SomaticEvent *event) const {
+	if(_slotEvents.empty())
+		return -1;
+
+	size_t mask = _slotEvents.size() - 1;
+	for(size_t slot = PointerSlot(event, mask); _slotEvents[slot] != NULL; slot = (slot + 1) & mask) {
+		if(_slotEvents[slot] == event)
+			return _slotClasses[slot];
+	}
+	return -1;
+}
+
+bool EventClassIndex::classesOf(const SomaticEventPtr_vec& events, std::vector<size_t>& classes) const {
+	if(not _isExact)
+		return false;
+
+	classes.resize(events.size());
+	for(size_t i=0; i<events.size(); i++) {
+		long classId = classOf(events[i]);
+		if(classId < 0)
+			return false;
+		classes[i] = classId;
+	}
+	return true;
+}
+
+// NodeClassTable
+bool NodeClassTable::update(Subclone *node, const EventClassIndex& index) {
+	SomaticEventPtr_vec events;
+	for(size_t i=0; i<node->vecEventCluster().size(); i++) {
+		const SomaticEventPtr_vec& members = node->vecEventCluster()[i]->members();
+		events.insert(events.end(), members.begin(), members.end());
+	}
+
+	NodeEventClasses nodeClasses;
+	if(not index.classesOf(events, nodeClasses.eventClasses))
+		return false;
+	nodeClasses.classes.reset(index.numClasses());
+	for(size_t i=0; i<nodeClasses.eventClasses.size(); i++)
+		nodeClasses.classes.insert(nodeClasses.eventClasses[i]);
+
+	// Grow the table, with at least half of the slots left empty
+	if(2 * (_entries.size() + 1) > _slotNodes.size()) {
+		size_t numSlots = _slotNodes.empty() ? 16 : 2 * _slotNodes.size();
+		std::vector<Subclone *> oldNodes(numSlots, NULL);
+		std::vector<size_t> oldEntries(numSlots, 0);
+		oldNodes.swap(_slotNodes);
+		oldEntries.swap(_slotEntries);
+		for(size_t i=0; i<oldNodes.size(); i++) {
+			if(oldNodes[i] == NULL)
+				continue;
+			size_t slot = PointerSlot(oldNodes[i], numSlots - 1);
+			while(_slotNodes[slot] != NULL)
+				slot = (slot + 1) & (numSlots - 1);
+			_slotNodes[slot] = oldNodes[i];
+			_slotEntries[slot] = oldEntries[i];
+		}
+	}
+
+	size_t mask = _slotNodes.size() - 1;
+	size_t slot = PointerSlot(node, mask);
+	while(_slotNodes[slot] != NULL && _slotNodes[slot] != node)
+		slot = (slot + 1) & mask;
+
+	if(_slotNodes[slot] == node) {
+		_entries[_slotEntries[slot]] = nodeClasses;
+	}
+	else {
+		_slotNodes[slot] = node;
+		_slotEntries[slot] = _entries.size();
+		_entries.push_back(nodeClasses);
+	}
+	return true;
+}
+
+const NodeEventClasses *NodeClassTable::find(Subclone *node) const {
+	if(_entries.empty())
+		return NULL;
+
+	size_t mask = _slotNodes.size() - 1;
+	for(size_t slot = PointerSlot(node, mask); _slotNodes[slot] != NULL; slot = (slot + 1) & mask) {
+		if(_slotNodes[slot] == node)
+			return &_entries[_slotEntries[slot]];
+	}
+	return NULL;
+}
+
+void NodeClassTable::clear() {
+	if(_entries.empty())
+		return;
+	std::fill(_slotNodes.begin(), _slotNodes.end(), (Subclone *)NULL);
+	_entries.clear();
+}
+
+// TreeMergeUndoLog
+void TreeMergeUndoLog::record(ChangeType type, Subclone *node, Subclone *child, EventCluster *cluster, size_t position) {
+	Change change;
+	change.type = type;
+	change.node = node;
+	change.child = child;
+	change.cluster = cluster;
+	change.position = position;
+	_changes.push_back(change);
+}
+
+TreeMergeUndoLog::~TreeMergeUndoLog() {
+	rollback();
+}
+
+void TreeMergeUndoLog::nodeCreated(Subclone *node) {
+	record(CHANGE_NODE_CREATED, node, NULL, NULL, 0);
+}
+
+void TreeMergeUndoLog::addChild(Subclone *node, Subclone *child) {
+	node->addChild(child);
+	record(CHANGE_CHILD_ADDED, node, child, NULL, 0);
+}
+
+void TreeMergeUndoLog::removeChild(Subclone *node, Subclone *child) {
+	TreeNodeVec_t& children = node->getVecChildren();
+	size_t position = std::find(children.begin(), children.end(), child) - children.begin();
+	if(position == children.size())
+		return;
+
+	node->removeChild(child);
+	record(CHANGE_CHILD_REMOVED, node, child, NULL, position);
+}
+
+void TreeMergeUndoLog::removeCluster(Subclone *node, size_t position) {
+	EventCluster *cluster = node->vecEventCluster()[position];
+	node->vecEventCluster().erase(node->vecEventCluster().begin() + position);
+	record(CHANGE_CLUSTER_REMOVED, node, NULL, cluster, position);
+}
+
+void TreeMergeUndoLog::rollback() {
+	while(not _changes.empty()) {
+		Change& change = _changes.back();
+		switch(change.type) {
+			case CHANGE_NODE_CREATED:
+				for(size_t i=0; i<change.node->vecEventCluster().size(); i++)
+					delete change.node->vecEventCluster()[i];
+				delete change.node;
+				break;
+			case CHANGE_CHILD_ADDED:
+				change.node->removeChild(change.child);
+				break;
+			case CHANGE_CHILD_REMOVED:
+				{
+					// put the child back where it was
+					change.node->addChild(change.child);
+					TreeNodeVec_t& children = change.node->getVecChildren();
+					std::rotate(children.begin() + change.position, children.end() - 1, children.end());
+				}
+				break;
+			case CHANGE_CLUSTER_REMOVED:
+				change.node->vecEventCluster().insert(change.node->vecEventCluster().begin() + change.position, change.cluster);
+				break;
+		}
+		_changes.pop_back();
+	}
+}
+
+void TreeMergeUndoLog::commit() {
+	_changes.clear();
+}
+
+// TreeMergeContext
+TreeMergeContext::TreeMergeContext(const EventClassIndex *eventClasses, const NodeClassTable *nodeClasses): _nextNodeId(TREEMERGE_FIRST_NODE_ID), _eventClasses(eventClasses), _nodeClasses(nodeClasses) {
+}
+
+const NodeEventClasses *TreeMergeContext::nodeClassesOf(Subclone *node) {
+	if(not comparesClasses())
+		return NULL;
+
+	// the nodes changed since the last rollback hide the ones of the trees
+	const NodeEventClasses *nodeClasses = _changedNodeClasses.find(node);
+	if(nodeClasses == NULL)
+		nodeClasses = _nodeClasses->find(node);
+	if(nodeClasses == NULL && _changedNodeClasses.update(node, *_eventClasses))
+		nodeClasses = _changedNodeClasses.find(node);
+	return nodeClasses;
+}
+
+void TreeMergeContext::nodeChanged(Subclone *node) {
+	if(comparesClasses())
+		_changedNodeClasses.update(node, *_eventClasses);
+}
+
+void TreeMergeContext::rollback() {
+	_undoLog.rollback();
+	_changedNodeClasses.clear();
+	_nextNodeId = TREEMERGE_FIRST_NODE_ID;
+}
+
+void TreeMergeContext::commit() {
+	_undoLog.commit();
+}
 
 SomaticEventPtr_vec nodeEventsList(Subclone * node) {
 	SomaticEventPtr_vec subcloneEvents;
 	Subclone *wp = dynamic_cast<Subclone *>(node);
 	while(wp != NULL) {
 		for(size_t i=0; i<wp->vecEventCluster().size(); i++) {
-			for(size_t j=0; j<wp->vecEventCluster()[i]->members().size(); j++)
-				subcloneEvents.push_back(wp->vecEventCluster()[i]->members()[j]);
+			const SomaticEventPtr_vec& members = wp->vecEventCluster()[i]->members();
+			subcloneEvents.insert(subcloneEvents.end(), members.begin(), members.end());
 		}
 		wp = dynamic_cast<Subclone *>(wp->getParent());
 	}
@@ -72,6 +491,7 @@ SomaticEventPtr_vec nodeEventsList(Subclone * node) {
 
 SomaticEventPtr_vec SomaticEventDifference(const SomaticEventPtr_vec& master, const SomaticEventPtr_vec& unwanted) {
 	SomaticEventPtr_vec differenceSet;
+
 	for(size_t i=0; i<master.size(); i++) {
 		// if member i is not found in unwanted, append it to result set
 		bool found = false;
@@ -122,22 +542,311 @@ bool resultSetComparator(const SomaticEventPtr_vec& v1, const SomaticEventPtr_ve
 	return v1.size() < v2.size();
 }
 
-// Check if a node with certain events can be placed on a subtree
-SomaticEventPtr_vec checkPlacement(Subclone *pnode, SomaticEventPtr_vec somaticEvents, bool * placeableOnSubtree, int * cp) {
-	SomaticEventPtr_vec pnodeEvents;
-	bool didPassContainment = true;
+/**
+ * @brief Event sets as vectors of events, compared pairwise
+ *
+ * This is how event sets are compared when their classes are not an exact
+ * equivalence. PlaceOnSubtree is written against the interface of this class,
+ * and of ClassEventSets.
+ */
+class PairwiseEventSets {
+	public:
+		typedef SomaticEventPtr_vec Set; /**< a set of events */
 
-	// All the events in pnode
-	for(size_t i=0; i<pnode->vecEventCluster().size(); i++) {
-		for(size_t j=0; j<pnode->vecEventCluster()[i]->members().size(); j++) {
-			pnodeEvents.push_back(pnode->vecEventCluster()[i]->members()[j]);
+		/**
+		 * @return The events of the own clusters of a node
+		 */
+		inline void nodeEvents(Subclone *node, Set& events) {
+			events.clear();
+			for(size_t i=0; i<node->vecEventCluster().size(); i++) {
+				const SomaticEventPtr_vec& members = node->vecEventCluster()[i]->members();
+				events.insert(events.end(), members.begin(), members.end());
+			}
+		}
+
+		/**
+		 * @return The events of a node and of all its ancestors
+		 */
+		inline void pathEvents(Subclone *node, Set& events) {events = nodeEventsList(node);}
+
+		/**
+		 * @return The events in master that are not in unwanted
+		 */
+		inline void difference(const Set& master, const Set& unwanted, Set& result) {result = SomaticEventDifference(master, unwanted);}
+
+		/**
+		 * @return The events in master that are also in wanted
+		 */
+		inline void intersection(const Set& master, const Set& wanted, Set& result) {result = SomaticEventDifference(master, SomaticEventDifference(master, wanted));}
+
+		/**
+		 * @return If the container holds all the events of the containee
+		 */
+		inline bool contains(const Set& container, const Set& containee) {return eventSetContains(container, containee);}
+
+		/**
+		 * @return The number of events in a set
+		 */
+		inline size_t size(const Set& events) const {return events.size();}
+
+		/**
+		 * @return If a set has no event
+		 */
+		inline bool isEmpty(const Set& events) const {return events.empty();}
+
+		/**
+		 * @return If the first set has fewer events than the second one
+		 */
+		static inline bool sizeLess(const Set& v1, const Set& v2) {return resultSetComparator(v1, v2);}
+
+		/**
+		 * @param buffer Unused
+		 * @return The events of a set
+		 */
+		inline const SomaticEventPtr_vec& events(const Set& events, SomaticEventPtr_vec& buffer) {return events;}
+
+		/**
+		 * Nothing is kept about the nodes
+		 */
+		inline void nodeChanged(Subclone *node) {}
+};
+
+/**
+ * @brief Event sets as bitsets of the classes of their events
+ *
+ * The sets are made from the events of the secondary node being placed, or
+ * from the events of the nodes of the primary tree, whose classes the context
+ * computes once per node. Differences, intersections and containment are then
+ * word by word operations on the bitsets.
+ *
+ * A set counts its events rather than its classes, so that the placement
+ * takes the same decisions as with vectors of events when several events of
+ * the node being placed share a class. The sets made from the path of a node
+ * of the primary tree are only ever tested for emptiness, and count classes.
+ */
+class ClassEventSets {
+	public:
+		/**
+		 * @brief A set of events
+		 */
+		struct Set {
+			EventClassSet classes; /**< the classes of the events */
+			size_t size; /**< the number of events */
+			Subclone *path; /**< the primary node from whose path the events were taken, or NULL for the events being placed */
+
+			Set(): size(0), path(NULL) {}
+		};
+
+	protected:
+		TreeMergeContext& _context; /**< gives the classes of the nodes */
+		const SomaticEventPtr_vec& _events; /**< the events of the node being placed */
+		std::vector<size_t> _eventClasses; /**< the class of every one of them */
+		std::vector<EventClassSet> _repeats; /**< _repeats[k] holds the classes shared by more than k+1 of them */
+		Set _all; /**< the set of all of them */
+
+		/**
+		 * @return The number of events being placed whose classes are in the set
+		 */
+		size_t countEvents(const EventClassSet& classes) const {
+			size_t numEvents = classes.count();
+			for(size_t k=0; k<_repeats.size(); k++)
+				numEvents += classes.countCommon(_repeats[k]);
+			return numEvents;
+		}
+
+	public:
+		/**
+		 * Append the class of every event of a node and of all its
+		 * ancestors, in the order of nodeEventsList
+		 *
+		 * @return false if the context does not know the classes of a node
+		 */
+		static bool pathClasses(Subclone *node, TreeMergeContext& context, std::vector<size_t>& classes) {
+			for(; node != NULL; node = dynamic_cast<Subclone *>(node->getParent())) {
+				const NodeEventClasses *nodeClasses = context.nodeClassesOf(node);
+				if(nodeClasses == NULL)
+					return false;
+				classes.insert(classes.end(), nodeClasses->eventClasses.begin(), nodeClasses->eventClasses.end());
+			}
+			return true;
+		}
+
+		/**
+		 * Constructor
+		 *
+		 * @param context The context of the check, which compares classes
+		 * @param events The events of the node being placed
+		 * @param eventClasses The class of every event
+		 */
+		ClassEventSets(TreeMergeContext& context, const SomaticEventPtr_vec& events, const std::vector<size_t>& eventClasses): _context(context), _events(events), _eventClasses(eventClasses) {
+			_all.classes.reset(context.eventClasses()->numClasses());
+			_all.size = events.size();
+			for(size_t i=0; i<eventClasses.size(); i++) {
+				size_t classId = eventClasses[i];
+				if(not _all.classes.contains(classId)) {
+					_all.classes.insert(classId);
+					continue;
+				}
+
+				size_t k = 0;
+				while(k < _repeats.size() && _repeats[k].contains(classId))
+					k++;
+				if(k == _repeats.size()) {
+					_repeats.push_back(EventClassSet());
+					_repeats.back().reset(context.eventClasses()->numClasses());
+				}
+				_repeats[k].insert(classId);
+			}
 		}
+
+		/**
+		 * @return The set of all the events being placed
+		 */
+		inline const Set& all() const {return _all;}
+
+		/**
+		 * @return The events of the own clusters of a node
+		 */
+		inline void nodeEvents(Subclone *node, Set& events) {
+			const NodeEventClasses *nodeClasses = _context.nodeClassesOf(node);
+			assert(nodeClasses != NULL);
+			events.classes = nodeClasses->classes;
+			events.size = nodeClasses->eventClasses.size();
+			events.path = node;
+		}
+
+		/**
+		 * @return The events of a node and of all its ancestors
+		 */
+		inline void pathEvents(Subclone *node, Set& events) {
+			nodeEvents(node, events);
+			for(Subclone *wp = dynamic_cast<Subclone *>(node->getParent()); wp != NULL; wp = dynamic_cast<Subclone *>(wp->getParent())) {
+				const NodeEventClasses *nodeClasses = _context.nodeClassesOf(wp);
+				assert(nodeClasses != NULL);
+				events.classes.unite(nodeClasses->classes);
+			}
+			events.size = events.classes.count();
+		}
+
+		/**
+		 * @return The events in master that are not in unwanted
+		 */
+		inline void difference(const Set& master, const Set& unwanted, Set& result) {
+			result.classes = master.classes;
+			result.classes.subtract(unwanted.classes);
+			result.path = master.path;
+			result.size = master.path == NULL ? countEvents(result.classes) : result.classes.count();
+		}
+
+		/**
+		 * @return The events in master that are also in wanted
+		 */
+		inline void intersection(const Set& master, const Set& wanted, Set& result) {
+			result.classes = master.classes;
+			result.classes.intersect(wanted.classes);
+			result.path = master.path;
+			result.size = master.path == NULL ? countEvents(result.classes) : result.classes.count();
+		}
+
+		/**
+		 * @return If the container holds all the events of the containee
+		 */
+		inline bool contains(const Set& container, const Set& containee) {
+			// as with vectors, a smaller set contains nothing larger
+			return container.size >= containee.size && containee.classes.isSubsetOf(container.classes);
+		}
+
+		/**
+		 * @return The number of events in a set
+		 */
+		inline size_t size(const Set& events) const {return events.size;}
+
+		/**
+		 * @return If a set has no event
+		 */
+		inline bool isEmpty(const Set& events) const {return events.classes.isEmpty();}
+
+		/**
+		 * @return If the first set has fewer events than the second one
+		 */
+		static inline bool sizeLess(const Set& v1, const Set& v2) {return v1.size < v2.size;}
+
+		/**
+		 * Make the list of the events of a set, in the order they have on the
+		 * node being placed, or on the path they were taken from
+		 *
+		 * @param buffer Receives the events
+		 * @return buffer
+		 */
+		const SomaticEventPtr_vec& events(const Set& events, SomaticEventPtr_vec& buffer) {
+			buffer.clear();
+			if(events.path == NULL) {
+				for(size_t i=0; i<_events.size(); i++) {
+					if(events.classes.contains(_eventClasses[i]))
+						buffer.push_back(_events[i]);
+				}
+				return buffer;
+			}
+
+			SomaticEventPtr_vec pathEvents = nodeEventsList(events.path);
+			std::vector<size_t> classes;
+			pathClasses(events.path, _context, classes);
+			for(size_t i=0; i<pathEvents.size(); i++) {
+				if(events.classes.contains(classes[i]))
+					buffer.push_back(pathEvents[i]);
+			}
+			return buffer;
+		}
+
+		/**
+		 * Compute the classes of a node again, after it was created or its
+		 * clusters changed
+		 */
+		inline void nodeChanged(Subclone *node) {_context.nodeChanged(node);}
+};
+
+/**
+ * Graft a node created by checkPlacement onto the primary tree, or free it if
+ * it is not to be grafted
+ *
+ * @param parent The node to graft the new node on
+ * @param node The new node, with its clusters
+ * @param graft Whether the node is grafted
+ * @param context The context of the check, recording the changes to the tree
+ * @param sets The event sets, told about the new node
+ */
+template<class EventSets>
+static void GraftNewNode(Subclone *parent, Subclone *node, bool graft, TreeMergeContext& context, EventSets& sets) {
+	if(not graft) {
+		for(size_t i=0; i<node->vecEventCluster().size(); i++)
+			delete node->vecEventCluster()[i];
+		delete node;
+		return;
 	}
 
+	context.undoLog().nodeCreated(node);
+	context.undoLog().addChild(parent, node);
+	sets.nodeChanged(node);
+}
+
+// Check if a node with certain events can be placed on a subtree. All the
+// changes to the subtree go through the context, and the event sets are
+// compared through sets
+template<class EventSets>
+static typename EventSets::Set PlaceOnSubtree(Subclone *pnode, const typename EventSets::Set& somaticEvents, bool * placeableOnSubtree, int * cp, TreeMergeContext& context, EventSets& sets) {
+	typedef typename EventSets::Set Set;
+	Set pnodeEvents;
+	bool didPassContainment = true;
+
+	// All the events in pnode
+	sets.nodeEvents(pnode, pnodeEvents);
+
 	// if pnode is not completely contained by somaticEvent, it cannot be placed under pnode
-	didPassContainment = eventSetContains(somaticEvents, pnodeEvents);
+	didPassContainment = sets.contains(somaticEvents, pnodeEvents);
 	
-	SomaticEventPtr_vec eventDiff = SomaticEventDifference(somaticEvents, pnodeEvents);
+	Set eventDiff;
+	sets.difference(somaticEvents, pnodeEvents, eventDiff);
+	SomaticEventPtr_vec eventBuffer;
 
 	if(pnode->isLeaf()) {
 		if(cp != NULL)
@@ -149,15 +858,15 @@ SomaticEventPtr_vec checkPlacement(Subclone *pnode, SomaticEventPtr_vec somaticE
 			
 			// Merging the secondary node onto the primary tree
 			Subclone * relExtNode = new Subclone();
-			relExtNode->setId(extSubId++);
+			relExtNode->setId(context.nextNodeId());
 			EventCluster * relExtCluster = new EventCluster();
-			for(size_t i=0; i<eventDiff.size(); i++) {
-				relExtCluster->addEvent(eventDiff[i]);
+			const SomaticEventPtr_vec& diffEvents = sets.events(eventDiff, eventBuffer);
+			for(size_t i=0; i<diffEvents.size(); i++) {
+				relExtCluster->addEvent(diffEvents[i]);
 			}
 			relExtNode->addEventCluster(relExtCluster);
 			relExtNode->setFraction(0.1);
-			if(eventDiff.size() > 0)
-				pnode->addChild(relExtNode);
+			GraftNewNode(pnode, relExtNode, not sets.isEmpty(eventDiff), context, sets);
 		} 
 		// or, if this is a leaf but not contained, it's unplacable
 		else *placeableOnSubtree = false;
@@ -170,11 +879,12 @@ SomaticEventPtr_vec checkPlacement(Subclone *pnode, SomaticEventPtr_vec somaticE
 
 	// check children placement
 	int numChildrenPlaceable = 0;
-	std::vector<SomaticEventPtr_vec> childEventDiffSet;
+	std::vector<Set> childEventDiffSet;
+	childEventDiffSet.reserve(pnode->getVecChildren().size());
 
 	for(size_t i=0; i<pnode->getVecChildren().size(); i++) {
 		bool childPlacable = false;
-		SomaticEventPtr_vec childEventDiff = checkPlacement(dynamic_cast<Subclone *>(pnode->getVecChildren()[i]), eventDiff, &childPlacable);
+		Set childEventDiff = PlaceOnSubtree(dynamic_cast<Subclone *>(pnode->getVecChildren()[i]), eventDiff, &childPlacable, (int *)NULL, context, sets);
 
 		if(childPlacable) {
 			numChildrenPlaceable++;
@@ -188,7 +898,7 @@ SomaticEventPtr_vec checkPlacement(Subclone *pnode, SomaticEventPtr_vec somaticE
 	}
 
 	// find the path that would leads to the most symbol consumption
-	std::sort(childEventDiffSet.begin(), childEventDiffSet.end(), resultSetComparator);
+	std::sort(childEventDiffSet.begin(), childEventDiffSet.end(), EventSets::sizeLess);
 	
 	bool isCheckedOut = true;
 	*placeableOnSubtree = false;
@@ -198,9 +908,9 @@ SomaticEventPtr_vec checkPlacement(Subclone *pnode, SomaticEventPtr_vec somaticE
 
 	// if the shortest returned list does not agree with each other, subsets of the floating node have been
 	// found on different branches, and is automatically a fail
-	size_t minChildEventDiffSetSize = childEventDiffSet[0].size();
-	for(size_t i=1; i<childEventDiffSet.size() && minChildEventDiffSetSize == childEventDiffSet[i].size(); i++) {
-		bool equalVector = eventSetContains(childEventDiffSet[0], childEventDiffSet[i]);
+	size_t minChildEventDiffSetSize = sets.size(childEventDiffSet[0]);
+	for(size_t i=1; i<childEventDiffSet.size() && minChildEventDiffSetSize == sets.size(childEventDiffSet[i]); i++) {
+		bool equalVector = sets.contains(childEventDiffSet[0], childEventDiffSet[i]);
 		if(not equalVector) {
 			*placeableOnSubtree = false;
 			return childEventDiffSet[0];
@@ -214,7 +924,7 @@ SomaticEventPtr_vec checkPlacement(Subclone *pnode, SomaticEventPtr_vec somaticE
 			// the returned eventSet of all children after symbol consumption are all the same as eventDiff
 			//
 			for(size_t i=0; i<childEventDiffSet.size(); i++) {
-				if(childEventDiffSet[i].size() != eventDiff.size() || !eventSetContains(eventDiff, childEventDiffSet[i])) {
+				if(sets.size(childEventDiffSet[i]) != sets.size(eventDiff) || !sets.contains(eventDiff, childEventDiffSet[i])) {
 					isCheckedOut = false;
 					break;
 				}
@@ -227,15 +937,15 @@ SomaticEventPtr_vec checkPlacement(Subclone *pnode, SomaticEventPtr_vec somaticE
 
 				// merge the secondary subclone onto the primary tree
 				Subclone * relExtNode = new Subclone();
-				relExtNode->setId(extSubId++);
+				relExtNode->setId(context.nextNodeId());
 				EventCluster * relExtCluster = new EventCluster();
-				for(size_t i=0; i<eventDiff.size(); i++) {
-					relExtCluster->addEvent(eventDiff[i]);
+				const SomaticEventPtr_vec& diffEvents = sets.events(eventDiff, eventBuffer);
+				for(size_t i=0; i<diffEvents.size(); i++) {
+					relExtCluster->addEvent(diffEvents[i]);
 				}
 				relExtNode->addEventCluster(relExtCluster);
 				relExtNode->setFraction(0.1);
-				if(eventDiff.size() > 0)
-					pnode->addChild(relExtNode);
+				GraftNewNode(pnode, relExtNode, not sets.isEmpty(eventDiff), context, sets);
 			}
 			else if (didPassContainment) {
 				// But before quitting, a attempt to find a hidden node should be carried out. This is done by finding all children
@@ -263,23 +973,22 @@ SomaticEventPtr_vec checkPlacement(Subclone *pnode, SomaticEventPtr_vec somaticE
 				// and the children, which is
 				// [eventChild] - ([eventChild] - eventDiff)
 
-				SubclonePtr_vec extruableChildren;
-				SomaticEventPtr_vec extrudeEvents;
-				SomaticEventPtr_vec uniqueEvents;
+				Set extrudeEvents;
+				Set uniqueEvents;
 				Subclone * extrudeNode = NULL;
 
 				// search for the child from which the hidden node shall be extruded
 				for(size_t p=0; p<pnode->getVecChildren().size(); p++) {
 					Subclone *pExtNode = dynamic_cast<Subclone *>(pnode->getVecChildren()[p]);
-					SomaticEventPtr_vec eventChild = nodeEventsList(dynamic_cast<Subclone *>(pExtNode));
-					SomaticEventPtr_vec thisUniqueEvents = SomaticEventDifference(eventChild, eventDiff);
-					SomaticEventPtr_vec thisExtrudeEvents = SomaticEventDifference(eventChild, thisUniqueEvents);
-					SomaticEventPtr_vec otherUniqueEvents = SomaticEventDifference(eventDiff, eventChild);
+					Set eventChild, thisExtrudeEvents, otherUniqueEvents;
+					sets.pathEvents(pExtNode, eventChild);
+					sets.intersection(eventChild, eventDiff, thisExtrudeEvents);
+					sets.difference(eventDiff, eventChild, otherUniqueEvents);
 
 					// if [eventChild] .intersect. [eventDiff] != []
-					if(thisExtrudeEvents.size() > 0) {
+					if(not sets.isEmpty(thisExtrudeEvents)) {
 						// check if [eventChild] - [eventDiff] == childEventDiffSet[0]
-						if(otherUniqueEvents.size() == childEventDiffSet[0].size() && eventSetContains(otherUniqueEvents, childEventDiffSet[0])) {
+						if(sets.size(otherUniqueEvents) == sets.size(childEventDiffSet[0]) && sets.contains(otherUniqueEvents, childEventDiffSet[0])) {
 							extrudeEvents = thisExtrudeEvents;
 							uniqueEvents = otherUniqueEvents;
 							extrudeNode = pExtNode;
@@ -290,57 +999,64 @@ SomaticEventPtr_vec checkPlacement(Subclone *pnode, SomaticEventPtr_vec somaticE
 				if(extrudeNode != NULL) {
 					*placeableOnSubtree = true;
 
+					// the events are listed before the child they come from is changed
+					SomaticEventPtr_vec extrudeList = sets.events(extrudeEvents, eventBuffer);
+
 					// Create the extruded subclone
 					Subclone * extrudedSubclone = new Subclone();
-					extrudedSubclone->setId(extSubId++);
+					extrudedSubclone->setId(context.nextNodeId());
 					// Aggregate the extruded events into one cluster, and put it into the new subclone
 					EventCluster *extrudedCluster = new EventCluster();
-					for(size_t i=0; i<extrudeEvents.size(); i++) {
-						extrudedCluster->addEvent(extrudeEvents[i], false);
+					for(size_t i=0; i<extrudeList.size(); i++) {
+						extrudedCluster->addEvent(extrudeList[i], false);
 					}
 					// Set the fraction of the extruded subclone to 0
 					extrudedCluster->setCellFraction(0);
 					extrudedSubclone->addEventCluster(extrudedCluster);
 					extrudedSubclone->setFraction(0);
+					context.undoLog().nodeCreated(extrudedSubclone);
 					// Remove the extruded events from the current node
 					// Note: a simple implementation is to remove any cluster
 					// which contains any events found in the extruded event list
 					// This is ok if an entire cluster will always be extruded away
 
-					for(size_t i=0; i<extrudeEvents.size(); i++) {
-						// look for the cluster that contains extrudeEvents[j]
+					for(size_t i=0; i<extrudeList.size(); i++) {
+						// look for the cluster that contains extrudeList[j]
 						for(size_t j=0; j<extrudeNode->vecEventCluster().size(); j++) {
 							bool found = false;
-							for(size_t k=0; k<extrudeNode->vecEventCluster()[j]->members().size(); k++) {
-								if(extrudeNode->vecEventCluster()[j]->members()[k]->isEqualTo(extrudeEvents[i])) {
+							const SomaticEventPtr_vec& members = extrudeNode->vecEventCluster()[j]->members();
+							for(size_t k=0; k<members.size(); k++) {
+								if(members[k]->isEqualTo(extrudeList[i])) {
 									found = true;
 									break;
 								}
 							}
 							if(found) {
-								extrudeNode->vecEventCluster().erase(extrudeNode->vecEventCluster().begin() + j);
+								context.undoLog().removeCluster(extrudeNode, j);
 								break;
 							}
 						}
 					}
 
-					pnode->removeChild(extrudeNode);
-					extrudedSubclone->addChild(extrudeNode);
-					
+					context.undoLog().removeChild(pnode, extrudeNode);
+					context.undoLog().addChild(extrudedSubclone, extrudeNode);
+					sets.nodeChanged(extrudeNode);
+
 					// Change the tree structure
-					pnode->addChild(extrudedSubclone);
+					context.undoLog().addChild(pnode, extrudedSubclone);
+					sets.nodeChanged(extrudedSubclone);
 
 					// Also the merged relapse tree needs to be recorded to prevent future incorrect extrusion
 					Subclone * relExtNode = new Subclone();
-					relExtNode->setId(extSubId++);
+					relExtNode->setId(context.nextNodeId());
 					EventCluster * relExtCluster = new EventCluster();
-					for(size_t i=0; i<uniqueEvents.size(); i++) {
-						relExtCluster->addEvent(uniqueEvents[i]);
+					const SomaticEventPtr_vec& uniqueList = sets.events(uniqueEvents, eventBuffer);
+					for(size_t i=0; i<uniqueList.size(); i++) {
+						relExtCluster->addEvent(uniqueList[i]);
 					}
 					relExtNode->addEventCluster(relExtCluster);
 					relExtNode->setFraction(0.1);
-					if(uniqueEvents.size() > 0)
-						extrudedSubclone->addChild(relExtNode);
+					GraftNewNode(extrudedSubclone, relExtNode, not sets.isEmpty(uniqueEvents), context, sets);
 				}
 			}
 			break;
@@ -351,7 +1067,7 @@ SomaticEventPtr_vec checkPlacement(Subclone *pnode, SomaticEventPtr_vec somaticE
 			// moreover, it must yield the most symbol consumption, because other subtrees will not be able to consume
 			// the symbols specifically found in the placeable child node.
 			for(size_t i=1; i<childEventDiffSet.size(); i++) {
-				if(!eventSetContains(childEventDiffSet[i], childEventDiffSet[0])) {
+				if(!sets.contains(childEventDiffSet[i], childEventDiffSet[0])) {
 					isCheckedOut = false;
 					break;
 				}
@@ -371,12 +1087,48 @@ SomaticEventPtr_vec checkPlacement(Subclone *pnode, SomaticEventPtr_vec somaticE
 	return(childEventDiffSet[0]);
 }
 
+/**
+ * Place a node with the given events on a subtree, comparing event sets as
+ * bitsets of classes if the classes of the events are given
+ *
+ * @param eventClasses The class of every event, or NULL to compare the events pairwise
+ * @return The events not found on the subtree to the point the node is placed
+ */
+static SomaticEventPtr_vec PlaceEventsOnSubtree(Subclone *pnode, const SomaticEventPtr_vec& somaticEvents, const std::vector<size_t> *eventClasses, bool * placeableOnSubtree, int * cp, TreeMergeContext& context) {
+	if(eventClasses != NULL) {
+		ClassEventSets sets(context, somaticEvents, *eventClasses);
+		ClassEventSets::Set eventDiff = PlaceOnSubtree(pnode, sets.all(), placeableOnSubtree, cp, context, sets);
+		SomaticEventPtr_vec diffEvents;
+		sets.events(eventDiff, diffEvents);
+		return diffEvents;
+	}
+
+	PairwiseEventSets sets;
+	return PlaceOnSubtree(pnode, somaticEvents, placeableOnSubtree, cp, context, sets);
+}
+
+SomaticEventPtr_vec checkPlacement(Subclone *pnode, SomaticEventPtr_vec somaticEvents, bool * placeableOnSubtree, int * cp, TreeMergeContext * context) {
+	TreeMergeContext localContext;
+	TreeMergeContext& placeContext = context != NULL ? *context : localContext;
+
+	std::vector<size_t> eventClasses;
+	bool comparesClasses = placeContext.comparesClasses() && placeContext.eventClasses()->classesOf(somaticEvents, eventClasses);
+	SomaticEventPtr_vec eventDiff = PlaceEventsOnSubtree(pnode, somaticEvents, comparesClasses ? &eventClasses : NULL, placeableOnSubtree, cp, placeContext);
+
+	// without a context, the changes are kept
+	if(context == NULL)
+		localContext.commit();
+	return eventDiff;
+}
+
 /**
  * @brief Traverse the secondary tree, and try to place every node it encounters onto the primary tree, which was given as a constructor parameter.
  */
-class TreeMergeTraverseSecondary : public TreeTraverseDelegate {
+class TreeMergeTraverseSecondary : public TreeVisitor<Subclone> {
 	protected:
 		Subclone *_proot; /**< The root of the primary tree */
+		TreeMergeContext& _context; /**< Records the changes made to the primary tree */
+		std::vector<size_t> _eventClasses; /**< the classes of the events of the node being placed */
 
 	public:
 		bool isCompatible; /**< Whether two trees are compatible or not. */
@@ -385,25 +1137,25 @@ class TreeMergeTraverseSecondary : public TreeTraverseDelegate {
 		 * Constructor of the TreeMergeTraverseSecondary class
 		 *
 		 * @param proot To which primary tree are all the secondary nodes being placed on
+		 * @param context Records the changes made to the primary tree
 		 */
-		TreeMergeTraverseSecondary(Subclone *proot): TreeTraverseDelegate(), _proot(proot), isCompatible(true) {;}
+		TreeMergeTraverseSecondary(Subclone *proot, TreeMergeContext& context): TreeVisitor<Subclone>(), _proot(proot), _context(context), isCompatible(true) {;}
 
-		void processNode(TreeNode *node) {
+		void processNode(Subclone *wp) {
 			bool placeable;
-			Subclone *wp = dynamic_cast<Subclone *>(node);
-
-			// If the given node is NULL, or is not a Subclone node, skip it.
-			if(wp == NULL) return;
 
 			// If the node is relapse's root, skip it.
-			if(node->isRoot()) return;
+			if(wp->isRoot()) return;
 
 			// If the subclone is very small in fraction, skip it.
 			if(fabs(wp->fraction()) < MIN_CLONE_FRAC) return;
 
 			SomaticEventPtr_vec subcloneEvents = nodeEventsList(wp);
 
-			SomaticEventPtr_vec diff = checkPlacement(_proot, subcloneEvents, &placeable);
+			// the classes of the secondary nodes were computed with the tree
+			_eventClasses.clear();
+			bool comparesClasses = _context.comparesClasses() && ClassEventSets::pathClasses(wp, _context, _eventClasses);
+			SomaticEventPtr_vec diff = PlaceEventsOnSubtree(_proot, subcloneEvents, comparesClasses ? &_eventClasses : NULL, &placeable, NULL, _context);
 			if(!placeable) {
 				isCompatible = false;
 				terminate();
@@ -413,9 +1165,144 @@ class TreeMergeTraverseSecondary : public TreeTraverseDelegate {
 
 
 // Check if two trees are compatible
-bool TreeMerge(Subclone *p, Subclone *q) {
-	TreeMergeTraverseSecondary secondaryTraverser(p);
-	TreeNode::PreOrderTraverse(q, secondaryTraverser);
+bool TreeMerge(Subclone *p, Subclone *q, TreeMergeContext *context) {
+	TreeMergeContext localContext;
+	TreeMergeContext& mergeContext = context != NULL ? *context : localContext;
+	TreeMergeTraverseSecondary secondaryTraverser(p, mergeContext);
+	mergeContext.traverser().preOrderVisit(q, secondaryTraverser);
+
+	// without a context, the changes are kept
+	if(context == NULL)
+		localContext.commit();
 
 	return secondaryTraverser.isCompatible;
 }
+
+/**
+ * @brief Collect the events of all the nodes of the trees it traverses
+ */
+class TreeEventCollector : public TreeVisitor<Subclone> {
+	public:
+		SomaticEventPtr_vec events; /**< the events collected */
+
+		void processNode(Subclone *wp) {
+			for(size_t i=0; i<wp->vecEventCluster().size(); i++) {
+				const SomaticEventPtr_vec& members = wp->vecEventCluster()[i]->members();
+				events.insert(events.end(), members.begin(), members.end());
+			}
+		}
+};
+
+/**
+ * @brief Compute the classes of the events of all the nodes of the trees it traverses
+ */
+class TreeNodeClassCollector : public TreeVisitor<Subclone> {
+	protected:
+		const EventClassIndex& _eventClasses; /**< the classes of the events */
+
+	public:
+		NodeClassTable nodeClasses; /**< the classes of the nodes traversed */
+		bool isComplete; /**< if the classes of all the nodes are known */
+
+		/**
+		 * Constructor
+		 *
+		 * @param eventClasses The classes of the events
+		 */
+		TreeNodeClassCollector(const EventClassIndex& eventClasses): TreeVisitor<Subclone>(), _eventClasses(eventClasses), isComplete(true) {;}
+
+		void processNode(Subclone *wp) {
+			if(not nodeClasses.update(wp, _eventClasses)) {
+				isComplete = false;
+				terminate();
+			}
+		}
+};
+
+/**
+ * @brief The work shared by the threads of PairwiseTreeMerge
+ */
+struct PairwiseTreeMergeJob {
+	const SubclonePtr_vec *primaryTrees; /**< the primary trees */
+	const SubclonePtr_vec *secondaryTrees; /**< the secondary trees */
+	const EventClassIndex *eventClasses; /**< the classes of the events of all the trees */
+	const NodeClassTable *nodeClasses; /**< the classes of the nodes of all the trees, or NULL */
+	std::vector<std::vector<bool> > *compatible; /**< the result of every pair */
+	size_t nextPrimary; /**< the next primary tree to be checked */
+	pthread_mutex_t lock; /**< protects nextPrimary */
+};
+
+/**
+ * Check primary trees against all the secondary trees, until there is none
+ * left. Each primary tree is only ever changed by the thread that took it.
+ *
+ * @param arg The PairwiseTreeMergeJob
+ */
+static void *PairwiseTreeMergeWorker(void *arg) {
+	PairwiseTreeMergeJob *job = static_cast<PairwiseTreeMergeJob *>(arg);
+	TreeMergeContext context(job->eventClasses, job->nodeClasses);
+
+	while(true) {
+		pthread_mutex_lock(&job->lock);
+		size_t i = job->nextPrimary++;
+		pthread_mutex_unlock(&job->lock);
+
+		if(i >= job->primaryTrees->size())
+			break;
+
+		std::vector<bool>& row = (*job->compatible)[i];
+		for(size_t j=0; j<job->secondaryTrees->size(); j++) {
+			row[j] = TreeMerge((*job->primaryTrees)[i], (*job->secondaryTrees)[j], &context);
+			context.rollback();
+		}
+	}
+
+	return NULL;
+}
+
+void PairwiseTreeMerge(const SubclonePtr_vec& primaryTrees, const SubclonePtr_vec& secondaryTrees, int numThreads, std::vector<std::vector<bool> >& compatible) {
+	compatible.assign(primaryTrees.size(), std::vector<bool>(secondaryTrees.size(), false));
+
+	TreeEventCollector collector;
+	TreeTraverser traverser;
+	for(size_t i=0; i<primaryTrees.size(); i++)
+		traverser.preOrderVisit(primaryTrees[i], collector);
+	for(size_t j=0; j<secondaryTrees.size(); j++)
+		traverser.preOrderVisit(secondaryTrees[j], collector);
+	EventClassIndex eventClasses;
+	eventClasses.build(collector.events);
+
+	// the classes of every node are computed once, for all the pairs
+	TreeNodeClassCollector classCollector(eventClasses);
+	if(eventClasses.isExact()) {
+		for(size_t i=0; i<primaryTrees.size(); i++)
+			traverser.preOrderVisit(primaryTrees[i], classCollector);
+		for(size_t j=0; j<secondaryTrees.size(); j++)
+			traverser.preOrderVisit(secondaryTrees[j], classCollector);
+	}
+
+	PairwiseTreeMergeJob job;
+	job.primaryTrees = &primaryTrees;
+	job.secondaryTrees = &secondaryTrees;
+	job.eventClasses = &eventClasses;
+	job.nodeClasses = eventClasses.isExact() && classCollector.isComplete ? &classCollector.nodeClasses : NULL;
+	job.compatible = &compatible;
+	job.nextPrimary = 0;
+	pthread_mutex_init(&job.lock, NULL);
+
+	if(numThreads > (int)primaryTrees.size())
+		numThreads = primaryTrees.size();
+
+	if(numThreads <= 1) {
+		PairwiseTreeMergeWorker(&job);
+	}
+	else {
+		std::vector<pthread_t> threads(numThreads);
+		for(int t=0; t<numThreads; t++)
+			pthread_create(&threads[t], NULL, PairwiseTreeMergeWorker, &job);
+		for(int t=0; t<numThreads; t++)
+			pthread_join(threads[t], NULL);
+	}
+
+	pthread_mutex_destroy(&job.lock);
+}
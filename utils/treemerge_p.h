@@ -36,7 +36,9 @@ THE SOFTWARE.
 #ifndef TREEMERGE_P_H
 #define TREEMERGE_P_H
 
+#include <vector>
 #include "SomaticEvent.h"
+#include "EventCluster.h"
 #include "Subclone.h"
 
 /**
@@ -44,8 +46,405 @@ THE SOFTWARE.
  */
 #define BOUNDRY_RESOLUTION 20000000L
 
+/**
+ * The id given to the first node created while checking a pair of trees
+ */
+#define TREEMERGE_FIRST_NODE_ID 500
+
 using namespace SubcloneSeeker;
 
+/**
+ * The number of words of an EventClassSet stored within the object, so that
+ * small sets are made without allocating memory
+ */
+#define EVENT_CLASS_SET_INLINE_WORDS 4
+
+/**
+ * @brief A set of event classes, stored as a bitset
+ */
+class EventClassSet {
+	protected:
+		size_t _numWords; /**< the number of words of the bitset */
+		unsigned long _inlineWords[EVENT_CLASS_SET_INLINE_WORDS]; /**< the bitset, if it is small */
+		std::vector<unsigned long> _heapWords; /**< the bitset, if it is large */
+
+		/**
+		 * @return The words of the bitset
+		 */
+		inline unsigned long *words() {return _numWords <= EVENT_CLASS_SET_INLINE_WORDS ? _inlineWords : &_heapWords[0];}
+
+		/**
+		 * @return The words of the bitset
+		 */
+		inline const unsigned long *words() const {return _numWords <= EVENT_CLASS_SET_INLINE_WORDS ? _inlineWords : &_heapWords[0];}
+
+	public:
+		/**
+		 * Constructor. The set has no room for any class until reset
+		 */
+		EventClassSet(): _numWords(0) {
+			for(size_t i=0; i<EVENT_CLASS_SET_INLINE_WORDS; i++)
+				_inlineWords[i] = 0;
+		}
+
+		/**
+		 * Empty the set, and make room for a number of classes
+		 *
+		 * @param numClasses The number of classes
+		 */
+		void reset(size_t numClasses);
+
+		/**
+		 * @param classId The class to be added
+		 */
+		inline void insert(size_t classId) {words()[classId / (8 * sizeof(unsigned long))] |= 1UL << (classId % (8 * sizeof(unsigned long)));}
+
+		/**
+		 * @param classId The class
+		 * @return If the class is in the set
+		 */
+		inline bool contains(size_t classId) const {return (words()[classId / (8 * sizeof(unsigned long))] >> (classId % (8 * sizeof(unsigned long)))) & 1UL;}
+
+		/**
+		 * Remove from this set the classes of another one
+		 *
+		 * @param other A set made for the same number of classes
+		 */
+		void subtract(const EventClassSet& other);
+
+		/**
+		 * Keep in this set only the classes also in another one
+		 *
+		 * @param other A set made for the same number of classes
+		 */
+		void intersect(const EventClassSet& other);
+
+		/**
+		 * Add to this set the classes of another one
+		 *
+		 * @param other A set made for the same number of classes
+		 */
+		void unite(const EventClassSet& other);
+
+		/**
+		 * @return The number of classes in the set
+		 */
+		size_t count() const;
+
+		/**
+		 * @param other A set made for the same number of classes
+		 * @return The number of classes in both sets
+		 */
+		size_t countCommon(const EventClassSet& other) const;
+
+		/**
+		 * @return If there is no class in the set
+		 */
+		bool isEmpty() const;
+
+		/**
+		 * @param other A set made for the same number of classes
+		 * @return If all the classes in this set are in the other one
+		 */
+		bool isSubsetOf(const EventClassSet& other) const;
+};
+
+/**
+ * @brief Maps the events of a collection of trees to equivalence classes
+ *
+ * Two events are treated as the same when they are equal at
+ * BOUNDRY_RESOLUTION. That relation is only an equivalence if it is
+ * transitive over the events at hand, which is verified when the index is
+ * built. If it holds, event sets can be compared as sets of classes instead
+ * of pairwise; otherwise the index is not exact, and must not be used.
+ *
+ * Events of the same type over the same range are assumed to be
+ * interchangeable, so that the relation only needs to be checked between
+ * distinct ranges, and segmental events are only compared with the ones a
+ * GenomicRangeIndex finds equal to them within the resolution.
+ */
+class EventClassIndex {
+	protected:
+		std::vector<SomaticEvent *> _slotEvents; /**< open addressing hash table of the events */
+		std::vector<size_t> _slotClasses; /**< class of the event in every slot of the table */
+		size_t _numClasses; /**< the number of classes */
+		bool _isExact; /**< if the classes are an exact equivalence */
+
+	public:
+		/**
+		 * Constructor. The index is empty, and not exact
+		 */
+		EventClassIndex(): _numClasses(0), _isExact(false) {}
+
+		/**
+		 * Replace the content of the index by the classes of a list of events
+		 *
+		 * @param events The events, possibly with duplicates
+		 */
+		void build(const SomaticEventPtr_vec& events);
+
+		/**
+		 * @return If the classes can stand for the events in set comparisons
+		 */
+		inline bool isExact() const {return _isExact;}
+
+		/**
+		 * @return The number of classes
+		 */
+		inline size_t numClasses() const {return _numClasses;}
+
+		/**
+		 * @param event An event
+		 * @return The class of the event, or -1 if it is not in the index
+		 */
+		long classOf(SomaticEvent *event) const;
+
+		/**
+		 * Look the classes of a list of events up
+		 *
+		 * @param events The events
+		 * @param classes Receives the class of every event, in order
+		 * @return false if the index is not exact or one of the events is not
+		 * in it, in which case classes is undefined
+		 */
+		bool classesOf(const SomaticEventPtr_vec& events, std::vector<size_t>& classes) const;
+};
+
+/**
+ * @brief The classes of the events of a node, those of its own clusters
+ */
+struct NodeEventClasses {
+	EventClassSet classes; /**< the classes of the events, as a bitset */
+	std::vector<size_t> eventClasses; /**< the class of every event, in the order of the clusters and of their members */
+};
+
+/**
+ * @brief The classes of the events of the nodes of trees, looked up by node
+ *
+ * The classes of a node are computed once, when the node is added, so that
+ * the event sets of the nodes are compared as bitsets without looking their
+ * events up again.
+ */
+class NodeClassTable {
+	protected:
+		std::vector<Subclone *> _slotNodes; /**< open addressing hash table of the nodes */
+		std::vector<size_t> _slotEntries; /**< index in _entries of the node in every slot */
+		std::vector<NodeEventClasses> _entries; /**< the classes of every node, in the order the nodes were added */
+
+	public:
+		/**
+		 * Compute the classes of the events of a node, and add them to the
+		 * table, in place of any the table held for the node
+		 *
+		 * @param node The node
+		 * @param index The classes of the events
+		 * @return false if the index is not exact or does not hold all the
+		 * events of the node, in which case the node is not added
+		 */
+		bool update(Subclone *node, const EventClassIndex& index);
+
+		/**
+		 * @param node A node
+		 * @return The classes of the events of the node, or NULL if it is not
+		 * in the table. The pointer is valid until the table is next changed
+		 */
+		const NodeEventClasses *find(Subclone *node) const;
+
+		/**
+		 * @return The number of nodes in the table
+		 */
+		inline size_t size() const {return _entries.size();}
+
+		/**
+		 * Remove all the nodes. The memory is kept for the next ones
+		 */
+		void clear();
+};
+
+/**
+ * @brief Records the changes made to a primary tree while merging, so that
+ * they can be undone
+ *
+ * checkPlacement grafts new nodes onto the primary tree, and may move nodes
+ * and clusters around to extrude hidden nodes. When given an undo log, it
+ * goes through the log for every such change, and rollback() then restores
+ * the tree exactly as it was, child and cluster order included. This way a
+ * primary tree can be checked against many secondary trees without being
+ * copied. The nodes and clusters created during the merge are owned by the
+ * log until it is committed; the events they refer to are not.
+ */
+class TreeMergeUndoLog {
+	protected:
+		/**
+		 * The kinds of change recorded
+		 */
+		enum ChangeType {
+			CHANGE_NODE_CREATED,  /**< a new node was created */
+			CHANGE_CHILD_ADDED,   /**< a child was appended to a node */
+			CHANGE_CHILD_REMOVED, /**< a child was removed from a node */
+			CHANGE_CLUSTER_REMOVED /**< a cluster was removed from a node */
+		};
+
+		/**
+		 * @brief A change made to the tree
+		 */
+		struct Change {
+			ChangeType type; /**< the kind of change */
+			Subclone *node; /**< the node changed, or created */
+			Subclone *child; /**< the child added or removed */
+			EventCluster *cluster; /**< the cluster removed */
+			size_t position; /**< where the child or cluster was removed from */
+		};
+
+		std::vector<Change> _changes; /**< the changes, in the order they were made */
+
+		/**
+		 * Append a change to the log
+		 */
+		void record(ChangeType type, Subclone *node, Subclone *child, EventCluster *cluster, size_t position);
+
+	public:
+		/**
+		 * Destructor. Rolls back the changes not committed
+		 */
+		~TreeMergeUndoLog();
+
+		/**
+		 * Take ownership of a node created during the merge, with its clusters
+		 *
+		 * @param node The new node
+		 */
+		void nodeCreated(Subclone *node);
+
+		/**
+		 * Append a child to a node
+		 *
+		 * @param node The parent node
+		 * @param child The new child
+		 */
+		void addChild(Subclone *node, Subclone *child);
+
+		/**
+		 * Remove a child from a node
+		 *
+		 * @param node The parent node
+		 * @param child The child to be removed
+		 */
+		void removeChild(Subclone *node, Subclone *child);
+
+		/**
+		 * Remove a cluster from a node
+		 *
+		 * @param node The node
+		 * @param position The index of the cluster in the node
+		 */
+		void removeCluster(Subclone *node, size_t position);
+
+		/**
+		 * @return The number of changes recorded
+		 */
+		inline size_t size() const {return _changes.size();}
+
+		/**
+		 * Undo all the changes, in reverse order, and free the nodes created
+		 */
+		void rollback();
+
+		/**
+		 * Keep all the changes. The nodes created become part of the tree
+		 */
+		void commit();
+};
+
+/**
+ * @brief All the state of a compatibility check
+ *
+ * The nodes created while checking a pair of trees are numbered, and all the
+ * changes made to the primary tree are recorded, by the context of the check
+ * rather than by any global state. Checks running on different threads, each
+ * with its own context and primary tree, do not interfere with each other.
+ * A context can be reused for the next pair once rolled back, and the nodes
+ * created are then numbered the same way whatever checks came before.
+ */
+class TreeMergeContext {
+	protected:
+		int _nextNodeId; /**< the id of the next node created */
+		TreeMergeUndoLog _undoLog; /**< the changes made to the primary tree */
+		const EventClassIndex *_eventClasses; /**< the classes of the events of both trees, or NULL */
+		const NodeClassTable *_nodeClasses; /**< the classes of the nodes of both trees, or NULL */
+		NodeClassTable _changedNodeClasses; /**< the classes of the nodes created or changed since the last rollback */
+		TreeTraverser _traverser; /**< traverses the secondary trees */
+
+	public:
+		/**
+		 * Constructor. Event sets are compared as bitsets of classes when
+		 * both tables are given and the classes are exact, and pairwise
+		 * otherwise
+		 *
+		 * @param eventClasses If given, the classes of all the events of the
+		 * trees checked. It must outlive the context
+		 * @param nodeClasses If given, the classes of all the nodes of the
+		 * trees checked, computed with eventClasses. It must outlive the context
+		 */
+		TreeMergeContext(const EventClassIndex *eventClasses = NULL, const NodeClassTable *nodeClasses = NULL);
+
+		/**
+		 * @return The classes of the events of the trees checked, or NULL
+		 */
+		inline const EventClassIndex *eventClasses() const {return _eventClasses;}
+
+		/**
+		 * @return If event sets are compared as bitsets of classes
+		 */
+		inline bool comparesClasses() const {return _eventClasses != NULL && _nodeClasses != NULL && _eventClasses->isExact();}
+
+		/**
+		 * Look the classes of the events of a node up, computing them if the
+		 * node is in neither table
+		 *
+		 * @param node A node of the trees checked, or one created while
+		 * checking them
+		 * @return The classes, or NULL if the context does not compare
+		 * classes or an event of the node is not known
+		 */
+		const NodeEventClasses *nodeClassesOf(Subclone *node);
+
+		/**
+		 * Compute the classes of the events of a node again, after its
+		 * clusters were changed or it was created
+		 *
+		 * @param node The node
+		 */
+		void nodeChanged(Subclone *node);
+
+		/**
+		 * @return The id for a new node
+		 */
+		inline int nextNodeId() {return _nextNodeId++;}
+
+		/**
+		 * @return The log of the changes made to the primary tree
+		 */
+		inline TreeMergeUndoLog& undoLog() {return _undoLog;}
+
+		/**
+		 * @return The traverser of the secondary trees, whose stack is reused
+		 * from one pair of trees to the next
+		 */
+		inline TreeTraverser& traverser() {return _traverser;}
+
+		/**
+		 * Undo all the changes made to the primary tree, and start numbering
+		 * the new nodes over
+		 */
+		void rollback();
+
+		/**
+		 * Keep all the changes made to the primary tree
+		 */
+		void commit();
+};
+
 /**
  * Generate a list of events from a given subclone node. 
  * In the subclone data structure, events of a parent is not duplicated in 
@@ -95,20 +494,45 @@ bool resultSetComparator(const SomaticEventPtr_vec& v1, const SomaticEventPtr_ve
  * @param somaticEvents The somatic events found in the new node, containing all its parents' ones.
  * @param placeableOnSubtree An output boolean variable indicating whether the placement is successful or not.
  * @param cp The number of children nodes that are able to contain the floating node. Used for debugging purpose.
+ * @param context If given, records the changes made to the subtree so that they can be undone, and
+ * gives the classes of the events when they are compared as bitsets. Otherwise the changes are kept
  * @return A vector containing events not found on the subtree to the point the node is placed.
  */
 SomaticEventPtr_vec checkPlacement(
 		Subclone *pnode, 
 		SomaticEventPtr_vec somaticEvents, 
 		bool * placeableOnSubtree,
-		int * cp = NULL);
+		int * cp = NULL,
+		TreeMergeContext * context = NULL);
 
 /**
- * Check if two subclonal trees are compatible.
+ * Check if two subclonal trees are compatible. The secondary nodes are
+ * merged into the first tree as they are placed; the second tree is not
+ * changed.
  *
  * @param p The first subclone tree
  * @param q The second subclone tree
+ * @param context If given, records the changes made to the first tree so that they can be undone. Otherwise the changes are kept
  * @return True if the two trees are compatible, false otherwise
  */
-bool TreeMerge(Subclone *p, Subclone *q);
+bool TreeMerge(Subclone *p, Subclone *q, TreeMergeContext *context = NULL);
+
+/**
+ * Check every primary tree against every secondary tree, on multiple threads.
+ *
+ * The primary trees are handed out to the worker threads one at a time. A
+ * worker checks its primary tree against all the secondary trees in turn,
+ * undoing the changes after each pair, so that all the trees are left as
+ * they were. The secondary trees are only read, and are shared by all the
+ * workers, as are an EventClassIndex built over the events of both sets and
+ * a NodeClassTable holding the classes of every node, computed once. The
+ * results do not depend on the number of threads.
+ *
+ * @param primaryTrees The primary trees
+ * @param secondaryTrees The secondary trees
+ * @param numThreads The number of worker threads
+ * @param compatible Receives, for every primary tree i and secondary tree j,
+ * whether the two are compatible as compatible[i][j]
+ */
+void PairwiseTreeMerge(const SubclonePtr_vec& primaryTrees, const SubclonePtr_vec& secondaryTrees, int numThreads, std::vector<std::vector<bool> >& compatible);
 #endif
@@ -860,6 +860,426 @@ SUITE(SampleTumors) {
 	}
 }
 
+/**
+ * Records the structure of a tree: every node, its parent and its clusters, in pre-order
+ */
+class TreeShapeTraverser : public TreeTraverseDelegate {
+	public:
+		std::vector<void *> shape;
+
+		virtual void processNode(TreeNode *node) {
+			Subclone *clone = dynamic_cast<Subclone *>(node);
+			shape.push_back(clone);
+			shape.push_back(clone->getParent());
+			for(size_t i=0; i<clone->vecEventCluster().size(); i++)
+				shape.push_back(clone->vecEventCluster()[i]);
+			shape.push_back(NULL);
+		}
+};
+
+std::vector<void *> treeShape(Subclone *root) {
+	TreeShapeTraverser traverser;
+	TreeNode::PreOrderTraverse(root, traverser);
+	return traverser.shape;
+}
+
+/**
+ * Collects the nodes of a tree and their events, in pre-order
+ */
+class TreeNodeEventCollector : public TreeVisitor<Subclone> {
+	public:
+		SubclonePtr_vec nodes;
+		SomaticEventPtr_vec events;
+
+		void processNode(Subclone *wp) {
+			nodes.push_back(wp);
+			for(size_t i=0; i<wp->vecEventCluster().size(); i++) {
+				const SomaticEventPtr_vec& members = wp->vecEventCluster()[i]->members();
+				events.insert(events.end(), members.begin(), members.end());
+			}
+		}
+};
+
+SUITE(TestTreeMergeUndoLog) {
+	TEST_FIXTURE(_TestPlacementFixture, T_RollbackRestoresTree) {
+		Subclone *primary[] = {&p0, &pp0, &upn933124_1->p0, &upn933124_2->p0, &upn768168_2->p0};
+		Subclone *secondary[] = {&r0, &rr0, &upn933124_1->r0, &upn933124_2->r0, &upn768168_2->r0};
+		size_t numChanged = 0;
+
+		for(size_t i=0; i<5; i++) {
+			for(size_t j=0; j<5; j++) {
+				std::vector<void *> pShape = treeShape(primary[i]);
+				std::vector<void *> sShape = treeShape(secondary[j]);
+
+				TreeMergeContext context;
+				bool compatible = TreeMerge(primary[i], secondary[j], &context);
+				if(context.undoLog().size() > 0)
+					numChanged++;
+				context.rollback();
+
+				CHECK(context.undoLog().size() == 0);
+				CHECK(treeShape(primary[i]) == pShape);
+				CHECK(treeShape(secondary[j]) == sShape);
+
+				// the restored tree gives the same answer
+				TreeMergeContext secondContext;
+				CHECK(TreeMerge(primary[i], secondary[j], &secondContext) == compatible);
+			}
+		}
+
+		CHECK(numChanged > 0);
+	}
+
+	TEST_FIXTURE(_TestPlacementFixture, T_PairwiseTreeMerge) {
+		SubclonePtr_vec primary, secondary;
+		primary.push_back(&p0);
+		primary.push_back(&pp0);
+		primary.push_back(&upn933124_1->p0);
+		primary.push_back(&upn933124_2->p0);
+		primary.push_back(&upn768168_2->p0);
+		secondary.push_back(&r0);
+		secondary.push_back(&rr0);
+		secondary.push_back(&upn933124_1->r0);
+		secondary.push_back(&upn933124_2->r0);
+		secondary.push_back(&upn768168_2->r0);
+
+		std::vector<std::vector<void *> > pShapes;
+		for(size_t i=0; i<primary.size(); i++)
+			pShapes.push_back(treeShape(primary[i]));
+
+		std::vector<std::vector<bool> > serial, parallel;
+		PairwiseTreeMerge(primary, secondary, 1, serial);
+		PairwiseTreeMerge(primary, secondary, 3, parallel);
+
+		CHECK(serial.size() == primary.size());
+		CHECK(serial == parallel);
+		for(size_t i=0; i<primary.size(); i++) {
+			CHECK(treeShape(primary[i]) == pShapes[i]);
+			for(size_t j=0; j<secondary.size(); j++) {
+				TreeMergeContext context;
+				CHECK(TreeMerge(primary[i], secondary[j], &context) == serial[i][j]);
+			}
+		}
+		CHECK(serial[4][4]);
+	}
+}
+/**
+ * Set the range of a segmental mutation
+ */
+static void setCNVRange(SegmentalMutation& cnv, int chrom, unsigned long position, unsigned long length) {
+	cnv.range.chrom = chrom;
+	cnv.range.position = position;
+	cnv.range.length = length;
+}
+
+SUITE(TestEventClassIndex) {
+	TEST(T_ExactClasses) {
+		CNV a, b, c, d;
+		setCNVRange(a, 1, 0, 1000000L);
+		setCNVRange(b, 1, 5000000L, 2000000L);
+		setCNVRange(c, 2, 0, 1000000L);
+		setCNVRange(d, 1, 0, 1000000L);
+
+		SomaticEventPtr_vec events;
+		events.push_back(&a);
+		events.push_back(&b);
+		events.push_back(&c);
+		events.push_back(&d);
+		events.push_back(&a);
+
+		EventClassIndex index;
+		index.build(events);
+		CHECK(index.isExact());
+		CHECK(index.numClasses() == 2);
+		CHECK(index.classOf(&a) == index.classOf(&b));
+		CHECK(index.classOf(&a) == index.classOf(&d));
+		CHECK(index.classOf(&a) != index.classOf(&c));
+
+		CNV unknown;
+		CHECK(index.classOf(&unknown) == -1);
+	}
+
+	TEST(T_InexactClasses) {
+		// x is equal to y, and y to z, but x is not equal to z
+		CNV x, y, z;
+		setCNVRange(x, 1, 0, 1000000L);
+		setCNVRange(y, 1, 15000000L, 1000000L);
+		setCNVRange(z, 1, 30000000L, 1000000L);
+
+		SomaticEventPtr_vec events;
+		events.push_back(&x);
+		events.push_back(&y);
+		events.push_back(&z);
+
+		EventClassIndex index;
+		index.build(events);
+		CHECK(not index.isExact());
+
+		std::vector<size_t> classes;
+		CHECK(not index.classesOf(events, classes));
+
+		// an LOH is not equal to anything, itself included
+		LOH loh;
+		setCNVRange(loh, 3, 0, 1000000L);
+		SomaticEventPtr_vec lohEvents(1, &loh);
+		index.build(lohEvents);
+		CHECK(not index.isExact());
+	}
+
+	TEST(T_SetOperations) {
+		// two copies of the same ten events, as two trees would have them
+		std::vector<CNV> first(10), second(10);
+		SomaticEventPtr_vec all, master, unwanted, container;
+		for(int i=0; i<10; i++) {
+			setCNVRange(first[i], i+1, 1000000L * i, 1000000L);
+			setCNVRange(second[i], i+1, 1000000L * i + 500, 1000000L);
+			all.push_back(&first[i]);
+			all.push_back(&second[i]);
+			master.push_back(&first[i]);
+			if(i % 3 == 0)
+				unwanted.push_back(&second[i]);
+			if(i != 4)
+				container.push_back(&second[i]);
+		}
+
+		EventClassIndex index;
+		index.build(all);
+		CHECK(index.isExact());
+		CHECK(index.numClasses() == 10);
+
+		std::vector<size_t> classes;
+		EventClassSet masterSet, unwantedSet, containerSet;
+		masterSet.reset(index.numClasses());
+		unwantedSet.reset(index.numClasses());
+		containerSet.reset(index.numClasses());
+		CHECK(index.classesOf(master, classes));
+		for(size_t i=0; i<classes.size(); i++)
+			masterSet.insert(classes[i]);
+		CHECK(index.classesOf(unwanted, classes));
+		for(size_t i=0; i<classes.size(); i++)
+			unwantedSet.insert(classes[i]);
+		CHECK(index.classesOf(container, classes));
+		for(size_t i=0; i<classes.size(); i++)
+			containerSet.insert(classes[i]);
+
+		CHECK(masterSet.count() == 10);
+		CHECK(masterSet.countCommon(unwantedSet) == 4);
+		CHECK(unwantedSet.isSubsetOf(masterSet));
+		CHECK(not masterSet.isSubsetOf(containerSet));
+
+		EventClassSet diff = masterSet;
+		diff.subtract(unwantedSet);
+		CHECK(diff.count() == SomaticEventDifference(master, unwanted).size());
+		diff.subtract(containerSet);
+		CHECK(diff.count() == 1);
+		CHECK(diff.contains(index.classOf(&first[4])));
+
+		EventClassSet common = containerSet;
+		common.intersect(unwantedSet);
+		CHECK(common.count() == 4);
+		common.intersect(diff);
+		CHECK(common.isEmpty());
+		common.unite(diff);
+		CHECK(common.count() == 1);
+
+		// events not in the index have no class
+		CNV extra;
+		setCNVRange(extra, 5, 4001000L, 1000000L);
+		container.push_back(&extra);
+		CHECK(not index.classesOf(container, classes));
+	}
+
+	TEST(T_LargeSets) {
+		// more classes than fit in the set object
+		std::vector<CNV> events(300);
+		SomaticEventPtr_vec all;
+		for(size_t i=0; i<events.size(); i++) {
+			setCNVRange(events[i], 1, 100000000L * i, 1000000L);
+			all.push_back(&events[i]);
+		}
+
+		EventClassIndex index;
+		index.build(all);
+		CHECK(index.numClasses() == 300);
+
+		EventClassSet even, low;
+		even.reset(index.numClasses());
+		low.reset(index.numClasses());
+		for(size_t i=0; i<events.size(); i++) {
+			if(i % 2 == 0)
+				even.insert(index.classOf(&events[i]));
+			if(i < 200)
+				low.insert(index.classOf(&events[i]));
+		}
+		CHECK(even.count() == 150);
+		CHECK(even.countCommon(low) == 100);
+
+		EventClassSet copy = even;
+		copy.subtract(low);
+		CHECK(copy.count() == 50);
+		CHECK(copy.isSubsetOf(even));
+		CHECK(not even.isSubsetOf(copy));
+
+		even.reset(index.numClasses());
+		CHECK(even.isEmpty());
+	}
+}
+
+SUITE(TestNodeClassTable) {
+	TEST_FIXTURE(_TestPlacementFixture, T_NodeClasses) {
+		SomaticEventPtr_vec all;
+		SubclonePtr_vec nodes;
+		nodes.push_back(&p0);
+		nodes.push_back(&p1);
+		nodes.push_back(&p2);
+		nodes.push_back(&r0);
+		nodes.push_back(&r1);
+		for(size_t i=0; i<nodes.size(); i++) {
+			SomaticEventPtr_vec events = nodeEventsList(nodes[i]);
+			all.insert(all.end(), events.begin(), events.end());
+		}
+
+		EventClassIndex index;
+		index.build(all);
+		CHECK(index.isExact());
+
+		NodeClassTable table;
+		for(size_t i=0; i<nodes.size(); i++)
+			CHECK(table.update(nodes[i], index));
+		CHECK(table.size() == nodes.size());
+		CHECK(table.find(&p3) == NULL);
+
+		for(size_t i=0; i<nodes.size(); i++) {
+			const NodeEventClasses *nodeClasses = table.find(nodes[i]);
+			CHECK(nodeClasses != NULL);
+			if(nodeClasses == NULL)
+				continue;
+
+			std::vector<size_t> classes;
+			for(size_t j=0; j<nodes[i]->vecEventCluster().size(); j++) {
+				const SomaticEventPtr_vec& members = nodes[i]->vecEventCluster()[j]->members();
+				for(size_t k=0; k<members.size(); k++)
+					classes.push_back(index.classOf(members[k]));
+			}
+			CHECK(nodeClasses->eventClasses == classes);
+			for(size_t j=0; j<classes.size(); j++)
+				CHECK(nodeClasses->classes.contains(classes[j]));
+		}
+
+		// updating a node replaces its entry
+		CHECK(table.update(&p1, index));
+		CHECK(table.size() == nodes.size());
+
+		table.clear();
+		CHECK(table.size() == 0);
+		CHECK(table.find(&p0) == NULL);
+	}
+
+	TEST_FIXTURE(_TestPlacementFixture, T_ClassComparedMerge) {
+		SubclonePtr_vec primary, secondary;
+		primary.push_back(&p0);
+		primary.push_back(&pp0);
+		primary.push_back(&upn933124_1->p0);
+		primary.push_back(&upn933124_2->p0);
+		primary.push_back(&upn768168_2->p0);
+		secondary.push_back(&r0);
+		secondary.push_back(&rr0);
+		secondary.push_back(&upn933124_1->r0);
+		secondary.push_back(&upn933124_2->r0);
+		secondary.push_back(&upn768168_2->r0);
+
+		TreeTraverser traverser;
+		TreeNodeEventCollector collector;
+		for(size_t i=0; i<primary.size(); i++)
+			traverser.preOrderVisit(primary[i], collector);
+		for(size_t j=0; j<secondary.size(); j++)
+			traverser.preOrderVisit(secondary[j], collector);
+
+		EventClassIndex index;
+		index.build(collector.events);
+		CHECK(index.isExact());
+
+		NodeClassTable table;
+		for(size_t i=0; i<collector.nodes.size(); i++)
+			CHECK(table.update(collector.nodes[i], index));
+
+		// comparing the classes gives the answers of comparing the events
+		for(size_t i=0; i<primary.size(); i++) {
+			for(size_t j=0; j<secondary.size(); j++) {
+				std::vector<void *> pShape = treeShape(primary[i]);
+
+				TreeMergeContext pairwise;
+				bool expected = TreeMerge(primary[i], secondary[j], &pairwise);
+				std::vector<void *> mergedShape = treeShape(primary[i]);
+				pairwise.rollback();
+
+				TreeMergeContext classContext(&index, &table);
+				CHECK(classContext.comparesClasses());
+				CHECK(TreeMerge(primary[i], secondary[j], &classContext) == expected);
+				CHECK(treeShape(primary[i]).size() == mergedShape.size());
+				classContext.rollback();
+				CHECK(treeShape(primary[i]) == pShape);
+			}
+		}
+	}
+
+	TEST(T_EquivalentEvents) {
+		// the relapse carries two copies of the events of the primary, which
+		// are equal to each other within the resolution
+		CNV a, b, c, a1, a2, b1, c1;
+		setCNVRange(a, 1, 0, 1000000L);
+		setCNVRange(b, 2, 0, 1000000L);
+		setCNVRange(c, 3, 0, 1000000L);
+		setCNVRange(a1, 1, 500, 1000000L);
+		setCNVRange(a2, 1, 800, 1000000L);
+		setCNVRange(b1, 2, 500, 1000000L);
+		setCNVRange(c1, 3, 500, 1000000L);
+
+		EventCluster ca, cb, cc, ca1, cab1, cc1;
+		ca.addEvent(&a); cb.addEvent(&b); cc.addEvent(&c);
+		ca1.addEvent(&a1); cab1.addEvent(&a2); cab1.addEvent(&b1); cc1.addEvent(&c1);
+
+		Subclone p0, p1, p2, p3, r0, r1, r2, r3;
+		p1.addEventCluster(&ca); p2.addEventCluster(&cb); p3.addEventCluster(&cc);
+		p0.addChild(&p1); p1.addChild(&p2); p1.addChild(&p3);
+		r1.addEventCluster(&ca1); r2.addEventCluster(&cab1); r3.addEventCluster(&cc1);
+		r0.addChild(&r1); r1.addChild(&r2); r1.addChild(&r3);
+
+		Subclone *trees[] = {&p0, &r0};
+		TreeTraverser traverser;
+		TreeNodeEventCollector collector;
+		for(size_t i=0; i<2; i++)
+			traverser.preOrderVisit(trees[i], collector);
+
+		EventClassIndex index;
+		index.build(collector.events);
+		CHECK(index.isExact());
+		CHECK(index.numClasses() == 3);
+
+		NodeClassTable table;
+		for(size_t i=0; i<collector.nodes.size(); i++)
+			CHECK(table.update(collector.nodes[i], index));
+
+		for(size_t i=0; i<2; i++) {
+			for(size_t j=0; j<2; j++) {
+				std::vector<void *> pShape = treeShape(trees[i]);
+
+				TreeMergeContext pairwise;
+				bool expected = TreeMerge(trees[i], trees[j], &pairwise);
+				std::vector<void *> mergedShape = treeShape(trees[i]);
+				pairwise.rollback();
+
+				TreeMergeContext classContext(&index, &table);
+				CHECK(TreeMerge(trees[i], trees[j], &classContext) == expected);
+				CHECK(treeShape(trees[i]).size() == mergedShape.size());
+				classContext.rollback();
+				CHECK(treeShape(trees[i]) == pShape);
+			}
+		}
+	}
+
+}
+
 
 int main() {
 	return UnitTest::RunAllTests();
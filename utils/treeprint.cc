@@ -53,18 +53,18 @@ int32_t rootID;
  *
  * if B and C are children of A, the final output will look like A (B, C)
  */
-class TreePrintTraverser: public TreeTraverseDelegate {
+class TreePrintTraverser: public TreeVisitor<Subclone> {
 	public:
-		virtual void preprocessNode(TreeNode *node) {
+		void preprocessNode(Subclone *node) {
 			if(!node->isLeaf())
 				std::cerr<<"(";
 		}
 
-		virtual void processNode(TreeNode * node) {
-			std::cerr<<((Subclone *)node)->fraction()<<",";
+		void processNode(Subclone * node) {
+			std::cerr<<node->fraction()<<",";
 		}
 
-		virtual void postprocessNode(TreeNode *node) {
+		void postprocessNode(Subclone *node) {
 			if(!node->isLeaf())
 				std::cerr<<")";
 		}
@@ -73,12 +73,9 @@ class TreePrintTraverser: public TreeTraverseDelegate {
 /**
  * @brief A tree traverser that prints the nodes in Graphviz .dot format
  */
-class NodePrintTraverser: public TreeTraverseDelegate {
+class NodePrintTraverser: public TreeVisitor<Subclone> {
 	public:
-		virtual void processNode(TreeNode * node) {
-			Subclone *clone = dynamic_cast<Subclone *>(node);
-			if(clone == NULL)
-				return;
+		void processNode(Subclone * clone) {
 			double fracP = clone->fraction() * 100;
 			std::cout<<"\tn"<<clone->getId()<<" [label=\"n"<<clone->getId()<<": ";
 			std::cout.precision(3);
@@ -89,17 +86,12 @@ class NodePrintTraverser: public TreeTraverseDelegate {
 /**
  * @brief A tree traverser that prints the edges in Graphviz .dot format
  */
-class EdgePrintTraverser: public TreeTraverseDelegate {
+class EdgePrintTraverser: public TreeVisitor<Subclone> {
 	public:
-		virtual void processNode(TreeNode * node) {
-			Subclone *clone = dynamic_cast<Subclone *>(node);
-			if(clone == NULL)
-				return;
+		void processNode(Subclone * clone) {
 			if(clone->getParent() == NULL)
 				return;
-			Subclone *pClone = dynamic_cast<Subclone *>(node->getParent());
-			if(pClone == NULL)
-				return;
+			Subclone *pClone = static_cast<Subclone *>(clone->getParent());
 
 			std::cout<<"\tn"<<pClone->getId()<<"->n"<<clone->getId()<<";"<<std::endl;
 		}
@@ -134,48 +126,68 @@ void listRootIDs(sqlite3* database) {
 }
 
 /**
- * @brief Print details about a subclone structure
- * The structure contains the given root, and all its descendent nodes
+ * @brief Print a subclone structure
  *
- * @param database An live sqlite3 database connection
- * @param rootID The id of the root node for which the structure is printed
+ * @param root The root node of the structure
  */
-void printSubcloneWithID(sqlite3* database, int32_t rootID) {
-	Subclone *root = new Subclone();
-
-	root->unarchiveObjectFromDB(database, rootID);
-
-	SubcloneLoadTreeTraverser loadTr(database);
-	TreeNode::PreOrderTraverse(root, loadTr);
-
+void printSubclone(Subclone *root) {
 	if(outputMode == OUT_FORMAT_TEXT) {
 		TreePrintTraverser traverser;
-		TreeNode::PreOrderTraverse(root, traverser);
+		TreeNode::PreOrderVisit(root, traverser);
 	} 
 	else if(outputMode == OUT_FORMAT_GVIZ) {
 		std::cout<<"digraph {"<<std::endl;
 		// Node list
 		NodePrintTraverser npTrav;
-		TreeNode::PreOrderTraverse(root, npTrav);
+		TreeNode::PreOrderVisit(root, npTrav);
 
 		// Edge list
 		EdgePrintTraverser epTrav;
-		TreeNode::PreOrderTraverse(root, epTrav);
+		TreeNode::PreOrderVisit(root, epTrav);
 		std::cout<<"}"<<std::endl;
 	}
 	std::cout<<std::endl;
 }
 
+/**
+ * @brief Print details about a subclone structure
+ * The structure contains the given root, and all its descendent nodes
+ *
+ * @param database An live sqlite3 database connection
+ * @param rootID The id of the root node for which the structure is printed
+ */
+void printSubcloneWithID(sqlite3* database, int32_t rootID) {
+	SubcloneArena arena;
+	Subclone *root = arena.createSubclone();
+
+	root->unarchiveObjectFromDB(database, rootID);
+
+	SubcloneLoadTreeTraverser loadTr(database, &arena);
+	TreeNode::PreOrderTraverse(root, loadTr);
+
+	printSubclone(root);
+}
+
 /**
  * @brief Print all subclone structures
  *
  * @param database An live sqlite3 database connection
  */
 void printAllSubclones(sqlite3* database) {
+	// read the whole database at once rather than tree by tree
+	SubcloneTreeLoader loader;
+	if(not loader.loadFromDB(database)) {
+		std::cerr<<"Unable to load subclone structures"<<std::endl;
+		return;
+	}
 
-	DBObjectID_vec rootIDs = SubcloneLoadTreeTraverser::rootNodes(database);
-	for(DBObjectID_vec::iterator it = rootIDs.begin(); it != rootIDs.end(); it++) {
-		printSubcloneWithID(database, *it);
+	// the arena is cleared after every tree, and its memory reused
+	SubcloneArena arena;
+	const DBObjectID_vec& rootIDs = loader.rootIDs();
+	for(DBObjectID_vec::const_iterator it = rootIDs.begin(); it != rootIDs.end(); it++) {
+		Subclone *root = loader.buildTree(*it, arena);
+		printSubclone(root);
+		arena.clear();
 	}
 }
 
@@ -241,7 +253,7 @@ int main(int argc, char* argv[]) {
 			}
 	}
 
-	sqlite3_close(database);
+	Archivable::closeDatabase(database);
 	
 	return 0;
 }